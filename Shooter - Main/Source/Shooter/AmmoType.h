@@ -5,6 +5,7 @@ enum class EAmmoType : uint8
 {
 	EAT_9mm UMETA(DisplayNAme = "9mm"),
 	EAT_AR UMETA(DisplayName = "AssaultRifle"),
+	EAT_Grenade UMETA(DisplayName = "Grenade"),
 
 	ECS_NAX UMETA(DisplayName = "DefaultMAX")
 };
\ No newline at end of file
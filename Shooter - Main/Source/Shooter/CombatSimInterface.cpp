@@ -0,0 +1,6 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CombatSimInterface.h"
+
+// Add default functionality here for any ICombatSimInterface functions that are not pure virtual.
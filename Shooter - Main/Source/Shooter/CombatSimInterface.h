@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "CombatSimInterface.generated.h"
+
+// This class does not need to be modified.
+UINTERFACE(MinimalAPI)
+class UCombatSimInterface : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Implemented by objects stepped by the UShooterCombatClock
+ */
+class SHOOTER_API ICombatSimInterface
+{
+	GENERATED_BODY()
+
+public:
+
+	/**
+	 * Advances the combat state by one fixed step. SimTime is the clock's time at the end of the step,
+	 * deadlines compared against it fire on the same step at any frame rate. Return false once there is
+	 * nothing left to simulate, the clock stops stepping the object until it registers again.
+	 */
+	virtual bool CombatStep(float StepTime, double SimTime) { return false; }
+
+	/* Blends the visual state between the last two steps, Alpha 0 being the older one. Not called on headless servers */
+	virtual void CombatPresent(float Alpha) {}
+
+	/* Hash of the state CombatStep advances, compared across frame rates by UShooterCombatClock::CheckDeterminism */
+	virtual uint32 GetCombatStateHash() const { return 0; }
+};
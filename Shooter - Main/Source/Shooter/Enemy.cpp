@@ -5,6 +5,21 @@
 #include "Kismet/GameplayStatics.h"
 #include "Sound/SoundCue.h"
 #include "particles/ParticleSystemComponent.h"
+#include "ShooterSignificanceManager.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Blueprint/UserWidget.h"
+#include "Components/CapsuleComponent.h"
+#include "ShooterDeathManager.h"
+#include "ShooterAIScheduler.h"
+#include "EnemyController.h"
+#include "Net/UnrealNetwork.h"
+#include "ShooterReplaySubsystem.h"
+#include "ShooterCombatClock.h"
+#include "ShooterStats.h"
+#include "ShooterLLM.h"
+#include "ShooterHitchMonitor.h"
+#include "ShooterTrace.h"
+#include "Shooter.h"
 
 
 
@@ -15,19 +30,66 @@ AEnemy::AEnemy() :
 	HealthBarDisplayTime(4.f),
 	bCanHitReact(true),
 	HitReactTimeMax(3.f),
-	HitReactTimeMin(.5f)
+	HitReactTimeMin(.5f),
+	HitReactEndTime(0.0),
+	HitNumberDestroyTime(1.5f),
+	bDying(false),
+	DeathMontageSection(FName("Death")),
+	RagdollImpulse(300.f),
+	bRagdolling(false),
+	bDeathPoseFrozen(false),
+	LastHitDirection(FVector::ZeroVector),
+	SignificanceTier(ESignificanceTier::EST_High)
 {
  	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	// Pooled enemies are spawned at runtime, they still need a controller to run scheduler decisions
+	AIControllerClass = AEnemyController::StaticClass();
+	AutoPossessAI = EAutoPossessAI::PlacedInWorldOrSpawned;
 }
 
 // Called when the game starts or when spawned
 void AEnemy::BeginPlay()
 {
 	Super::BeginPlay();
-	
-	GetMesh()->SetCollisionResponseToChannel(ECollisionChannel::ECC_Visibility, ECollisionResponse::ECR_Block);
+
+	// Remember how the mesh sits in the capsule so a pooled ragdoll can be put back
+	MeshRelativeTransform = GetMesh()->GetRelativeTransform();
+	MeshCollisionProfile = GetMesh()->GetCollisionProfileName();
+
+	SetupMeshCollision();
+
+	// Let the significance manager throttle this enemy when it is far from every player
+	UShooterSignificanceManager* SignificanceManager = GetWorld()->GetSubsystem<UShooterSignificanceManager>();
+	if (SignificanceManager)
+	{
+		SignificanceManager->RegisterActor(this);
+	}
+
+	// AI only runs where the enemies are simulated
+	UShooterAIScheduler* AIScheduler = GetWorld()->GetSubsystem<UShooterAIScheduler>();
+	if (AIScheduler && HasAuthority())
+	{
+		AIScheduler->RegisterEnemy(this);
+	}
+}
+
+void AEnemy::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UShooterSignificanceManager* SignificanceManager = GetWorld()->GetSubsystem<UShooterSignificanceManager>();
+	if (SignificanceManager)
+	{
+		SignificanceManager->UnregisterActor(this);
+	}
+
+	UShooterAIScheduler* AIScheduler = GetWorld()->GetSubsystem<UShooterAIScheduler>();
+	if (AIScheduler)
+	{
+		AIScheduler->UnregisterEnemy(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 
@@ -38,10 +100,193 @@ void AEnemy::ShowHealthBar_Implementation()
 	GetWorldTimerManager().SetTimer(HealthBarTimer, this, &AEnemy::HideHealthBar, HealthBarDisplayTime);
 }
 
+void AEnemy::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AEnemy, Health);
+	DOREPLIFETIME(AEnemy, bDying);
+}
+
 void AEnemy::Die()
+{
+	if (bDying) return;
+	bDying = true;
+	SHOOTER_TRACE(EnemyDie, this);
+
+	PlayDeath();
+
+	EnemyDiedDelegate.Broadcast(this);
+}
+
+void AEnemy::OnRep_Dying()
+{
+	// Pools reuse enemies, so bDying also replicates back to false
+	if (bDying)
+	{
+		PlayDeath();
+	}
+	else
+	{
+		ResetDeathState();
+	}
+}
+
+void AEnemy::PlayDeath()
 {
 	HideHealthBar();
 
+	UShooterCombatClock* CombatClock = GetWorld()->GetSubsystem<UShooterCombatClock>();
+	if (CombatClock)
+	{
+		CombatClock->Unregister(this);
+	}
+	GetCharacterMovement()->StopMovementImmediately();
+	GetCharacterMovement()->DisableMovement();
+	GetCapsuleComponent()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+
+	// Dead enemies stop costing perception traces and decisions
+	UShooterAIScheduler* AIScheduler = GetWorld()->GetSubsystem<UShooterAIScheduler>();
+	if (AIScheduler)
+	{
+		AIScheduler->UnregisterEnemy(this);
+	}
+	AAIController* AIController = Cast<AAIController>(GetController());
+	if (AIController)
+	{
+		AIController->StopMovement();
+	}
+
+	// The death manager decides between ragdoll and animated death
+	UShooterDeathManager* DeathManager = GetWorld()->GetSubsystem<UShooterDeathManager>();
+	if (DeathManager)
+	{
+		DeathManager->HandleDeath(this);
+	}
+	else
+	{
+		FreezeDeathPose();
+	}
+}
+
+void AEnemy::SetupMeshCollision()
+{
+	// Shots hit the mesh rather than the capsule, item focus looks straight through
+	GetMesh()->SetCollisionResponseToChannel(ECC_Weapon, ECollisionResponse::ECR_Block);
+	GetMesh()->SetCollisionResponseToChannel(ECC_Interact, ECollisionResponse::ECR_Ignore);
+}
+
+void AEnemy::StartRagdoll()
+{
+	bRagdolling = true;
+
+	UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
+	if (AnimInstance)
+	{
+		AnimInstance->StopAllMontages(0.f);
+	}
+
+	GetMesh()->SetCollisionProfileName(FName("Ragdoll"));
+	GetMesh()->SetAllBodiesSimulatePhysics(true);
+	GetMesh()->WakeAllRigidBodies();
+	GetMesh()->bBlendPhysics = true;
+
+	// Push the body along the last bullet so it falls away from the shooter
+	if (!LastHitDirection.IsNearlyZero())
+	{
+		GetMesh()->AddImpulse(LastHitDirection * RagdollImpulse, LastHitBone, true);
+	}
+
+	UShooterSignificanceManager* SignificanceManager = GetWorld()->GetSubsystem<UShooterSignificanceManager>();
+	if (SignificanceManager)
+	{
+		SignificanceManager->RefreshActor(this);
+	}
+}
+
+float AEnemy::PlayDeathMontage()
+{
+	UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
+	if (AnimInstance == nullptr || HitMontage == nullptr) return 0.f;
+
+	const int32 SectionIndex{ HitMontage->GetSectionIndex(DeathMontageSection) };
+	if (SectionIndex == INDEX_NONE) return 0.f;
+
+	AnimInstance->Montage_Play(HitMontage);
+	AnimInstance->Montage_JumpToSection(DeathMontageSection, HitMontage);
+
+	// Freeze just before the section ends so the montage never blends back out
+	return FMath::Max(HitMontage->GetSectionLength(SectionIndex) - 0.05f, 0.f);
+}
+
+void AEnemy::FreezeDeathPose()
+{
+	bRagdolling = false;
+	bDeathPoseFrozen = true;
+
+	// Stop refreshing bones before turning physics off, so the current pose is kept
+	GetMesh()->bNoSkeletonUpdate = true;
+	GetMesh()->bPauseAnims = true;
+	GetMesh()->SetSimulatePhysics(false);
+	GetMesh()->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+
+	UShooterSignificanceManager* SignificanceManager = GetWorld()->GetSubsystem<UShooterSignificanceManager>();
+	if (SignificanceManager)
+	{
+		SignificanceManager->RefreshActor(this);
+	}
+
+	EnemyDeathFinishedDelegate.Broadcast(this);
+}
+
+void AEnemy::ResetDeathState()
+{
+	UShooterDeathManager* DeathManager = GetWorld()->GetSubsystem<UShooterDeathManager>();
+	if (DeathManager && bDying && !bDeathPoseFrozen)
+	{
+		DeathManager->CancelDeath(this);
+	}
+
+	bRagdolling = false;
+	bDeathPoseFrozen = false;
+	LastHitDirection = FVector::ZeroVector;
+
+	GetMesh()->SetSimulatePhysics(false);
+	GetMesh()->bBlendPhysics = false;
+	GetMesh()->bNoSkeletonUpdate = false;
+	GetMesh()->bPauseAnims = false;
+
+	// Ragdoll simulation detaches the mesh from the capsule
+	GetMesh()->AttachToComponent(GetCapsuleComponent(), FAttachmentTransformRules::KeepRelativeTransform);
+	GetMesh()->SetRelativeTransform(MeshRelativeTransform);
+	GetMesh()->SetCollisionProfileName(MeshCollisionProfile);
+	SetupMeshCollision();
+
+	GetCapsuleComponent()->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
+}
+
+bool AEnemy::GetForcedSignificanceTier(ESignificanceTier& OutTier) const
+{
+	if (bRagdolling)
+	{
+		OutTier = ESignificanceTier::EST_High;
+		return true;
+	}
+	if (bDeathPoseFrozen)
+	{
+		OutTier = ESignificanceTier::EST_Dormant;
+		return true;
+	}
+
+	// Chasing and attacking move the enemy for real, Dormant would freeze it however far it is from every viewer
+	const AEnemyController* EnemyController = Cast<AEnemyController>(GetController());
+	if (OutTier == ESignificanceTier::EST_Dormant && EnemyController &&
+		(EnemyController->GetAIState() == EEnemyAIState::EAS_Chase || EnemyController->GetAIState() == EEnemyAIState::EAS_Attack))
+	{
+		OutTier = ESignificanceTier::EST_Low;
+		return true;
+	}
+	return false;
 }
 
 void AEnemy::PlayHitMontage(FName Section, float PlayRate)
@@ -56,18 +301,68 @@ void AEnemy::PlayHitMontage(FName Section, float PlayRate)
 			
 		}
 		bCanHitReact = false;
-		const float HitReactTime{ FMath::FRandRange(HitReactTimeMin, HitReactTimeMax) };
-		GetWorldTimerManager().SetTimer(HitReactTimer, this, &AEnemy::ResetHitReactTimer, HitReactTime);
+		// Drawn from the replay stream so recorded fights hit-react the same way when played back
+		UShooterReplaySubsystem* Replay = GetWorld()->GetSubsystem<UShooterReplaySubsystem>();
+		const float HitReactTime{ Replay ? Replay->GetRandomStream().FRandRange(HitReactTimeMin, HitReactTimeMax) : FMath::FRandRange(HitReactTimeMin, HitReactTimeMax) };
+
+		// Timed on the combat clock, so the window closes on the same step at any frame rate
+		UShooterCombatClock* CombatClock = GetWorld()->GetSubsystem<UShooterCombatClock>();
+		if (CombatClock)
+		{
+			HitReactEndTime = CombatClock->GetSimTime() + HitReactTime;
+			CombatClock->Register(this);
+		}
 		
 	}
 }
 	
 
+void AEnemy::StoreHitNumber(UUserWidget* HitNumber, FVector Location)
+{
+	if (HitNumber == nullptr) return;
+
+	SHOOTER_LLM_SCOPE(HitNumbers);
+	HitNumbers.Add(HitNumber, Location);
+	ShooterStats::AddLiveHitNumbers(1);
+
+	FTimerHandle HitNumberTimer;
+	FTimerDelegate HitNumberDelegate;
+	HitNumberDelegate.BindUFunction(this, FName("DestroyHitNumber"), HitNumber);
+	GetWorldTimerManager().SetTimer(HitNumberTimer, HitNumberDelegate, HitNumberDestroyTime, false);
+}
+
+void AEnemy::DestroyHitNumber(UUserWidget* HitNumber)
+{
+	if (HitNumbers.Remove(HitNumber) == 0) return;
+
+	ShooterStats::AddLiveHitNumbers(-1);
+	if (HitNumber)
+	{
+		HitNumber->RemoveFromParent();
+	}
+}
+
 void AEnemy::ResetHitReactTimer()
 {
 	bCanHitReact = true;
 }
 
+bool AEnemy::CombatStep(float StepTime, double SimTime)
+{
+	if (bCanHitReact) return false;
+
+	if (SimTime >= HitReactEndTime)
+	{
+		ResetHitReactTimer();
+		return false;
+	}
+	return true;
+}
+
+uint32 AEnemy::GetCombatStateHash() const
+{
+	return HashCombine(GetTypeHash(static_cast<uint8>(bCanHitReact)), GetTypeHash(HitReactEndTime));
+}
 
 // Called every frame
 void AEnemy::Tick(float DeltaTime)
@@ -84,14 +379,36 @@ void AEnemy::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
 }
 void AEnemy::BulletHit_Implementation(FHitResult HitResult)
 {
+	// Being shot makes this enemy relevant, bump it up before deciding on FX
+	UShooterSignificanceManager* SignificanceManager = GetWorld()->GetSubsystem<UShooterSignificanceManager>();
+	if (SignificanceManager)
+	{
+		SignificanceManager->ReportCombatEvent(this);
+	}
+
 	if (ImpactSound)
 	{
 		UGameplayStatics::PlaySoundAtLocation(this, ImpactSound, GetActorLocation());
 	}
-	if (ImpactParticles)
+	if (ImpactParticles && UShooterSignificanceManager::GetTierSettings(SignificanceTier).bSpawnDetailFX)
 	{
+		SHOOTER_LLM_SCOPE(CombatFX);
+		ShooterHitch::AddEvent(EShooterHitchEvent::ImpactFX, this, ImpactParticles->GetFName());
 		UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ImpactParticles, HitResult.Location, FRotator(0.f), true);
 	}
+	// Remember the shot so a ragdoll can be pushed along it
+	LastHitDirection = (HitResult.TraceEnd - HitResult.TraceStart).GetSafeNormal();
+	LastHitBone = HitResult.BoneName;
+
+	if (bDying) return;
+
+	// Being shot moves this enemy to the front of the perception queue
+	UShooterAIScheduler* AIScheduler = GetWorld()->GetSubsystem<UShooterAIScheduler>();
+	if (AIScheduler)
+	{
+		AIScheduler->ReportThreat(this);
+	}
+
 	ShowHealthBar();
 	PlayHitMontage(FName("HitReactFront"));
 
@@ -99,6 +416,11 @@ void AEnemy::BulletHit_Implementation(FHitResult HitResult)
 
 float AEnemy::TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 {
+	SCOPE_CYCLE_COUNTER(STAT_ShooterEnemyTakeDamage);
+	CSV_SCOPED_TIMING_STAT(Shooter, EnemyTakeDamage);
+
+	if (bDying) return 0.f;
+
 	if (Health - DamageAmount <= 0.f)
 	{
 		Health = 0.f;
@@ -111,5 +433,83 @@ float AEnemy::TakeDamage(float DamageAmount, FDamageEvent const& DamageEvent, AC
 	return DamageAmount;
 }
 
+void AEnemy::SetSignificanceTier(ESignificanceTier Tier)
+{
+	SignificanceTier = Tier;
+}
+
+void AEnemy::DeactivateForPool()
+{
+	UShooterSignificanceManager* SignificanceManager = GetWorld()->GetSubsystem<UShooterSignificanceManager>();
+	if (SignificanceManager)
+	{
+		SignificanceManager->UnregisterActor(this);
+	}
+
+	UShooterAIScheduler* AIScheduler = GetWorld()->GetSubsystem<UShooterAIScheduler>();
+	if (AIScheduler)
+	{
+		AIScheduler->UnregisterEnemy(this);
+	}
+
+	GetWorldTimerManager().ClearAllTimersForObject(this);
+
+	// Hit number widgets are owned by the viewport, remove any still showing
+	for (const TPair<UUserWidget*, FVector>& HitNumber : HitNumbers)
+	{
+		if (HitNumber.Key)
+		{
+			HitNumber.Key->RemoveFromParent();
+		}
+	}
+	ShooterStats::AddLiveHitNumbers(-HitNumbers.Num());
+	HitNumbers.Empty();
+
+	UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
+	if (AnimInstance)
+	{
+		AnimInstance->StopAllMontages(0.f);
+	}
+
+	GetCharacterMovement()->StopMovementImmediately();
+	GetCharacterMovement()->DisableMovement();
+
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	SetActorTickEnabled(false);
+	GetMesh()->SetComponentTickEnabled(false);
+	GetCharacterMovement()->SetComponentTickEnabled(false);
+}
+
+void AEnemy::ActivateFromPool(const FTransform& SpawnTransform)
+{
+	ShooterHitch::AddEvent(EShooterHitchEvent::Spawn, this, FName("FromPool"));
+
+	ResetDeathState();
+
+	Health = MaxHealth;
+	bDying = false;
+	bCanHitReact = true;
+
+	SetActorTransform(SpawnTransform, false, nullptr, ETeleportType::ResetPhysics);
 
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+	SetActorTickEnabled(true);
+	GetMesh()->SetComponentTickEnabled(true);
+	GetCharacterMovement()->SetComponentTickEnabled(true);
+	GetCharacterMovement()->SetMovementMode(EMovementMode::MOVE_Walking);
 
+	UShooterSignificanceManager* SignificanceManager = GetWorld()->GetSubsystem<UShooterSignificanceManager>();
+	if (SignificanceManager)
+	{
+		SignificanceManager->RegisterActor(this);
+	}
+
+	// AI only runs where the enemies are simulated
+	UShooterAIScheduler* AIScheduler = GetWorld()->GetSubsystem<UShooterAIScheduler>();
+	if (AIScheduler && HasAuthority())
+	{
+		AIScheduler->RegisterEnemy(this);
+	}
+}
\ No newline at end of file
@@ -5,10 +5,15 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "BulletHitInterface.h"
+#include "SignificanceInterface.h"
+#include "CombatSimInterface.h"
 #include "Enemy.generated.h"
 
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FEnemyDiedDelegate, AEnemy*, Enemy);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FEnemyDeathFinishedDelegate, AEnemy*, Enemy);
+
 UCLASS()
-class SHOOTER_API AEnemy : public ACharacter, public IBulletHitInterface
+class SHOOTER_API AEnemy : public ACharacter, public IBulletHitInterface, public ISignificanceInterface, public ICombatSimInterface
 {
 	GENERATED_BODY()
 
@@ -21,6 +26,8 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	UFUNCTION(BlueprintNativeEvent)
 	void ShowHealthBar();
 	void ShowHealthBar_Implementation();
@@ -30,12 +37,31 @@ protected:
 
 	void Die();
 
+	/* The visible part of dying, run by the server in Die and by clients when bDying replicates */
+	void PlayDeath();
+
+	UFUNCTION()
+	void OnRep_Dying();
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
 	void PlayHitMontage(FName Section, float PlayRate = 1.0f);
 
 	void ResetHitReactTimer();
 
+	/* Keeps a hit number widget spawned by ShowHitNumber until HitNumberDestroyTime has passed */
+	UFUNCTION(BlueprintCallable)
 	void StoreHitNumber(UUserWidget* HitNumber, FVector Location);
 
+	UFUNCTION()
+	void DestroyHitNumber(UUserWidget* HitNumber);
+
+	/* Applies the mesh collision used while alive */
+	void SetupMeshCollision();
+
+	/* Undo ragdoll and frozen pose so a pooled enemy can be reused */
+	void ResetDeathState();
+
 private:
 
 	/* Particles to spawn when impacted by bullets */
@@ -47,7 +73,7 @@ private:
 	class USoundCue* ImpactSound;
 
 	/* Current Health of the Enemy*/
-	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	UPROPERTY(Replicated, EditAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	float Health;
 
 	/* Max Health of the Enemy */
@@ -67,7 +93,8 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	UAnimMontage* HitMontage;
 
-	FTimerHandle HitReactTimer;
+	/* Combat clock time the enemy can hit react again */
+	double HitReactEndTime;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	float HitReactTimeMin;
@@ -81,6 +108,40 @@ private:
 	UPROPERTY(VisibleAnywhere, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	TMap<UUserWidget*, FVector> HitNumbers;
 
+	/* Seconds a hit number stays on screen */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	float HitNumberDestroyTime;
+
+	/* True from Die() until the enemy is reset by a pool */
+	UPROPERTY(ReplicatedUsing = OnRep_Dying, VisibleAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	bool bDying;
+
+	/* Section of HitMontage played when a death can't ragdoll */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	FName DeathMontageSection;
+
+	/* Velocity change applied to the hit bone when the ragdoll starts */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	float RagdollImpulse;
+
+	/* True while the mesh is simulating as a ragdoll */
+	bool bRagdolling;
+
+	/* True once the death pose has been frozen */
+	bool bDeathPoseFrozen;
+
+	/* Direction, bone and location of the last bullet, used to push the ragdoll */
+	FVector LastHitDirection;
+	FName LastHitBone;
+
+	/* Mesh attachment and collision profile while alive, restored by ResetDeathState */
+	FTransform MeshRelativeTransform;
+	FName MeshCollisionProfile;
+
+	/* Tier assigned by the significance manager, gates cosmetic FX */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Significance, meta = (AllowPrivateAccess = "true"))
+	ESignificanceTier SignificanceTier;
+
 
 public:	
 	// Called every frame
@@ -93,8 +154,49 @@ public:
 
 	virtual float TakeDamage(float DamageAmount, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser) override;
 
+	virtual void SetSignificanceTier(ESignificanceTier Tier) override;
+
+	/* Ragdolls keep a full tick while simulating, frozen bodies go dormant */
+	virtual bool GetForcedSignificanceTier(ESignificanceTier& OutTier) const override;
+
+	/* ICombatSimInterface: stepped while the hit-react window is open */
+	virtual bool CombatStep(float StepTime, double SimTime) override;
+	virtual uint32 GetCombatStateHash() const override;
+
+	/* Switches the mesh to ragdoll simulation. Called by the death manager when under budget */
+	void StartRagdoll();
+
+	/* Plays the death section of HitMontage and returns its length */
+	float PlayDeathMontage();
+
+	/* Stops simulation and animation, holding the current pose */
+	void FreezeDeathPose();
+
+	/* Hides the enemy and stops its ticking, movement and collision so a pool can reuse it */
+	void DeactivateForPool();
+
+	/* Wakes a pooled enemy at SpawnTransform with full health */
+	void ActivateFromPool(const FTransform& SpawnTransform);
+
+	/* Broadcast once when Health reaches zero */
+	UPROPERTY(BlueprintAssignable, Category = Delegates)
+	FEnemyDiedDelegate EnemyDiedDelegate;
+
+	/* Broadcast once the body has come to rest and its pose is frozen */
+	UPROPERTY(BlueprintAssignable, Category = Delegates)
+	FEnemyDeathFinishedDelegate EnemyDeathFinishedDelegate;
+
+	FORCEINLINE bool IsDying() const { return bDying; }
+	FORCEINLINE float GetHealth() const { return Health; }
+	FORCEINLINE float GetMaxHealth() const { return MaxHealth; }
+
+	/* Hit number widgets still waiting to be destroyed */
+	FORCEINLINE int32 GetNumHitNumbers() const { return HitNumbers.Num(); }
+
 	FORCEINLINE FString GetHeadBone() const { return HeadBone; }
 
+	FORCEINLINE ESignificanceTier GetSignificanceTier() const { return SignificanceTier; }
+
 	UFUNCTION(BlueprintImplementableEvent)
 	void ShowHitNumber(int32 Damage, FVector HitLocation);
 
@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "EnemyController.h"
+#include "ShooterFlowFieldManager.h"
+#include "ShooterSignificanceManager.h"
+
+AEnemyController::AEnemyController() :
+	AIState(EEnemyAIState::EAS_Idle),
+	AcceptanceRadius(50.f),
+	RepathDistance(150.f),
+	LastMoveTarget(FVector::ZeroVector)
+{
+	// Only ticks while steering along a flow field, decisions come from the scheduler
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+}
+
+void AEnemyController::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	APawn* ControlledPawn = GetPawn();
+	APawn* Target = FlowTarget.Get();
+	UShooterFlowFieldManager* FlowFieldManager = GetWorld()->GetSubsystem<UShooterFlowFieldManager>();
+	if (ControlledPawn == nullptr || Target == nullptr || FlowFieldManager == nullptr)
+	{
+		StopFlowSteering();
+		return;
+	}
+
+	FVector Direction;
+	if (FlowFieldManager->GetFlowDirection(Target, ControlledPawn->GetActorLocation(), Direction))
+	{
+		ControlledPawn->AddMovementInput(Direction);
+	}
+	else
+	{
+		// Off the grid or cut off from the player, let the navmesh find a way
+		StopFlowSteering();
+		LastMoveTarget = Target->GetActorLocation();
+		MoveToLocation(LastMoveTarget, AcceptanceRadius);
+	}
+}
+
+void AEnemyController::StartFlowSteering(APawn* TargetPawn)
+{
+	if (FlowTarget == TargetPawn) return;
+
+	StopMovement();
+	FlowTarget = TargetPawn;
+	SetActorTickEnabled(true);
+}
+
+void AEnemyController::StopFlowSteering()
+{
+	FlowTarget.Reset();
+	SetActorTickEnabled(false);
+}
+
+void AEnemyController::ResetAI()
+{
+	StopFlowSteering();
+	StopMovement();
+	ClearFocus(EAIFocusPriority::Gameplay);
+	AIState = EEnemyAIState::EAS_Idle;
+	LastMoveTarget = FVector::ZeroVector;
+}
+
+void AEnemyController::ApplyDecision(const FEnemyDecision& Decision, APawn* TargetPawn)
+{
+	const EEnemyAIState PreviousState{ AIState };
+	AIState = Decision.State;
+
+	// Chase and Attack keep the pawn out of the Dormant tier, wake it now rather than on the next significance pass
+	UShooterSignificanceManager* SignificanceManager = GetWorld()->GetSubsystem<UShooterSignificanceManager>();
+	if (PreviousState != AIState && SignificanceManager && GetPawn())
+	{
+		SignificanceManager->RefreshActor(GetPawn());
+	}
+
+	switch (Decision.State)
+	{
+	case EEnemyAIState::EAS_Idle:
+		StopFlowSteering();
+		if (PreviousState != EEnemyAIState::EAS_Idle)
+		{
+			StopMovement();
+			ClearFocus(EAIFocusPriority::Gameplay);
+		}
+		break;
+
+	case EEnemyAIState::EAS_Chase:
+		{
+			// Every enemy chasing the same player shares one field, no path query of its own
+			UShooterFlowFieldManager* FlowFieldManager = GetWorld()->GetSubsystem<UShooterFlowFieldManager>();
+			if (TargetPawn && FlowFieldManager && FlowFieldManager->HasField(TargetPawn))
+			{
+				StartFlowSteering(TargetPawn);
+				SetFocus(TargetPawn);
+				break;
+			}
+		}
+		// No field yet, fall through and path there like an investigation
+
+	case EEnemyAIState::EAS_Investigate:
+		if (FlowTarget.IsValid())
+		{
+			StopFlowSteering();
+			LastMoveTarget = FVector::ZeroVector;
+		}
+		// Path queries are the expensive part, skip them when the target barely moved
+		if (PreviousState != Decision.State || FVector::DistSquared(LastMoveTarget, Decision.TargetLocation) > FMath::Square(RepathDistance))
+		{
+			LastMoveTarget = Decision.TargetLocation;
+			MoveToLocation(Decision.TargetLocation, AcceptanceRadius);
+		}
+		if (TargetPawn && Decision.State == EEnemyAIState::EAS_Chase)
+		{
+			SetFocus(TargetPawn);
+		}
+		break;
+
+	case EEnemyAIState::EAS_Attack:
+		StopFlowSteering();
+		if (PreviousState != EEnemyAIState::EAS_Attack)
+		{
+			StopMovement();
+		}
+		if (TargetPawn)
+		{
+			SetFocus(TargetPawn);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "EnemyController.generated.h"
+
+UENUM(BlueprintType)
+enum class EEnemyAIState : uint8
+{
+	EAS_Idle UMETA(DisplayName = "Idle"),
+	EAS_Investigate UMETA(DisplayName = "Investigate"),
+	EAS_Chase UMETA(DisplayName = "Chase"),
+	EAS_Attack UMETA(DisplayName = "Attack"),
+
+	EAS_MAX UMETA(DisplayName = "DefaultMAX")
+};
+
+/* Result of one decision update, produced off the game thread */
+struct FEnemyDecision
+{
+	EEnemyAIState State = EEnemyAIState::EAS_Idle;
+
+	/* Where to move or look, depending on State */
+	FVector TargetLocation = FVector::ZeroVector;
+
+	/* Index into the scheduler's player list, INDEX_NONE when there is no target */
+	int32 TargetPlayerIndex = INDEX_NONE;
+};
+
+/**
+ * Carries out decisions made by the UShooterAIScheduler. Has no logic of its own.
+ * Chases steer along the player's shared flow field when one is built and fall back to navmesh paths otherwise.
+ */
+UCLASS()
+class SHOOTER_API AEnemyController : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+	AEnemyController();
+
+	virtual void Tick(float DeltaTime) override;
+
+	/* Called by the scheduler on the game thread */
+	void ApplyDecision(const FEnemyDecision& Decision, APawn* TargetPawn);
+
+	/* Stops steering, moving and looking at anything and goes back to idle. Called when the scheduler lets go of the pawn */
+	void ResetAI();
+
+private:
+
+	/* Chase TargetPawn by sampling its flow field every frame instead of following a navmesh path */
+	void StartFlowSteering(APawn* TargetPawn);
+
+	void StopFlowSteering();
+
+	/* Current state, for Blueprints and debugging */
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = AI, meta = (AllowPrivateAccess = "true"))
+	EEnemyAIState AIState;
+
+	/* How close to a move target counts as arrived */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AI, meta = (AllowPrivateAccess = "true"))
+	float AcceptanceRadius;
+
+	/* Move requests are only reissued when the target moved further than this */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AI, meta = (AllowPrivateAccess = "true"))
+	float RepathDistance;
+
+	/* Target of the last move request */
+	FVector LastMoveTarget;
+
+	/* Player being chased through the flow field, unset while following a path */
+	TWeakObjectPtr<APawn> FlowTarget;
+
+public:
+
+	FORCEINLINE EEnemyAIState GetAIState() const { return AIState; }
+};
@@ -7,6 +7,13 @@
 #include "Components/SphereComponent.h"
 #include "ShooterCharacter.h"
 #include "Camera/CameraComponent.h"
+#include "ShooterSignificanceManager.h"
+#include "ShooterCombatClock.h"
+#include "Net/UnrealNetwork.h"
+#include "ShooterStats.h"
+#include "ShooterHitchMonitor.h"
+#include "ShooterTrace.h"
+#include "Shooter.h"
 
 
 // Sets default values
@@ -19,6 +26,10 @@ AItem::AItem() :
 	ItemInterpStartLocation(FVector(0.f)),
 	CameraTargetLocation(FVector(0.f)),
 	bInterping(false),
+	ItemInterpElapsed(0.f),
+	PreviousItemInterpElapsed(0.f),
+	ItemInterpLocation(FVector(0.f)),
+	PreviousItemInterpLocation(FVector(0.f)),
 	ItemInterpX(0.f),
 	ItemInterpY(0.f),
 	InterpInitialYawOffSet(0.f),
@@ -27,13 +38,19 @@ AItem::AItem() :
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	// Pickups lying around send nothing until their state changes, see UpdateNetDormancy
+	bReplicates = true;
+	SetReplicatingMovement(true);
+	NetDormancy = DORM_DormantAll;
+	NetUpdateFrequency = 10.f;
+
 	ItemMesh = CreateDefaultSubobject<USkeletalMeshComponent>(TEXT("ItemMesh"));
 	SetRootComponent(ItemMesh);
 
 	CollisionBox = CreateDefaultSubobject<UBoxComponent>(TEXT("CollisionBox"));
 	CollisionBox->SetupAttachment(ItemMesh);
 	CollisionBox->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-	CollisionBox->SetCollisionResponseToChannel(ECollisionChannel::ECC_Visibility, ECollisionResponse::ECR_Block);
+	CollisionBox->SetCollisionResponseToChannel(ECC_Interact, ECollisionResponse::ECR_Block);
 
 	PickupWidget = CreateDefaultSubobject<UWidgetComponent>(TEXT("PickupWidget"));
 	PickupWidget->SetupAttachment(GetRootComponent());
@@ -56,6 +73,58 @@ void AItem::BeginPlay()
 	
 	// Set Item properties based on ItemState
 	SetItemProperties(ItemState);
+	UpdateNetDormancy();
+
+	// Let the significance manager throttle this item when it is far from every player
+	UShooterSignificanceManager* SignificanceManager = GetWorld()->GetSubsystem<UShooterSignificanceManager>();
+	if (SignificanceManager)
+	{
+		SignificanceManager->RegisterActor(this);
+	}
+}
+
+void AItem::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bInterping)
+	{
+		ShooterStats::AddInterpingItems(-1);
+		bInterping = false;
+	}
+
+	UShooterSignificanceManager* SignificanceManager = GetWorld()->GetSubsystem<UShooterSignificanceManager>();
+	if (SignificanceManager)
+	{
+		SignificanceManager->UnregisterActor(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AItem::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AItem, ItemState);
+}
+
+void AItem::OnRep_ItemState()
+{
+	SetItemProperties(ItemState);
+
+	UShooterSignificanceManager* SignificanceManager = GetWorld()->GetSubsystem<UShooterSignificanceManager>();
+	if (SignificanceManager)
+	{
+		SignificanceManager->RefreshActor(this);
+	}
+}
+
+void AItem::UpdateNetDormancy()
+{
+	if (!HasAuthority()) return;
+
+	// Going dormant still sends the final state, waking up flushes the old one
+	const bool bDormant{ ItemState == EItemState::EIS_Pickup || ItemState == EItemState::EIS_PickedUp };
+	SetNetDormancy(bDormant ? DORM_DormantAll : DORM_Awake);
 }
 
 void AItem::OnSphereOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
@@ -86,6 +155,8 @@ void AItem::OnSphereEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor*
 
 void AItem::SetItemProperties(EItemState State)
 {
+	SCOPE_CYCLE_COUNTER(STAT_ShooterSetItemProperties);
+	CSV_SCOPED_TIMING_STAT(Shooter, SetItemProperties);
 	
 	switch (State)
 	{
@@ -101,7 +172,7 @@ void AItem::SetItemProperties(EItemState State)
 			AreaSphere->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
 			// Set CollisionBox properties
 			CollisionBox->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-			CollisionBox->SetCollisionResponseToChannel(ECollisionChannel::ECC_Visibility, ECollisionResponse::ECR_Block);
+			CollisionBox->SetCollisionResponseToChannel(ECC_Interact, ECollisionResponse::ECR_Block);
 			CollisionBox->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
 
 			break;
@@ -174,7 +245,12 @@ void AItem::SetItemProperties(EItemState State)
 
 void AItem::FinishInterping()
 {
+	if (bInterping)
+	{
+		ShooterStats::AddInterpingItems(-1);
+	}
 	bInterping = false;
+	SHOOTER_TRACE(ItemCurve, this, false);
 	if (Character)
 	{
 		Character->GetPickupItem(this);
@@ -183,16 +259,21 @@ void AItem::FinishInterping()
 	SetActorScale3D(FVector(1.f));
 }
 
-void AItem::ItemInterp(float DeltaTime)
+void AItem::ItemInterp(float StepTime)
 {
 	if (!bInterping) return;
 
+	SCOPE_CYCLE_COUNTER(STAT_ShooterItemInterp);
+	CSV_SCOPED_TIMING_STAT(Shooter, ItemInterp);
+
+	PreviousItemInterpElapsed = ItemInterpElapsed;
+	PreviousItemInterpLocation = ItemInterpLocation;
+	ItemInterpElapsed = FMath::Min(ItemInterpElapsed + StepTime, ZCurveTime);
+
 	if (Character && ItemZCurve)
 	{
-		// Sets the Elapsed time after starting ItemInterpTimer
-		const float ElapsedTime = GetWorldTimerManager().GetTimerElapsed(ItemInterpTimer);
-		// Get curve value corresponding to ElapsedTime
-		const float CurveValue = ItemZCurve->GetFloatValue(ElapsedTime);
+		// Get curve value corresponding to the time on the curve
+		const float CurveValue = ItemZCurve->GetFloatValue(ItemInterpElapsed);
 
 		// Get the item's initial location when the curve started
 		FVector ItemLocation = ItemInterpStartLocation;
@@ -204,11 +285,12 @@ void AItem::ItemInterp(float DeltaTime)
 		// Variable to multiply CurveValue
 		const float DeltaZ = ItemToCamera.Size();
 		
-		const FVector CurrentLocation{ GetActorLocation() };
+		// Interpolate from the last step's location, not the blended one the actor is drawn at
+		const FVector CurrentLocation{ ItemInterpLocation };
 		// X value interpolated
-		const float InterpXValue = FMath::FInterpTo(CurrentLocation.X, CameraInterpLocation.X, DeltaTime, 30.0f);
+		const float InterpXValue = FMath::FInterpTo(CurrentLocation.X, CameraInterpLocation.X, StepTime, 30.0f);
 		// Y value interpolated
-		const float InterpYValue = FMath::FInterpTo(CurrentLocation.Y, CameraInterpLocation.Y, DeltaTime, 30.0f);
+		const float InterpYValue = FMath::FInterpTo(CurrentLocation.Y, CameraInterpLocation.Y, StepTime, 30.0f);
 
 		// Set X and Y of ItemLocation to Interped values
 		ItemLocation.X = InterpXValue;
@@ -216,35 +298,59 @@ void AItem::ItemInterp(float DeltaTime)
 		// Adding curve value to the Z component of the Initial location (Multiplied by DeltaZ)
 		ItemLocation.Z += CurveValue * DeltaZ;
 
-		SetActorLocation(ItemLocation, true, nullptr, ETeleportType::TeleportPhysics);
+		ItemInterpLocation = ItemLocation;
+	}
+}
+
+bool AItem::CombatStep(float StepTime, double SimTime)
+{
+	if (!bInterping) return false;
 
-		// Camera rotation this frame
-		const FRotator CameraRotation{ Character->GetFollowCamera()->GetComponentRotation() };
-		// Camera rotation plus inital Yaw Offset
-		FRotator ItemRotation{ 0.f, CameraRotation.Yaw + InterpInitialYawOffSet, 0.f };
+	ItemInterp(StepTime);
 
-		SetActorRotation(ItemRotation, ETeleportType::TeleportPhysics);
+	// The curve ran its course, hand the item to the character
+	if (ItemInterpElapsed >= ZCurveTime)
+	{
+		FinishInterping();
+		return false;
+	}
+	return true;
+}
 
+void AItem::CombatPresent(float Alpha)
+{
+	if (!bInterping || Character == nullptr || ItemZCurve == nullptr) return;
 
-		if (ItemScaleCurve)
-		{
-			const float ScaleCurveValue = ItemScaleCurve->GetFloatValue(ElapsedTime);
-			SetActorScale3D(FVector(ScaleCurveValue, ScaleCurveValue, ScaleCurveValue));
-		}
-		
+	SetActorLocation(FMath::Lerp(PreviousItemInterpLocation, ItemInterpLocation, Alpha), true, nullptr, ETeleportType::TeleportPhysics);
 
-		
+	// Camera rotation this frame
+	const FRotator CameraRotation{ Character->GetFollowCamera()->GetComponentRotation() };
+	// Camera rotation plus inital Yaw Offset
+	FRotator ItemRotation{ 0.f, CameraRotation.Yaw + InterpInitialYawOffSet, 0.f };
+
+	SetActorRotation(ItemRotation, ETeleportType::TeleportPhysics);
+
+	if (ItemScaleCurve)
+	{
+		const float ScaleCurveValue = ItemScaleCurve->GetFloatValue(FMath::Lerp(PreviousItemInterpElapsed, ItemInterpElapsed, Alpha));
+		SetActorScale3D(FVector(ScaleCurveValue, ScaleCurveValue, ScaleCurveValue));
 	}
 }
 
+uint32 AItem::GetCombatStateHash() const
+{
+	uint32 Hash{ GetTypeHash(static_cast<uint8>(ItemState)) };
+	Hash = HashCombine(Hash, GetTypeHash(static_cast<uint8>(bInterping)));
+	Hash = HashCombine(Hash, GetTypeHash(ItemInterpElapsed));
+	return HashCombine(Hash, GetTypeHash(ItemInterpLocation));
+}
+
 // Called every frame
 void AItem::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
-	/* Handles the Item Intepring when in the Equipped Interping state */
-	ItemInterp(DeltaTime);
-
+	// Item interping runs on the combat clock, see CombatStep
 }
 
 void AItem::PlayEquipSound(bool bForcePlaySound)
@@ -255,9 +361,38 @@ void AItem::PlayEquipSound(bool bForcePlaySound)
 void AItem::SetItemState(EItemState State)
 	{
 		ItemState = State;
+		ShooterHitch::AddEvent(EShooterHitchEvent::ItemState, this, StaticEnum<EItemState>()->GetNameByValue(static_cast<int64>(State)));
 		SetItemProperties(State);
+		UpdateNetDormancy();
+
+		// The forced tier depends on ItemState, don't wait for the next significance pass
+		UShooterSignificanceManager* SignificanceManager = GetWorld()->GetSubsystem<UShooterSignificanceManager>();
+		if (SignificanceManager)
+		{
+			SignificanceManager->RefreshActor(this);
+		}
 	}
 
+bool AItem::GetForcedSignificanceTier(ESignificanceTier& OutTier) const
+{
+	switch (ItemState)
+	{
+	case EItemState::EIS_EquipInterping:
+	case EItemState::EIS_Equipped:
+	case EItemState::EIS_Falling:
+		OutTier = ESignificanceTier::EST_High;
+		return true;
+
+	case EItemState::EIS_PickedUp:
+		// Hidden in the weapon pool, nothing to update until it is equipped again
+		OutTier = ESignificanceTier::EST_Dormant;
+		return true;
+
+	default:
+		return false;
+	}
+}
+
 void AItem::StartItemCurve(AShooterCharacter* Char)
 {
 	// Store handle for the Character
@@ -266,10 +401,24 @@ void AItem::StartItemCurve(AShooterCharacter* Char)
 	// Store inital location of the Item
 	ItemInterpStartLocation = GetActorLocation();
 
+	if (!bInterping)
+	{
+		ShooterStats::AddInterpingItems(1);
+	}
 	bInterping = true;
 	SetItemState(EItemState::EIS_EquipInterping);
-
-	GetWorldTimerManager().SetTimer(ItemInterpTimer, this, &AItem::FinishInterping, ZCurveTime);
+	SHOOTER_TRACE(ItemCurve, this, true);
+
+	// Stepped by the combat clock until ZCurveTime has passed on it
+	ItemInterpElapsed = 0.f;
+	PreviousItemInterpElapsed = 0.f;
+	ItemInterpLocation = ItemInterpStartLocation;
+	PreviousItemInterpLocation = ItemInterpStartLocation;
+	UShooterCombatClock* CombatClock = GetWorld()->GetSubsystem<UShooterCombatClock>();
+	if (CombatClock)
+	{
+		CombatClock->Register(this);
+	}
 
 	const float CameraRotationYaw{ Character->GetFollowCamera()->GetComponentRotation().Yaw };
 	const float ItemRotationYaw{ GetActorRotation().Yaw };
@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "SignificanceInterface.h"
+#include "CombatSimInterface.h"
 #include "Item.generated.h"
 
 /*
@@ -30,7 +32,7 @@ enum class EItemState : uint8
 };
 
 UCLASS()
-class SHOOTER_API AItem : public AActor
+class SHOOTER_API AItem : public AActor, public ISignificanceInterface, public ICombatSimInterface
 {
 	GENERATED_BODY()
 	
@@ -44,6 +46,13 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	UFUNCTION()
+	void OnRep_ItemState();
+
 	/* Called when overlapping AreaSphere */
 	UFUNCTION()
 	void OnSphereOverlap(UPrimitiveComponent* OverlappedComponent,
@@ -63,11 +72,14 @@ protected:
 	/* Sets properties of the Item's components based on State */
 	void SetItemProperties(EItemState State);
 
-	/* Called when ItemInterpTimer is finished */
+	/* Server only, dormant while the item lies as a pickup or waits in the weapon pool */
+	void UpdateNetDormancy();
+
+	/* Called once the item has been on its curve for ZCurveTime */
 	void FinishInterping();
 
-	/* Handles item Interpolation when in the EquipInterping state */
-	void ItemInterp(float DeltaTime);
+	/* One combat step of the item's curve toward the camera, while in the EquipInterping state */
+	void ItemInterp(float StepTime);
 
 public:	
 	// Called every frame
@@ -75,6 +87,14 @@ public:
 
 	void PlayEquipSound(bool bForcePlaySound = false);
 
+	/* Items that are held, flying to the camera or falling are never throttled */
+	virtual bool GetForcedSignificanceTier(ESignificanceTier& OutTier) const override;
+
+	/* ICombatSimInterface: the item curve, stepped from StartItemCurve until FinishInterping */
+	virtual bool CombatStep(float StepTime, double SimTime) override;
+	virtual void CombatPresent(float Alpha) override;
+	virtual uint32 GetCombatStateHash() const override;
+
 
 private:
 
@@ -102,8 +122,8 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Item Properties", meta = (AllowPrivateAccess = "true"))
 	int32 ItemCount;
 
-	/* State of the item */
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Item Properties", meta = (AllowPrivateAccess = "true"))
+	/* State of the item. Items lying in EIS_Pickup or pooled in EIS_PickedUp are net dormant, every other state keeps them awake */
+	UPROPERTY(ReplicatedUsing = OnRep_ItemState, VisibleAnywhere, BlueprintReadOnly, Category = "Item Properties", meta = (AllowPrivateAccess = "true"))
 	EItemState ItemState;
 	
 	/* The curve asset to use for the item's Z location when interping */
@@ -122,8 +142,13 @@ private:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Item Properties", meta = (AllowPrivateAccess = "true"))
 	bool bInterping;
 
-	/* Plays when we start interping */
-	FTimerHandle ItemInterpTimer;
+	/* Time on the curve as of the last combat step and the one before */
+	float ItemInterpElapsed;
+	float PreviousItemInterpElapsed;
+
+	/* Location on the curve as of the last combat step and the one before, the actor is drawn in between */
+	FVector ItemInterpLocation;
+	FVector PreviousItemInterpLocation;
 
 	/* Duration of the curve and timer */
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Item Properties", meta = (AllowPrivateAccess = "true"))
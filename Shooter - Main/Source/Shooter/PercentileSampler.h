@@ -0,0 +1,88 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Keeps the last Capacity samples in a ring buffer and answers percentile queries over them.
+ * Queries sort a copy, so call them for reports rather than every frame.
+ */
+struct FPercentileSampler
+{
+	explicit FPercentileSampler(int32 InCapacity = 1024) :
+		Capacity(FMath::Max(InCapacity, 1)),
+		NextIndex(0),
+		TotalSamples(0)
+	{
+		Samples.Reserve(Capacity);
+	}
+
+	void AddSample(float Value)
+	{
+		if (Samples.Num() < Capacity)
+		{
+			Samples.Add(Value);
+		}
+		else
+		{
+			Samples[NextIndex] = Value;
+		}
+		NextIndex = (NextIndex + 1) % Capacity;
+		++TotalSamples;
+	}
+
+	/* Percentile in [0, 100] over the retained samples, 0 when empty */
+	float GetPercentile(float Percentile) const
+	{
+		if (Samples.Num() == 0) return 0.f;
+
+		TArray<float> Sorted{ Samples };
+		Sorted.Sort();
+
+		const int32 Index{ FMath::Clamp(FMath::CeilToInt(Percentile / 100.f * Sorted.Num()) - 1, 0, Sorted.Num() - 1) };
+		return Sorted[Index];
+	}
+
+	float GetAverage() const
+	{
+		if (Samples.Num() == 0) return 0.f;
+
+		double Sum{ 0.0 };
+		for (const float Sample : Samples)
+		{
+			Sum += Sample;
+		}
+		return static_cast<float>(Sum / Samples.Num());
+	}
+
+	float GetMax() const
+	{
+		return Samples.Num() > 0 ? FMath::Max(Samples) : 0.f;
+	}
+
+	void Reset()
+	{
+		Samples.Reset();
+		NextIndex = 0;
+		TotalSamples = 0;
+	}
+
+	FORCEINLINE int32 Num() const { return Samples.Num(); }
+
+	/* Samples added since the last Reset, including those overwritten */
+	FORCEINLINE int64 GetTotalSamples() const { return TotalSamples; }
+
+	/* "p50 1.00 p90 2.00 p99 3.00 max 4.00" for logs */
+	FString ToString() const
+	{
+		return FString::Printf(TEXT("p50 %.2f p90 %.2f p99 %.2f max %.2f"),
+			GetPercentile(50.f), GetPercentile(90.f), GetPercentile(99.f), GetMax());
+	}
+
+private:
+	TArray<float> Samples;
+	int32 Capacity;
+	int32 NextIndex;
+	int64 TotalSamples;
+};
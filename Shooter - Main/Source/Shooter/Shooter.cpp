@@ -2,5 +2,18 @@
 
 #include "Shooter.h"
 #include "Modules/ModuleManager.h"
+#include "ShooterLLM.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, Shooter, "Shooter" );
+DEFINE_LOG_CATEGORY(LogShooter);
+
+class FShooterModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+		// Tags have to be registered before the first allocation scoped to them
+		LLM(ShooterLLM::RegisterTags());
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FShooterModule, Shooter, "Shooter" );
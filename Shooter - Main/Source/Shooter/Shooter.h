@@ -4,3 +4,13 @@
 
 #include "CoreMinimal.h"
 
+DECLARE_LOG_CATEGORY_EXTERN(LogShooter, Log, All);
+
+
+/* Project trace channels, declared in DefaultEngine.ini under [/Script/Engine.CollisionProfile] */
+
+/* Shots and the crosshair trace that aims them. World geometry and enemy meshes block it, pickups and capsules don't */
+#define ECC_Weapon ECC_GameTraceChannel1
+
+/* Item focus. Pickup collision boxes and world geometry block it, so items behind walls can't be focused */
+#define ECC_Interact ECC_GameTraceChannel2
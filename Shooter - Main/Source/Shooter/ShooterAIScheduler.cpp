@@ -0,0 +1,436 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterAIScheduler.h"
+#include "Shooter.h"
+#include "Enemy.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "GameFramework/PlayerController.h"
+#include "Async/Async.h"
+#include "ShooterReplaySubsystem.h"
+#include "ShooterStats.h"
+
+DECLARE_STATS_GROUP(TEXT("ShooterAI"), STATGROUP_ShooterAI, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("AI Perception"), STAT_AIPerception, STATGROUP_ShooterAI);
+DECLARE_CYCLE_STAT(TEXT("AI Decisions (game thread)"), STAT_AIDecisions, STATGROUP_ShooterAI);
+DECLARE_CYCLE_STAT(TEXT("AI Decisions (worker)"), STAT_AIDecisionsWorker, STATGROUP_ShooterAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("LOS traces"), STAT_AITraces, STATGROUP_ShooterAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Decisions applied"), STAT_AIDecisionsApplied, STATGROUP_ShooterAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Queued queries"), STAT_AIQueuedQueries, STATGROUP_ShooterAI);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Agents"), STAT_AIAgents, STATGROUP_ShooterAI);
+
+static TAutoConsoleVariable<int32> CVarAITracesPerFrame(
+	TEXT("Shooter.AI.TracesPerFrame"),
+	8,
+	TEXT("Line of sight traces run per frame across all enemies."));
+
+static TAutoConsoleVariable<int32> CVarAIDecisionsPerFrame(
+	TEXT("Shooter.AI.DecisionsPerFrame"),
+	16,
+	TEXT("Enemies whose decisions are refreshed per frame."));
+
+static TAutoConsoleVariable<float> CVarAIPerceptionInterval(
+	TEXT("Shooter.AI.PerceptionInterval"),
+	0.25f,
+	TEXT("Seconds between line of sight checks for one enemy."));
+
+static TAutoConsoleVariable<float> CVarAIDecisionInterval(
+	TEXT("Shooter.AI.DecisionInterval"),
+	0.2f,
+	TEXT("Seconds between decision updates for one enemy."));
+
+static TAutoConsoleVariable<float> CVarAIPriorityAging(
+	TEXT("Shooter.AI.PriorityAging"),
+	4000.f,
+	TEXT("Distance in cm a perception query moves up the queue per second it waits, so distant enemies still get traced."));
+
+static TAutoConsoleVariable<float> CVarAISightRadius(
+	TEXT("Shooter.AI.SightRadius"),
+	5000.f,
+	TEXT("Players further away than this are never traced for."));
+
+static TAutoConsoleVariable<int32> CVarAIDebug(
+	TEXT("Shooter.AI.Debug"),
+	0,
+	TEXT("1 shows per-frame query counts and latency percentiles on screen."));
+
+static FAutoConsoleCommandWithWorld AIReportCommand(
+	TEXT("Shooter.AI.Report"),
+	TEXT("Logs enemy AI query counts and latency percentiles."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UShooterAIScheduler* Scheduler = World ? World->GetSubsystem<UShooterAIScheduler>() : nullptr;
+		if (Scheduler)
+		{
+			Scheduler->LogReport();
+		}
+	}));
+
+namespace ShooterAI
+{
+	/* Distance at which an enemy attacks instead of chasing */
+	constexpr float AttackRange = 800.f;
+
+	/* Seconds an enemy keeps investigating after losing sight */
+	constexpr float MemoryTime = 6.f;
+
+	/* Seconds a threat keeps boosting perception priority */
+	constexpr float ThreatTime = 3.f;
+}
+
+void UShooterAIScheduler::Deinitialize()
+{
+	// Don't leave a worker writing into a dead subsystem
+	if (PendingDecisions.IsValid())
+	{
+		PendingDecisions.Wait();
+	}
+	Agents.Empty();
+	PerceptionQueue.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UShooterAIScheduler::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterAIScheduler, STATGROUP_Tickables);
+}
+
+void UShooterAIScheduler::RegisterEnemy(AEnemy* Enemy)
+{
+	if (Enemy == nullptr) return;
+	if (Agents.ContainsByPredicate([Enemy](const FEnemyAgent& Agent) { return Agent.Enemy == Enemy; })) return;
+
+	FEnemyAgent Agent;
+	Agent.Enemy = Enemy;
+
+	// Stagger the first updates so a wave doesn't land on the same frame forever after
+	const float WorldTime{ GetWorld()->GetTimeSeconds() };
+	UShooterReplaySubsystem* Replay = GetWorld()->GetSubsystem<UShooterReplaySubsystem>();
+	const float PerceptionOffset{ Replay ? Replay->GetRandomStream().FRand() : FMath::FRand() };
+	const float DecisionOffset{ Replay ? Replay->GetRandomStream().FRand() : FMath::FRand() };
+	Agent.NextPerceptionTime = WorldTime + PerceptionOffset * CVarAIPerceptionInterval.GetValueOnGameThread();
+	Agent.NextDecisionTime = WorldTime + DecisionOffset * CVarAIDecisionInterval.GetValueOnGameThread();
+
+	Agents.Add(Agent);
+}
+
+void UShooterAIScheduler::UnregisterEnemy(AEnemy* Enemy)
+{
+	const int32 AgentIndex{ Agents.IndexOfByPredicate([Enemy](const FEnemyAgent& Agent) { return Agent.Enemy == Enemy; }) };
+	if (AgentIndex != INDEX_NONE)
+	{
+		RemoveAgentAt(AgentIndex);
+	}
+
+	// No more decisions are coming, a corpse or a pooled enemy must not keep steering toward its last target
+	AEnemyController* EnemyController = Enemy ? Cast<AEnemyController>(Enemy->GetController()) : nullptr;
+	if (EnemyController)
+	{
+		EnemyController->ResetAI();
+	}
+}
+
+void UShooterAIScheduler::RemoveAgentAt(int32 AgentIndex)
+{
+	const int32 LastIndex{ Agents.Num() - 1 };
+
+	// Drop this agent's query and point the swapped agent's query at its new slot
+	PerceptionQueue.RemoveAll([AgentIndex](const FPerceptionQuery& Query) { return Query.AgentIndex == AgentIndex; });
+	for (FPerceptionQuery& Query : PerceptionQueue)
+	{
+		if (Query.AgentIndex == LastIndex)
+		{
+			Query.AgentIndex = AgentIndex;
+		}
+	}
+	PerceptionQueue.Heapify(FPerceptionQueryPredicate());
+
+	Agents.RemoveAtSwap(AgentIndex);
+	NextDecisionAgent = Agents.Num() > 0 ? NextDecisionAgent % Agents.Num() : 0;
+}
+
+void UShooterAIScheduler::ReportThreat(AEnemy* Enemy)
+{
+	const int32 AgentIndex{ Agents.IndexOfByPredicate([Enemy](const FEnemyAgent& Agent) { return Agent.Enemy == Enemy; }) };
+	if (AgentIndex == INDEX_NONE) return;
+
+	FEnemyAgent& Agent = Agents[AgentIndex];
+	const float WorldTime{ GetWorld()->GetTimeSeconds() };
+	Agent.LastThreatTime = WorldTime;
+	Agent.NextPerceptionTime = WorldTime;
+	Agent.NextDecisionTime = WorldTime;
+
+	if (!Agent.bPerceptionQueued) return;
+
+	// Already waiting with the priority it had before it was shot, boost it in place
+	FPerceptionQuery* Query = PerceptionQueue.FindByPredicate([AgentIndex](const FPerceptionQuery& Query) { return Query.AgentIndex == AgentIndex; });
+	if (Query)
+	{
+		Query->Priority = FMath::Min(Query->Priority, CalculatePriority(Agent, WorldTime));
+		PerceptionQueue.Heapify(FPerceptionQueryPredicate());
+	}
+}
+
+void UShooterAIScheduler::Tick(float DeltaTime)
+{
+	const float WorldTime{ GetWorld()->GetTimeSeconds() };
+
+	GatherPlayers();
+	EnqueuePerception(WorldTime);
+	RunPerception(WorldTime);
+	RunDecisions(WorldTime);
+
+	SET_DWORD_STAT(STAT_AIQueuedQueries, PerceptionQueue.Num());
+	SET_DWORD_STAT(STAT_AIAgents, Agents.Num());
+
+	if (CVarAIDebug.GetValueOnGameThread() > 0 && GEngine)
+	{
+		GEngine->AddOnScreenDebugMessage(
+			reinterpret_cast<uint64>(this),
+			0.f,
+			FColor::White,
+			FString::Printf(TEXT("AI agents %d, traces %d, decisions %d, queued %d, perception latency ms %s"),
+				Agents.Num(), TracesLastFrame, DecisionsLastFrame, PerceptionQueue.Num(), *PerceptionLatencyMs.ToString()));
+	}
+}
+
+void UShooterAIScheduler::GatherPlayers()
+{
+	Players.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APawn* Pawn = It->Get() ? It->Get()->GetPawn() : nullptr;
+		if (Pawn)
+		{
+			Players.Add(Pawn);
+		}
+	}
+}
+
+int32 UShooterAIScheduler::FindClosestPlayer(const FVector& Location) const
+{
+	int32 ClosestIndex{ INDEX_NONE };
+	float ClosestDistanceSquared{ TNumericLimits<float>::Max() };
+	for (int32 PlayerIndex = 0; PlayerIndex < Players.Num(); ++PlayerIndex)
+	{
+		const float DistanceSquared{ FVector::DistSquared(Location, Players[PlayerIndex]->GetActorLocation()) };
+		if (DistanceSquared < ClosestDistanceSquared)
+		{
+			ClosestDistanceSquared = DistanceSquared;
+			ClosestIndex = PlayerIndex;
+		}
+	}
+	return ClosestIndex;
+}
+
+double UShooterAIScheduler::CalculatePriority(const FEnemyAgent& Agent, float WorldTime) const
+{
+	// Nearest enemies first, halved again when they were shot recently
+	const int32 PlayerIndex{ FindClosestPlayer(Agent.Enemy->GetActorLocation()) };
+	float Distance{ PlayerIndex != INDEX_NONE ? FVector::Dist(Agent.Enemy->GetActorLocation(), Players[PlayerIndex]->GetActorLocation()) : BIG_NUMBER };
+
+	if (WorldTime - Agent.LastThreatTime < ShooterAI::ThreatTime)
+	{
+		Distance *= 0.5f;
+	}
+
+	// Distance minus time waited times the aging rate. The time is added at queue time rather than subtracted as it passes,
+	// every query would lose the same amount each frame, so the heap order holds without re-sorting
+	return Distance + static_cast<double>(WorldTime) * CVarAIPriorityAging.GetValueOnGameThread();
+}
+
+void UShooterAIScheduler::EnqueuePerception(float WorldTime)
+{
+	const double Now{ FPlatformTime::Seconds() };
+	for (int32 AgentIndex = Agents.Num() - 1; AgentIndex >= 0; --AgentIndex)
+	{
+		FEnemyAgent& Agent = Agents[AgentIndex];
+		if (!Agent.Enemy.IsValid())
+		{
+			RemoveAgentAt(AgentIndex);
+			continue;
+		}
+
+		if (Agent.bPerceptionQueued || WorldTime < Agent.NextPerceptionTime) continue;
+
+		Agent.bPerceptionQueued = true;
+		PerceptionQueue.HeapPush({ AgentIndex, CalculatePriority(Agent, WorldTime), Now }, FPerceptionQueryPredicate());
+	}
+}
+
+void UShooterAIScheduler::RunPerception(float WorldTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AIPerception);
+
+	const int32 TraceBudget{ CVarAITracesPerFrame.GetValueOnGameThread() };
+	const float SightRadiusSquared{ FMath::Square(CVarAISightRadius.GetValueOnGameThread()) };
+	const float PerceptionInterval{ CVarAIPerceptionInterval.GetValueOnGameThread() };
+
+	TracesLastFrame = 0;
+	while (PerceptionQueue.Num() > 0 && TracesLastFrame < TraceBudget)
+	{
+		FPerceptionQuery Query;
+		PerceptionQueue.HeapPop(Query, FPerceptionQueryPredicate(), false);
+
+		FEnemyAgent& Agent = Agents[Query.AgentIndex];
+		Agent.bPerceptionQueued = false;
+		Agent.NextPerceptionTime = WorldTime + PerceptionInterval;
+
+		AEnemy* Enemy = Agent.Enemy.Get();
+		if (Enemy == nullptr) continue;
+
+		Agent.bHasLineOfSight = false;
+		Agent.TargetPlayerIndex = FindClosestPlayer(Enemy->GetActorLocation());
+		if (Agent.TargetPlayerIndex == INDEX_NONE) continue;
+
+		APawn* Target = Players[Agent.TargetPlayerIndex];
+		FVector EyeLocation;
+		FRotator EyeRotation;
+		Enemy->GetActorEyesViewPoint(EyeLocation, EyeRotation);
+		const FVector TargetLocation{ Target->GetPawnViewLocation() };
+
+		// Out of sight range costs no trace
+		if (FVector::DistSquared(EyeLocation, TargetLocation) > SightRadiusSquared) continue;
+
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(EnemyLineOfSight), false, Enemy);
+		FHitResult HitResult;
+		GetWorld()->LineTraceSingleByChannel(HitResult, EyeLocation, TargetLocation, ECollisionChannel::ECC_Visibility, QueryParams);
+		ShooterStats::AddTraces();
+		++TracesLastFrame;
+
+		PerceptionLatencyMs.AddSample(static_cast<float>((FPlatformTime::Seconds() - Query.EnqueueTime) * 1000.0));
+
+		if (!HitResult.bBlockingHit || HitResult.GetActor() == Target)
+		{
+			Agent.bHasLineOfSight = true;
+			Agent.LastSeenLocation = Target->GetActorLocation();
+			Agent.LastSeenTime = WorldTime;
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_AITraces, TracesLastFrame);
+}
+
+void UShooterAIScheduler::RunDecisions(float WorldTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AIDecisions);
+
+	DecisionsLastFrame = 0;
+
+	// Apply last frame's batch once the worker is done with it
+	if (PendingDecisions.IsValid())
+	{
+		if (!PendingDecisions.IsReady()) return;
+
+		const TArray<FEnemyDecision> Decisions = PendingDecisions.Get();
+		PendingDecisions = TFuture<TArray<FEnemyDecision>>();
+
+		for (int32 Index = 0; Index < Decisions.Num(); ++Index)
+		{
+			AEnemy* Enemy = PendingDecisionEnemies[Index].Get();
+			AEnemyController* EnemyController = Enemy ? Cast<AEnemyController>(Enemy->GetController()) : nullptr;
+			if (EnemyController == nullptr || Enemy->IsDying()) continue;
+
+			const FEnemyDecision& Decision = Decisions[Index];
+			APawn* TargetPawn = PendingDecisionPlayers.IsValidIndex(Decision.TargetPlayerIndex) ? PendingDecisionPlayers[Decision.TargetPlayerIndex].Get() : nullptr;
+			EnemyController->ApplyDecision(Decision, TargetPawn);
+			++DecisionsLastFrame;
+		}
+
+		DecisionLatencyMs.AddSample(static_cast<float>((FPlatformTime::Seconds() - PendingDecisionStartTime) * 1000.0));
+		INC_DWORD_STAT_BY(STAT_AIDecisionsApplied, DecisionsLastFrame);
+	}
+
+	if (Agents.Num() == 0) return;
+
+	// Snapshot a round robin slice of due agents into plain data for the worker
+	const int32 DecisionBudget{ FMath::Min(CVarAIDecisionsPerFrame.GetValueOnGameThread(), Agents.Num()) };
+	const float DecisionInterval{ CVarAIDecisionInterval.GetValueOnGameThread() };
+
+	TArray<FEnemyDecisionInput> Inputs;
+	Inputs.Reserve(DecisionBudget);
+	PendingDecisionEnemies.Reset();
+
+	for (int32 Visited = 0; Visited < Agents.Num() && Inputs.Num() < DecisionBudget; ++Visited)
+	{
+		FEnemyAgent& Agent = Agents[NextDecisionAgent];
+		NextDecisionAgent = (NextDecisionAgent + 1) % Agents.Num();
+
+		AEnemy* Enemy = Agent.Enemy.Get();
+		if (Enemy == nullptr || Enemy->IsDying() || WorldTime < Agent.NextDecisionTime) continue;
+
+		Agent.NextDecisionTime = WorldTime + DecisionInterval;
+
+		FEnemyDecisionInput Input;
+		Input.Location = Enemy->GetActorLocation();
+		Input.HealthFraction = Enemy->GetHealth() / FMath::Max(Enemy->GetMaxHealth(), 1.f);
+		Input.bHasLineOfSight = Agent.bHasLineOfSight;
+		Input.LastSeenLocation = Agent.LastSeenLocation;
+		Input.TimeSinceSeen = WorldTime - Agent.LastSeenTime;
+		Input.TargetPlayerIndex = Players.IsValidIndex(Agent.TargetPlayerIndex) ? Agent.TargetPlayerIndex : INDEX_NONE;
+		Input.TargetLocation = Input.TargetPlayerIndex != INDEX_NONE ? Players[Input.TargetPlayerIndex]->GetActorLocation() : FVector::ZeroVector;
+
+		Inputs.Add(Input);
+		PendingDecisionEnemies.Add(Enemy);
+	}
+
+	if (Inputs.Num() == 0) return;
+
+	PendingDecisionPlayers.Reset();
+	for (APawn* Player : Players)
+	{
+		PendingDecisionPlayers.Add(Player);
+	}
+
+	PendingDecisionStartTime = FPlatformTime::Seconds();
+	PendingDecisions = Async(EAsyncExecution::TaskGraph, [Inputs = MoveTemp(Inputs)]()
+	{
+		SCOPE_CYCLE_COUNTER(STAT_AIDecisionsWorker);
+
+		TArray<FEnemyDecision> Decisions;
+		Decisions.Reserve(Inputs.Num());
+		for (const FEnemyDecisionInput& Input : Inputs)
+		{
+			Decisions.Add(Decide(Input));
+		}
+		return Decisions;
+	});
+}
+
+FEnemyDecision UShooterAIScheduler::Decide(const FEnemyDecisionInput& Input)
+{
+	// Runs on a worker thread: only Input may be read here, never a UObject
+	FEnemyDecision Decision;
+	Decision.TargetPlayerIndex = Input.TargetPlayerIndex;
+
+	if (Input.bHasLineOfSight && Input.TargetPlayerIndex != INDEX_NONE)
+	{
+		const bool bInRange{ FVector::DistSquared(Input.Location, Input.TargetLocation) < FMath::Square(ShooterAI::AttackRange) };
+		Decision.State = bInRange ? EEnemyAIState::EAS_Attack : EEnemyAIState::EAS_Chase;
+		Decision.TargetLocation = Input.TargetLocation;
+	}
+	else if (Input.TimeSinceSeen < ShooterAI::MemoryTime)
+	{
+		// Lost sight, go to where the player was last seen
+		Decision.State = EEnemyAIState::EAS_Investigate;
+		Decision.TargetLocation = Input.LastSeenLocation;
+	}
+	else
+	{
+		Decision.State = EEnemyAIState::EAS_Idle;
+		Decision.TargetLocation = Input.Location;
+	}
+	return Decision;
+}
+
+void UShooterAIScheduler::LogReport() const
+{
+	UE_LOG(LogShooter, Log, TEXT("AI scheduler: %d agents, %d queued queries, last frame %d traces and %d decisions"),
+		Agents.Num(), PerceptionQueue.Num(), TracesLastFrame, DecisionsLastFrame);
+	UE_LOG(LogShooter, Log, TEXT("AI perception latency ms (%lld queries): %s"),
+		PerceptionLatencyMs.GetTotalSamples(), *PerceptionLatencyMs.ToString());
+	UE_LOG(LogShooter, Log, TEXT("AI decision latency ms (%lld batches): %s"),
+		DecisionLatencyMs.GetTotalSamples(), *DecisionLatencyMs.ToString());
+}
@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShooterTickableWorldSubsystem.h"
+#include "Async/Future.h"
+#include "EnemyController.h"
+#include "PercentileSampler.h"
+#include "ShooterAIScheduler.generated.h"
+
+class AEnemy;
+
+/* Game thread snapshot of one enemy, the only thing decision tasks are allowed to read */
+struct FEnemyDecisionInput
+{
+	FVector Location;
+	float HealthFraction;
+	bool bHasLineOfSight;
+	FVector LastSeenLocation;
+	float TimeSinceSeen;
+	int32 TargetPlayerIndex;
+	FVector TargetLocation;
+};
+
+/**
+ * Runs perception and decisions for every enemy on a fixed per-frame budget.
+ * Line of sight queries share one priority queue, nearest first and aged by time waited, and only Shooter.AI.TracesPerFrame run each frame.
+ * Decisions are batched onto a worker task from plain snapshots and applied on the game thread a frame later.
+ */
+UCLASS()
+class SHOOTER_API UShooterAIScheduler : public UShooterTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	/* FTickableGameObject interface */
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterEnemy(AEnemy* Enemy);
+
+	/* Stops scheduling Enemy and resets its controller, on death, pooling and EndPlay */
+	void UnregisterEnemy(AEnemy* Enemy);
+
+	/* Moves the enemy up the perception queue, e.g. after it was shot, whether or not its query is already waiting */
+	void ReportThreat(AEnemy* Enemy);
+
+	/* Logs query counts and latency percentiles */
+	void LogReport() const;
+
+	FORCEINLINE int32 GetTracesLastFrame() const { return TracesLastFrame; }
+	FORCEINLINE int32 GetDecisionsLastFrame() const { return DecisionsLastFrame; }
+	FORCEINLINE int32 GetQueuedQueries() const { return PerceptionQueue.Num(); }
+	FORCEINLINE const FPercentileSampler& GetPerceptionLatency() const { return PerceptionLatencyMs; }
+	FORCEINLINE const FPercentileSampler& GetDecisionLatency() const { return DecisionLatencyMs; }
+
+private:
+
+	struct FEnemyAgent
+	{
+		TWeakObjectPtr<AEnemy> Enemy;
+
+		/* Perception results */
+		bool bHasLineOfSight = false;
+		int32 TargetPlayerIndex = INDEX_NONE;
+		FVector LastSeenLocation = FVector::ZeroVector;
+		float LastSeenTime = -BIG_NUMBER;
+
+		/* Scheduling */
+		bool bPerceptionQueued = false;
+		float NextPerceptionTime = 0.f;
+		float NextDecisionTime = 0.f;
+
+		/* Extra priority after being shot, decays with time */
+		float LastThreatTime = -BIG_NUMBER;
+	};
+
+	struct FPerceptionQuery
+	{
+		int32 AgentIndex;
+
+		/* Lower runs first. Includes the time it was queued at, so waiting queries age ahead of newer ones */
+		double Priority;
+
+		double EnqueueTime;
+	};
+
+	struct FPerceptionQueryPredicate
+	{
+		bool operator()(const FPerceptionQuery& A, const FPerceptionQuery& B) const { return A.Priority < B.Priority; }
+	};
+
+	/* Queue agents whose perception interval elapsed */
+	void EnqueuePerception(float WorldTime);
+
+	/* Run at most TracesPerFrame line of sight traces from the queue */
+	void RunPerception(float WorldTime);
+
+	/* Apply finished decisions and kick off the next batch */
+	void RunDecisions(float WorldTime);
+
+	/* Pure decision logic, runs on a worker thread */
+	static FEnemyDecision Decide(const FEnemyDecisionInput& Input);
+
+	double CalculatePriority(const FEnemyAgent& Agent, float WorldTime) const;
+
+	void GatherPlayers();
+
+	int32 FindClosestPlayer(const FVector& Location) const;
+
+	void RemoveAgentAt(int32 AgentIndex);
+
+	TArray<FEnemyAgent> Agents;
+
+	/* Heap ordered by FPerceptionQueryPredicate */
+	TArray<FPerceptionQuery> PerceptionQueue;
+
+	/* Player pawns this frame, indexed by TargetPlayerIndex */
+	UPROPERTY()
+	TArray<APawn*> Players;
+
+	/* Round robin cursor for decision updates */
+	int32 NextDecisionAgent = 0;
+
+	/* Decision batch in flight, applied on a later frame. Results line up with PendingDecisionEnemies */
+	TFuture<TArray<FEnemyDecision>> PendingDecisions;
+	TArray<TWeakObjectPtr<AEnemy>> PendingDecisionEnemies;
+
+	/* Players as they were when the batch was launched */
+	TArray<TWeakObjectPtr<APawn>> PendingDecisionPlayers;
+	double PendingDecisionStartTime = 0.0;
+
+	int32 TracesLastFrame = 0;
+	int32 DecisionsLastFrame = 0;
+
+	/* Time from queueing a query to its trace, in ms */
+	FPercentileSampler PerceptionLatencyMs{ 2048 };
+
+	/* Time from launching a decision batch to applying it, in ms */
+	FPercentileSampler DecisionLatencyMs{ 512 };
+};
@@ -8,6 +8,7 @@
 #include "Kismet/KismetMathLibrary.h"
 #include "Weapon.h"
 #include "WeaponType.h"
+#include "ShooterStats.h"
 
 UShooterAnimInstance::UShooterAnimInstance() :
 	Speed(0.f),
@@ -34,6 +35,8 @@ UShooterAnimInstance::UShooterAnimInstance() :
 
 void  UShooterAnimInstance::UpdateAnimationPorperties(float DeltaTime) 
 {
+	SCOPE_CYCLE_COUNTER(STAT_ShooterUpdateAnimationProperties);
+	CSV_SCOPED_TIMING_STAT(Shooter, UpdateAnimationProperties);
 
 
 	if (ShooterCharacter == nullptr) 
@@ -112,6 +115,8 @@ void UShooterAnimInstance::NativeInitializeAnimation()
 
 void UShooterAnimInstance::TurnInPlace()
 {
+	SCOPE_CYCLE_COUNTER(STAT_ShooterTurnInPlace);
+	CSV_SCOPED_TIMING_STAT(Shooter, TurnInPlace);
 	if (ShooterCharacter == nullptr) return;
 
 	Pitch = ShooterCharacter->GetBaseAimRotation().Pitch;
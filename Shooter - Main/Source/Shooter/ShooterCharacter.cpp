@@ -17,7 +17,70 @@
 #include "Components/BoxComponent.h"
 #include "BulletHitInterface.h"
 #include "Enemy.h"
+#include "Shooter.h"
+#include "GameFramework/GameStateBase.h"
+#include "EngineUtils.h"
+#include "UObject/CoreNet.h"
+#include "Net/UnrealNetwork.h"
+#include "ShooterStats.h"
+#include "ShooterLLM.h"
+#include "ShooterHitchMonitor.h"
+#include "ShooterTrace.h"
+#include "ShooterGrenade.h"
+#include "ShooterImpactSubsystem.h"
+#include "ShooterWeaponPool.h"
+#include "ShooterSpread.h"
+#include "ShooterReplaySubsystem.h"
+#include "ShooterCombatClock.h"
+
+static TAutoConsoleVariable<int32> CVarFireFreshView(
+	TEXT("Shooter.Fire.FreshView"),
+	1,
+	TEXT("1 resolves shots along this frame's control rotation, 0 along last frame's camera."));
+
+static TAutoConsoleVariable<int32> CVarFireDispersion(
+	TEXT("Shooter.Fire.Dispersion"),
+	1,
+	TEXT("1 applies the weapon's recoil pattern and spread cone to shots, 0 fires every shot dead center."));
+
+// Maps ground speed to the 0..1 velocity part of the crosshair spread
+static float GetVelocitySpreadFactor(float Speed)
+{
+	return FMath::GetMappedRangeValueClamped(FVector2D{ 0.f, 600.f }, FVector2D{ 0.f, 1.f }, Speed);
+}
 
+static FAutoConsoleCommandWithWorld NetReportCommand(
+	TEXT("Shooter.Net.Report"),
+	TEXT("Logs bytes per shot, rejected shots and ammo corrections of every character. Run it on the server and on clients."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		for (TActorIterator<AShooterCharacter> It(World); It; ++It)
+		{
+			It->LogNetStats();
+		}
+	}));
+
+int32 FShotRequest::GetNumBits() const
+{
+	// Serialize the members the same way the RPC does
+	FNetBitWriter Writer(nullptr, 256);
+	bool bSuccess{ true };
+	FVector_NetQuantize OriginCopy{ Origin };
+	FVector_NetQuantizeNormal DirectionCopy{ Direction };
+	float TimestampCopy{ Timestamp };
+	uint8 SeqCopy{ Seq };
+	uint8 AmmoCopy{ PredictedAmmo };
+	uint8 SpreadCopy{ Spread };
+	uint8 BurstCopy{ BurstIndex };
+	OriginCopy.NetSerialize(Writer, nullptr, bSuccess);
+	DirectionCopy.NetSerialize(Writer, nullptr, bSuccess);
+	Writer << TimestampCopy;
+	Writer << SeqCopy;
+	Writer << AmmoCopy;
+	Writer << SpreadCopy;
+	Writer << BurstCopy;
+	return static_cast<int32>(Writer.GetNumBits());
+}
 
 // Sets default values
 AShooterCharacter::AShooterCharacter() :
@@ -30,8 +93,13 @@ AShooterCharacter::AShooterCharacter() :
 	CameraZoomedFOV(35.f),
 	CameraCurrentFOV(0.f),
 	ZoomInterpSpeed(20.f),
+	bCameraZoomActive(true),
+	bCrosshairSpreadActive(true),
+	CrosshairLastSpeed(0.f),
 	// Crosshair spread factors
 	CrosshairSpreadMultiplier(0.f),
+	PreviousCrosshairSpreadMultiplier(0.f),
+	CrosshairPresentAlpha(1.f),
 	CrosshairVelocityFactor(0.f),
 	CrosshairInAirFactor(0.f),
 	CrosshairAimFactor(0.f),
@@ -39,6 +107,28 @@ AShooterCharacter::AShooterCharacter() :
 	// Automatic fire variables
 	bShouldfire(true),
 	bFireButtonPressed(false),
+	AutoFireSimTime(0.0),
+	ShotInputTime(0.0),
+	AutoFireDueTime(0.0),
+	ShotCount(0),
+	InputToTraceMs(1024),
+	InputToFXMs(1024),
+	ShotSeq(0),
+	SpreadSeed(0),
+	ShotBurstIndex(0),
+	ShotSpread(0),
+	LastShotTime(-BIG_NUMBER),
+	LastReceivedShotSeq(0),
+	LastServerShotTime(-BIG_NUMBER),
+	ServerBurstIndex(0),
+	ShotOriginTolerance(150.f),
+	PickupRange(500.f),
+	ShotsSent(0),
+	ShotBitsSent(0),
+	ClientCorrections(0),
+	ServerShotsReceived(0),
+	ServerShotsRejected(0),
+	ServerCorrections(0),
 	// Item trace variables
 	bShouldTraceForItems(false),
 	// CameraInterp variables
@@ -47,10 +137,13 @@ AShooterCharacter::AShooterCharacter() :
 	// Bullet fire timer variables
 	ShootTimeDuration(0.05f),
 	bFiringBullet(false),
+	bDryFire(false),
+	CrosshairShootEndTime(0.0),
 	bFreeAim(false),
 	// Starting ammo amounts
 	Starting9mmAmmo(85),
 	StartingARAmmo(120),
+	StartingGrenadeAmmo(4),
 	CombatState(ECombatState::ECS_Unoccupied),
 	BaseMovementSpeed(650.f),
 	CrouchMovementSpeed(300.f),
@@ -60,6 +153,8 @@ AShooterCharacter::AShooterCharacter() :
  	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	CarriedAmmo.Init(0, static_cast<int32>(EAmmoType::ECS_NAX));
+	InventorySlots.Owner = this;
 
 	// Create a camera boom (pulls in towards the character if there is a collision)
 	CameraBoom = CreateDefaultSubobject<USpringArmComponent>(TEXT("CameraBoom"));
@@ -104,11 +199,24 @@ void AShooterCharacter::BeginPlay()
 
 	GetCharacterMovement()->MaxWalkSpeed = BaseMovementSpeed;
 	
-	// Spawn the DefaultWeapon and Equip it
-	EquipWeapon(SpawnDefaultWeapon());
-	Inventory.Add(EquippedWeapon);
-	EquippedWeapon->SetSlotIndex(0);
-	InitializeAmmoMap();
+	// Spawn the DefaultWeapon and Equip it. Clients get it through OnRep_EquippedWeapon
+	if (HasAuthority())
+	{
+		EquipWeapon(SpawnDefaultWeapon());
+		SetInventoryWeapon(0, EquippedWeapon, true);
+
+		// Drawn from the replay stream so a replayed session fires the same spread
+		UShooterReplaySubsystem* Replay = GetWorld()->GetSubsystem<UShooterReplaySubsystem>();
+		SpreadSeed = Replay ? static_cast<int32>(Replay->GetRandomStream().GetUnsignedInt()) : FMath::Rand();
+	}
+	InitializeCarriedAmmo();
+
+	// Fire timers and crosshair spread run on the combat clock's fixed step
+	UShooterCombatClock* CombatClock = GetWorld()->GetSubsystem<UShooterCombatClock>();
+	if (CombatClock)
+	{
+		CombatClock->Register(this);
+	}
 	
 }
 
@@ -162,13 +270,38 @@ void AShooterCharacter::FireWeapon()
 
 	if (WeaponHasAmmo())
 	{
-		PlayFireSound();
-		SendBullet();
-		PlayGunfireMontage();
+		SHOOTER_TRACE(Fire, this, EquippedWeapon);
+		const FRotator ShotOffset{ PrepareShot() };
+		if (!bDryFire)
+		{
+			PlayFireSound();
+			if (EquippedWeapon->GetWeaponType() == EWeaponType::EWT_Grenade)
+			{
+				// Grenades are replicated actors, clients wait for the one the server throws
+				if (HasAuthority())
+				{
+					FVector Start;
+					FVector Direction;
+					GetShotViewRay(Start, Direction);
+					ThrowGrenade(Start, Direction);
+				}
+			}
+			else
+			{
+				SendBullet(ShotOffset);
+			}
+			PlayGunfireMontage();
+		}
 		StartCrosshairBulletFire();
 		EquippedWeapon->DecreaseAmmo();
 		StartFireTimer();
 
+		// Clients only predict the shot, the server resolves it again and applies the damage
+		if (!HasAuthority() && !bDryFire)
+		{
+			SendShotToServer();
+		}
+
 		if (EquippedWeapon->GetWeaponType() == EWeaponType::EWT_Pistol)
 		{
 			// start moving slide timer
@@ -178,12 +311,37 @@ void AShooterCharacter::FireWeapon()
 
 }
 
-bool AShooterCharacter::GetBeamEndLocation(const FVector& MuzzleSocketLocation, FHitResult& OutHitResult)
+FRotator AShooterCharacter::PrepareShot()
+{
+	++ShotSeq;
+
+	// A pause longer than the recovery time lets the weapon settle, the next shot starts a new burst.
+	// Timed on the combat clock, shots fire on its steps and land in the same bursts at any frame rate
+	const UShooterCombatClock* CombatClock = GetWorld()->GetSubsystem<UShooterCombatClock>();
+	const double Now{ CombatClock ? CombatClock->GetSimTime() : GetWorld()->GetTimeSeconds() };
+	ShotBurstIndex = Now - LastShotTime > EquippedWeapon->GetRecoilRecoveryTime() ? 0 : static_cast<uint8>(FMath::Min(ShotBurstIndex + 1, 255));
+	LastShotTime = Now;
+
+	ShotSpread = ShooterSpread::QuantizeSpread(CrosshairSpreadMultiplier);
+
+	if (CVarFireDispersion.GetValueOnGameThread() == 0) return FRotator::ZeroRotator;
+
+	return ShooterSpread::GetShotOffset(EquippedWeapon->GetRecoilOffsets(), EquippedWeapon->GetSpreadDegrees(), SpreadSeed, ShotSeq, ShotBurstIndex, ShotSpread);
+}
+
+bool AShooterCharacter::GetBeamEndLocation(const FVector& MuzzleSocketLocation, const FRotator& ShotOffset, FHitResult& OutHitResult)
 {
 	// Check for crosshair trace hit
 	FHitResult CrosshairHitResult;
 	FVector OutBeamLocation;
-	bool bCrosshairHit = TraceUnderCrosshairs(CrosshairHitResult, OutBeamLocation);
+	bool bCrosshairHit = CVarFireFreshView.GetValueOnGameThread() != 0 ?
+		TraceFromFreshView(CrosshairHitResult, OutBeamLocation, ShotOffset) :
+		TraceUnderCrosshairs(CrosshairHitResult, OutBeamLocation, ECC_Weapon, ShotOffset);
+
+	if (ShotInputTime > 0.0)
+	{
+		InputToTraceMs.AddSample(static_cast<float>((FPlatformTime::Seconds() - ShotInputTime) * 1000.0));
+	}
 
 	if (bCrosshairHit)
 	{
@@ -200,7 +358,10 @@ bool AShooterCharacter::GetBeamEndLocation(const FVector& MuzzleSocketLocation,
 	const FVector WeaponTraceStart{ MuzzleSocketLocation };
 	const FVector StartToEnd{ OutBeamLocation - MuzzleSocketLocation };
 	const FVector WeaponTraceEnd{ MuzzleSocketLocation + StartToEnd * 1.25f};
-	GetWorld()->LineTraceSingleByChannel(OutHitResult, WeaponTraceStart, WeaponTraceEnd, ECollisionChannel::ECC_Visibility);
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(WeaponTrace));
+	QueryParams.bReturnPhysicalMaterial = true;
+	GetWorld()->LineTraceSingleByChannel(OutHitResult, WeaponTraceStart, WeaponTraceEnd, ECC_Weapon, QueryParams);
+	ShooterStats::AddTraces();
 
 	if (!OutHitResult.bBlockingHit) // object between barrel and BeamEndPoint?
 	{
@@ -242,86 +403,115 @@ void AShooterCharacter::FreeAimButtonReleased()
 
 void AShooterCharacter::CameraInterpZoom(float DeltaTime)
 {
+	// Zoomed FOV when aiming, default FOV otherwise
+	const float TargetFOV{ bAiming ? CameraZoomedFOV : CameraDefaultFOV };
+
 	// Set current camera field of view
-	if (bAiming)
-	{
-		// Interpolate to zoomed FOV
-		CameraCurrentFOV = FMath::FInterpTo(CameraCurrentFOV, CameraZoomedFOV, DeltaTime, ZoomInterpSpeed);
+	CameraCurrentFOV = FMath::FInterpTo(CameraCurrentFOV, TargetFOV, DeltaTime, ZoomInterpSpeed);
 
-	}
-	else
+	if (FMath::IsNearlyEqual(CameraCurrentFOV, TargetFOV, 0.01f))
 	{
-		// Interpolate to default FOV
-		CameraCurrentFOV = FMath::FInterpTo(CameraCurrentFOV, CameraDefaultFOV, DeltaTime, ZoomInterpSpeed);
-
+		// Arrived, nothing to do until aiming changes
+		CameraCurrentFOV = TargetFOV;
+		bCameraZoomActive = false;
 	}
 	GetFollowCamera()->SetFieldOfView(CameraCurrentFOV);
 }
 
+void AShooterCharacter::WakeCameraZoom()
+{
+	bCameraZoomActive = true;
+}
+
+void AShooterCharacter::WakeCrosshairSpread()
+{
+	bCrosshairSpreadActive = true;
+}
+
+void AShooterCharacter::OnMovementModeChanged(EMovementMode PrevMovementMode, uint8 PreviousCustomMode)
+{
+	Super::OnMovementModeChanged(PrevMovementMode, PreviousCustomMode);
+
+	WakeCrosshairSpread();
+}
+
 void AShooterCharacter::CalculateCrosshairSpread(float DeltaTime)
 {
-	FVector2D WalkSpeedRange{ 0.f, 600.f };
-	FVector2D VelocityMultiplierRange{ 0.f, 1.f };
 	FVector Velocity{ GetVelocity() };
 	Velocity.Z = 0.f;
 
 	// Calculate crosshair velocity factor
-	CrosshairVelocityFactor = FMath::GetMappedRangeValueClamped(WalkSpeedRange, VelocityMultiplierRange, Velocity.Size());
-
-	// Calculate crosshair in air factor
-	if (GetCharacterMovement()->IsFalling()) // is in air?
+	CrosshairLastSpeed = Velocity.Size();
+	CrosshairVelocityFactor = GetVelocitySpreadFactor(CrosshairLastSpeed);
+
+	// Spread the crosshairs slowly while in air, shrink them rapidly while on the ground
+	const bool bInAir{ GetCharacterMovement()->IsFalling() };
+	const float InAirTarget{ bInAir ? 2.25f : 0.f };
+	CrosshairInAirFactor = FMath::FInterpTo(CrosshairInAirFactor, InAirTarget, DeltaTime, bInAir ? 2.25f : 30.f);
+
+	// Shrink crosshair a small amount very quickly when aiming, spread back to normal very quickly when not
+	const float AimTarget{ bAiming ? .5f : 0.f };
+	CrosshairAimFactor = FMath::FInterpTo(CrosshairAimFactor, AimTarget, DeltaTime, 30.f);
+
+	// bFiringBullet is true 0.05 second after firing
+	// Spread crosshairs rapidly when firing, shrink back to normal when finished firing
+	const float ShootingTarget{ bFiringBullet ? .3f : 0.f };
+	CrosshairShootingFactor = FMath::FInterpTo(CrosshairShootingFactor, ShootingTarget, DeltaTime, 60.f);
+
+	// Sleep once every factor is at rest. Speed changes are picked up in TickSubsystems,
+	// everything else wakes us through WakeCrosshairSpread
+	if (FMath::IsNearlyEqual(CrosshairInAirFactor, InAirTarget, 0.001f) &&
+		FMath::IsNearlyEqual(CrosshairAimFactor, AimTarget, 0.001f) &&
+		FMath::IsNearlyEqual(CrosshairShootingFactor, ShootingTarget, 0.001f))
 	{
-		// Spread the crosshairs slowly while in iar
-		CrosshairInAirFactor = FMath::FInterpTo(CrosshairInAirFactor, 2.25f, DeltaTime, 2.25f);
-	}
-	else // Character is on the ground
-	{
-		// Shrink the crosshairs rapidly while on the ground
-		CrosshairInAirFactor = FMath::FInterpTo(CrosshairInAirFactor, 0.f, DeltaTime, 30.f);
+		CrosshairInAirFactor = InAirTarget;
+		CrosshairAimFactor = AimTarget;
+		CrosshairShootingFactor = ShootingTarget;
+		bCrosshairSpreadActive = false;
 	}
+	
+	CrosshairSpreadMultiplier = .5f + CrosshairVelocityFactor + CrosshairInAirFactor - CrosshairAimFactor + CrosshairShootingFactor;
+}
 
-	// Calculate crosshair aim factor
-	if (bAiming) // Are we aiming?
-	{
-		// Shrink crosshair a small amount very quickly
-		CrosshairAimFactor = FMath::FInterpTo(CrosshairAimFactor, .5f, DeltaTime, 30.f);
-	}
-	else // Not aiming
-	{
-		// Spread crosshairs back to normal very quickly
-		CrosshairAimFactor = FMath::FInterpTo(CrosshairAimFactor, 0.f, DeltaTime, 30.f);
-	}
+void AShooterCharacter::StepCrosshairSpread(float StepTime)
+{
+	// Copied even while asleep, so the blend settles on the resting value
+	PreviousCrosshairSpreadMultiplier = CrosshairSpreadMultiplier;
 
-	// True 0.05 second after firing
-	if (bFiringBullet)
+	// Speed is the one spread input without an event, compare it here
+	if (!bCrosshairSpreadActive && !FMath::IsNearlyEqual(GetVelocity().Size2D(), CrosshairLastSpeed, 1.f))
 	{
-		// Spread crosshairs rapidly when firing
-		CrosshairShootingFactor = FMath::FInterpTo(CrosshairShootingFactor, .3f, DeltaTime, 60.f);
+		WakeCrosshairSpread();
 	}
-	else
+
+	// Calculate crosshair spread multiplier
+	if (bCrosshairSpreadActive)
 	{
-		// Shrink the crosshairs back to normal when finished firing
-		CrosshairShootingFactor = FMath::FInterpTo(CrosshairShootingFactor, 0.f, DeltaTime, 60.f);
+		CalculateCrosshairSpread(StepTime);
 	}
-	
-	CrosshairSpreadMultiplier = .5f + CrosshairVelocityFactor + CrosshairInAirFactor - CrosshairAimFactor + CrosshairShootingFactor;
 }
 
 void AShooterCharacter::StartCrosshairBulletFire()
 {
 	bFiringBullet = true;
+	WakeCrosshairSpread();
 
-	GetWorldTimerManager().SetTimer(CrosshairShootTimer, this, &AShooterCharacter::FinishCrosshairBulletFire, ShootTimeDuration);
+	const UShooterCombatClock* CombatClock = GetWorld()->GetSubsystem<UShooterCombatClock>();
+	CrosshairShootEndTime = (CombatClock ? CombatClock->GetSimTime() : 0.0) + ShootTimeDuration;
 }
 
 void AShooterCharacter::FinishCrosshairBulletFire()
 {
 	bFiringBullet = false;
+	WakeCrosshairSpread();
 }
 
 void AShooterCharacter::FireButtonPressed()
 {
 	bFireButtonPressed = true;
+
+	// Stamped at the press itself, the last Slate interaction could be any input at all
+	ShotInputTime = FPlatformTime::Seconds();
 	FireWeapon();
 	
 }
@@ -334,23 +524,25 @@ void AShooterCharacter::FireButtonReleased()
 void AShooterCharacter::StartFireTimer()
 {
 	if (EquippedWeapon == nullptr) return;
-	CombatState = ECombatState::ECS_FireTimerInProgress;
+	SetCombatState(ECombatState::ECS_FireTimerInProgress);
 
-	// Wait based on AutomaticFireRate, Shouldfire sets back to true
-	GetWorldTimerManager().SetTimer(AutoFireTimer,
-		this, 
-		&AShooterCharacter::AutoFireReset,
-		EquippedWeapon->GetAutoFireRate());
-	
+	// Shots only fire on combat steps, measure automatic shots from when they were due
+	AutoFireDueTime = FPlatformTime::Seconds() + EquippedWeapon->GetAutoFireRate();
+
+	// Wait based on AutomaticFireRate, CombatStep calls AutoFireReset once it has passed
+	const UShooterCombatClock* CombatClock = GetWorld()->GetSubsystem<UShooterCombatClock>();
+	AutoFireSimTime = (CombatClock ? CombatClock->GetSimTime() : 0.0) + EquippedWeapon->GetAutoFireRate();
 }
 
 void AShooterCharacter::AutoFireReset()
 {
-	CombatState = ECombatState::ECS_Unoccupied;
+	SetCombatState(ECombatState::ECS_Unoccupied);
 	if (WeaponHasAmmo())
 	{
 		// if the firebutton is still being held down call the StartFireTimer again
 		if (bFireButtonPressed) {
+			// Scripted fire has no input to measure from, its automatic shots don't either
+			ShotInputTime = ShotInputTime > 0.0 ? AutoFireDueTime : 0.0;
 			FireWeapon();
 		}
 	}
@@ -362,8 +554,10 @@ void AShooterCharacter::AutoFireReset()
 	
 }
 
-bool AShooterCharacter::TraceUnderCrosshairs(FHitResult& OutHitResult, FVector& OutHitLocation)
+bool AShooterCharacter::TraceUnderCrosshairs(FHitResult& OutHitResult, FVector& OutHitLocation, ECollisionChannel TraceChannel, const FRotator& AimOffset)
 {
+	SCOPE_CYCLE_COUNTER(STAT_ShooterTraceUnderCrosshairs);
+	CSV_SCOPED_TIMING_STAT(Shooter, TraceUnderCrosshairs);
 
 	// Get Viewport Size
 	FVector2D ViewportSize;
@@ -386,11 +580,17 @@ bool AShooterCharacter::TraceUnderCrosshairs(FHitResult& OutHitResult, FVector&
 
 	if (bScreenToWorld)
 	{
+		if (!AimOffset.IsZero())
+		{
+			CrosshairWorldDirection = (CrosshairWorldDirection.Rotation() + AimOffset).Vector();
+		}
+
 		// Trace from Crosshair world location outward
 		const FVector Start{ CrosshairWorldPosition };
 		const FVector End{ Start + CrosshairWorldDirection * 50'000.f };
 		OutHitLocation = End;
-		GetWorld()->LineTraceSingleByChannel(OutHitResult, Start, End, ECollisionChannel::ECC_Visibility);
+		GetWorld()->LineTraceSingleByChannel(OutHitResult, Start, End, TraceChannel);
+		ShooterStats::AddTraces();
 		
 		if (OutHitResult.bBlockingHit) 
 		{
@@ -401,8 +601,47 @@ bool AShooterCharacter::TraceUnderCrosshairs(FHitResult& OutHitResult, FVector&
 	return false;
 }
 
+bool AShooterCharacter::TraceFromFreshView(FHitResult& OutHitResult, FVector& OutHitLocation, const FRotator& AimOffset)
+{
+	if (Controller == nullptr) return false;
+
+	FVector Start;
+	FVector Direction;
+	GetShotViewRay(Start, Direction);
+	if (!AimOffset.IsZero())
+	{
+		Direction = (Direction.Rotation() + AimOffset).Vector();
+	}
+	const FVector End{ Start + Direction * 50'000.f };
+
+	// The ray starts next to the character rather than behind it, keep it from hitting ourselves
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(FreshViewTrace), false, this);
+
+	OutHitLocation = End;
+	GetWorld()->LineTraceSingleByChannel(OutHitResult, Start, End, ECC_Weapon, QueryParams);
+	ShooterStats::AddTraces();
+
+	if (OutHitResult.bBlockingHit)
+	{
+		OutHitLocation = OutHitResult.Location;
+		return true;
+	}
+	return false;
+}
+
+void AShooterCharacter::GetShotViewRay(FVector& OutStart, FVector& OutDirection) const
+{
+	// The camera sits on the boom's arm, which points along the control rotation. Arm length and
+	// probe collision only move the camera along that line, so start at the boom pivot plus socket offset
+	const FRotator ViewRotation{ Controller ? Controller->GetControlRotation() : GetBaseAimRotation() };
+	OutStart = CameraBoom->GetComponentLocation() + CameraBoom->TargetOffset + ViewRotation.RotateVector(CameraBoom->SocketOffset);
+	OutDirection = ViewRotation.Vector();
+}
+
 void AShooterCharacter::TraceForItems()
 {
+	SCOPE_CYCLE_COUNTER(STAT_ShooterTraceForItems);
+	CSV_SCOPED_TIMING_STAT(Shooter, TraceForItems);
 
 
 	if (bShouldTraceForItems)
@@ -410,7 +649,8 @@ void AShooterCharacter::TraceForItems()
 
 		FHitResult ItemTraceResult;
 		FVector HitLocation;
-		TraceUnderCrosshairs(ItemTraceResult, HitLocation);
+		// Only pickups and world geometry block Interact, enemies and their capsules don't get in the way
+		TraceUnderCrosshairs(ItemTraceResult, HitLocation, ECC_Interact);
 		if (ItemTraceResult.bBlockingHit)
 		{
 			TraceHitItem = Cast<AItem>(ItemTraceResult.Actor);
@@ -446,11 +686,17 @@ void AShooterCharacter::TraceForItems()
 		// No longer overlapping any items, 
 		// Item last frame should not show widget
 		TraceHitItemLastFrame->GetPickupWidget()->SetVisibility(false);
+
+		// Hidden once, nothing left to do until an item overlaps again
+		TraceHitItemLastFrame = nullptr;
 	}
 }
 
 AWeapon* AShooterCharacter::SpawnDefaultWeapon()
 {
+	SHOOTER_LLM_SCOPE(Weapons);
+	ShooterHitch::AddEvent(EShooterHitchEvent::Spawn, this, DefaultWeaponClass ? DefaultWeaponClass->GetFName() : NAME_None);
+
 	// Check the TSubclass of variable
 	if (DefaultWeaponClass)
 	{
@@ -475,25 +721,60 @@ void AShooterCharacter::EquipWeapon(AWeapon* WeaponToEquip)
 			HandSocket->AttachActor(WeaponToEquip, GetMesh());
 		}
 
-		if (EquippedWeapon == nullptr)
-		{
-			// -1 == no EquippedWeapon yet, No need to reverse the icon animation
-			EquipItemDelegate.Broadcast(-1, WeaponToEquip->GetSlotIndex());
-		}
-		else
-		{
-			EquipItemDelegate.Broadcast(EquippedWeapon->GetSlotIndex(), WeaponToEquip->GetSlotIndex());
-		}
+		// -1 == no EquippedWeapon yet, No need to reverse the icon animation
+		const int32 CurrentSlotIndex{ EquippedWeapon ? EquippedWeapon->GetSlotIndex() : -1 };
+
 		// Set EquippedWeapon to the newly spawned weapon
 		EquippedWeapon = WeaponToEquip;
 		EquippedWeapon->SetItemState(EItemState::EIS_Equipped);
+
+		// Listeners read the new EquippedWeapon straight away
+		EquipItemDelegate.Broadcast(CurrentSlotIndex, EquippedWeapon->GetSlotIndex());
+	}
+}
+
+void AShooterCharacter::OnRep_EquippedWeapon(AWeapon* PreviousWeapon)
+{
+	AWeapon* NewWeapon{ EquippedWeapon };
+
+	// The actor may come from the weapon pool, its slot and ammo are in the equipped slot's record.
+	// Only the owner has the inventory, everyone else keeps what the actor came with
+	if (NewWeapon)
+	{
+		for (int32 SlotIndex = 0; SlotIndex < Inventory.Num(); ++SlotIndex)
+		{
+			if (Inventory[SlotIndex].bEquipped && Inventory[SlotIndex].IsArchetypeOf(NewWeapon))
+			{
+				NewWeapon->SetSlotIndex(SlotIndex);
+				NewWeapon->ApplyInventoryRecord(Inventory[SlotIndex]);
+				break;
+			}
+		}
 	}
+
+	// EquipWeapon works out the slot animation from the weapon it replaces, put that one back first
+	EquippedWeapon = PreviousWeapon;
+	EquipWeapon(NewWeapon);
+}
+
+void AShooterCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AShooterCharacter, EquippedWeapon);
+	DOREPLIFETIME_CONDITION(AShooterCharacter, CarriedAmmo, COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(AShooterCharacter, InventorySlots, COND_OwnerOnly);
+	DOREPLIFETIME_CONDITION(AShooterCharacter, SpreadSeed, COND_OwnerOnly);
 }
 
 void AShooterCharacter::DropWeapon()
 {
+	if (!HasAuthority()) return;
+
 	if (EquippedWeapon)
 	{
+		ShooterHitch::AddEvent(EShooterHitchEvent::Drop, EquippedWeapon);
+
 		FDetachmentTransformRules DetachmentTransformRules(EDetachmentRule::KeepWorld, true);
 		EquippedWeapon->GetItemMesh()->DetachFromComponent(DetachmentTransformRules);
 
@@ -508,14 +789,13 @@ void AShooterCharacter::SelectButtonPressed()
 	if (TraceHitItem)
 	{
 		UGameplayStatics::PlaySound2D(this, TraceHitItem->GetPickupSound());
+		if (!HasAuthority())
+		{
+			ServerPickupItem(TraceHitItem);
+		}
 		TraceHitItem->StartItemCurve(this);
 		TraceHitItem = nullptr;
 	}
-	if (TraceHitItem->GetPickupSound())
-	{
-		
-	}
-	
 }
 
 void AShooterCharacter::SelectButtonReleased()
@@ -524,11 +804,11 @@ void AShooterCharacter::SelectButtonReleased()
 
 void AShooterCharacter::SwapWeapon(AWeapon* WeaponToSwap)
 {
+	if (!HasAuthority() || EquippedWeapon == nullptr) return;
 
 	if (Inventory.Num() - 1 >= EquippedWeapon->GetSlotIndex())
 	{
-		Inventory[EquippedWeapon->GetSlotIndex()] = WeaponToSwap;
-		WeaponToSwap->SetSlotIndex(EquippedWeapon->GetSlotIndex());
+		SetInventoryWeapon(EquippedWeapon->GetSlotIndex(), WeaponToSwap, true);
 	}
 	DropWeapon();
 	EquipWeapon(WeaponToSwap);
@@ -536,10 +816,94 @@ void AShooterCharacter::SwapWeapon(AWeapon* WeaponToSwap)
 	TraceHitItemLastFrame = nullptr;
 }
 
-void AShooterCharacter::InitializeAmmoMap()
+void AShooterCharacter::InitializeCarriedAmmo()
+{
+	SetCarriedAmmo(EAmmoType::EAT_9mm, Starting9mmAmmo);
+	SetCarriedAmmo(EAmmoType::EAT_AR, StartingARAmmo);
+	SetCarriedAmmo(EAmmoType::EAT_Grenade, StartingGrenadeAmmo);
+}
+
+void AShooterCharacter::SetCarriedAmmo(EAmmoType AmmoType, int32 Amount)
+{
+	if (!CarriedAmmo.IsValidIndex(static_cast<int32>(AmmoType))) return;
+
+	CarriedAmmo[static_cast<int32>(AmmoType)] = Amount;
+	CarriedAmmoChangedDelegate.Broadcast(AmmoType, Amount);
+}
+
+int32 AShooterCharacter::GetCarriedAmmo(EAmmoType AmmoType) const
+{
+	return CarriedAmmo.IsValidIndex(static_cast<int32>(AmmoType)) ? CarriedAmmo[static_cast<int32>(AmmoType)] : 0;
+}
+
+void AShooterCharacter::OnRep_CarriedAmmo(const TArray<int32>& PreviousCarriedAmmo)
+{
+	for (int32 Index = 0; Index < CarriedAmmo.Num(); ++Index)
+	{
+		if (!PreviousCarriedAmmo.IsValidIndex(Index) || PreviousCarriedAmmo[Index] != CarriedAmmo[Index])
+		{
+			CarriedAmmoChangedDelegate.Broadcast(static_cast<EAmmoType>(Index), CarriedAmmo[Index]);
+		}
+	}
+}
+
+void AShooterCharacter::SetCombatState(ECombatState NewCombatState)
+{
+	if (CombatState == NewCombatState) return;
+
+	CombatState = NewCombatState;
+	ShooterHitch::AddEvent(EShooterHitchEvent::CombatState, this, StaticEnum<ECombatState>()->GetNameByValue(static_cast<int64>(CombatState)));
+	CombatStateChangedDelegate.Broadcast(CombatState);
+}
+
+void AShooterCharacter::SetInventorySlot(int32 SlotIndex, const FInventoryWeaponRecord& Record)
 {
-	AmmoMap.Add(EAmmoType::EAT_9mm, Starting9mmAmmo);
-	AmmoMap.Add(EAmmoType::EAT_AR, StartingARAmmo);
+	// Clients only take slots from InventorySlots, a slot of their own would be one the server doesn't know
+	if (!HasAuthority()) return;
+
+	if (SlotIndex < Inventory.Num())
+	{
+		Inventory[SlotIndex] = Record;
+	}
+	else
+	{
+		Inventory.Add(Record);
+	}
+	InventorySlotChangedDelegate.Broadcast(SlotIndex, Record);
+	InventorySlots.SetSlot(SlotIndex, Record);
+}
+
+void AShooterCharacter::SetInventoryWeapon(int32 SlotIndex, AWeapon* Weapon, bool bEquipped)
+{
+	if (Weapon == nullptr) return;
+
+	Weapon->SetSlotIndex(SlotIndex);
+
+	FInventoryWeaponRecord Record{ Weapon->MakeInventoryRecord() };
+	Record.bEquipped = bEquipped;
+	SetInventorySlot(SlotIndex, Record);
+}
+
+void AShooterCharacter::OnInventorySlotReplicated(int32 SlotIndex, const FInventoryWeaponRecord& Record)
+{
+	if (SlotIndex < 0 || SlotIndex >= INVENTORY_CAPACITY) return;
+
+	// Slots can arrive out of order, keep the local array indexed by slot
+	if (Inventory.Num() <= SlotIndex)
+	{
+		Inventory.SetNum(SlotIndex + 1);
+	}
+	Inventory[SlotIndex] = Record;
+	InventorySlotChangedDelegate.Broadcast(SlotIndex, Record);
+
+	// The equipped weapon may have replicated before its slot. A pooled actor still has the ammo of whatever it was
+	// last, take the slot's and point the inventory bar at the right one
+	if (Record.bEquipped && Record.IsArchetypeOf(EquippedWeapon) && EquippedWeapon->GetSlotIndex() != SlotIndex)
+	{
+		EquippedWeapon->SetSlotIndex(SlotIndex);
+		EquippedWeapon->ApplyInventoryRecord(Record);
+		EquipItemDelegate.Broadcast(-1, SlotIndex);
+	}
 }
 
 bool AShooterCharacter::WeaponHasAmmo()
@@ -557,8 +921,14 @@ void AShooterCharacter::PlayFireSound()
 	}
 }
 
-void AShooterCharacter::SendBullet()
+void AShooterCharacter::SendBullet(const FRotator& ShotOffset)
 {
+	SCOPE_CYCLE_COUNTER(STAT_ShooterSendBullet);
+	CSV_SCOPED_TIMING_STAT(Shooter, SendBullet);
+	SHOOTER_LLM_SCOPE(CombatFX);
+	ShooterStats::AddShots();
+	ShooterHitch::AddEvent(EShooterHitchEvent::Shot, this);
+
 	const USkeletalMeshSocket* BarrelSocket = EquippedWeapon->GetItemMesh()->GetSocketByName("BarrelSocket");
 
 	if (BarrelSocket)
@@ -571,75 +941,315 @@ void AShooterCharacter::SendBullet()
 		}
 
 		FHitResult BeamHitResult;
-		bool bBeamEnd = GetBeamEndLocation(SocketTransform.GetLocation(), BeamHitResult);
+		bool bBeamEnd = GetBeamEndLocation(SocketTransform.GetLocation(), ShotOffset, BeamHitResult);
 
 		if (bBeamEnd)
 		{
-			// Does hit Actor implemenet BulletHitInterface?
+			ProcessBulletHit(BeamHitResult);
 
-			if (BeamHitResult.Actor.IsValid())
+			// A listen server host fires without an RPC, show its shots to the clients from here
+			if (HasAuthority() && !IsNetMode(NM_Standalone))
 			{
-				// Set local pointer to the cast of BeamHitResult.Actor to IBulletHitInterface
-				IBulletHitInterface* BulletHitInterface = Cast<IBulletHitInterface>(BeamHitResult.Actor.Get());
+				MulticastShotFX(BeamHitResult.Location);
+			}
 
-				if (BulletHitInterface)
-				{
-					// Call BulletHit_Implementation function
-					BulletHitInterface->BulletHit_Implementation(BeamHitResult);
-				}
+			UParticleSystemComponent* Beam = UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), BeamParticles, SocketTransform);
 
-				// Check to see if HitResult hit an AEnemy and set to local pointer
-				AEnemy* HitEnemy = Cast<AEnemy>(BeamHitResult.Actor.Get());
-				if (HitEnemy)
-				{
-					int32 Damage{};
-					if (BeamHitResult.BoneName.ToString() == HitEnemy->GetHeadBone())
-					{
-						// HeadShot
-						Damage = EquippedWeapon->GetHeadShotDamage();
-						UGameplayStatics::ApplyDamage(BeamHitResult.Actor.Get(),
-							Damage,
-							GetController(),
-							this,
-							UDamageType::StaticClass());
-					}
-					else
-					{
-						// bodyshot
-						Damage = EquippedWeapon->GetDamage();
-						UGameplayStatics::ApplyDamage(BeamHitResult.Actor.Get(),
-							Damage,
-							GetController(),
-							this,
-							UDamageType::StaticClass());
-					}
-					HitEnemy->ShowHitNumber(Damage, BeamHitResult.Location);
-					
-				
-				}
+			if (Beam)
+			{
+				Beam->SetVectorParameter(FName("Target"), BeamHitResult.Location);
+			}
+		}
+
+	}
+
+	++ShotCount;
+	if (ShotInputTime > 0.0)
+	{
+		const float FXLatencyMs{ static_cast<float>((FPlatformTime::Seconds() - ShotInputTime) * 1000.0) };
+		InputToFXMs.AddSample(FXLatencyMs);
+		UE_LOG(LogShooter, Verbose, TEXT("Shot %d: input to FX %.2f ms"), ShotCount, FXLatencyMs);
+	}
+}
+
+void AShooterCharacter::ThrowGrenade(const FVector& Start, const FVector& Direction)
+{
+	if (EquippedWeapon == nullptr || EquippedWeapon->GetGrenadeClass() == nullptr) return;
+
+	SHOOTER_LLM_SCOPE(Weapons);
+	ShooterStats::AddShots();
+	ShooterHitch::AddEvent(EShooterHitchEvent::Shot, this);
+
+	// Out in front of the view ray's start, which sits beside the head
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.Owner = this;
+	SpawnParams.Instigator = this;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AShooterGrenade* Grenade = GetWorld()->SpawnActor<AShooterGrenade>(EquippedWeapon->GetGrenadeClass(),
+		Start + Direction * 100.f, Direction.Rotation(), SpawnParams);
+	if (Grenade)
+	{
+		Grenade->Throw(Direction);
+	}
+}
+
+void AShooterCharacter::ProcessBulletHit(const FHitResult& BeamHitResult)
+{
+	// Does hit Actor implemenet BulletHitInterface?
+	if (BeamHitResult.Actor.IsValid())
+	{
+		// Set local pointer to the cast of BeamHitResult.Actor to IBulletHitInterface
+		IBulletHitInterface* BulletHitInterface = Cast<IBulletHitInterface>(BeamHitResult.Actor.Get());
+
+		if (BulletHitInterface)
+		{
+			// Call BulletHit_Implementation function
+			BulletHitInterface->BulletHit_Implementation(BeamHitResult);
+		}
+		else
+		{
+			SpawnImpactEffects(BeamHitResult);
+		}
+
+		// Check to see if HitResult hit an AEnemy and set to local pointer
+		AEnemy* HitEnemy = Cast<AEnemy>(BeamHitResult.Actor.Get());
+		if (HitEnemy && EquippedWeapon)
+		{
+			int32 Damage{};
+			const bool bHeadShot{ BeamHitResult.BoneName.ToString() == HitEnemy->GetHeadBone() };
+			if (bHeadShot)
+			{
+				// HeadShot
+				Damage = EquippedWeapon->GetHeadShotDamage();
 			}
 			else
 			{
-				// Spawn default impact particles after updating BeamHitResult
-				if (ImpactParticles)
-				{
-					UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ImpactParticles, BeamHitResult.Location);
-				}
-
+				// bodyshot
+				Damage = EquippedWeapon->GetDamage();
 			}
+			// Only the machine that read the fire input knows when it was, a server resolving a client's shot doesn't
+			SHOOTER_TRACE(Hit, this, HitEnemy, BeamHitResult.BoneName, Damage, bHeadShot, IsLocallyControlled() ? ShotInputTime : 0.0);
 
-			
-			UParticleSystemComponent* Beam = UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), BeamParticles, SocketTransform);
-
-			if (Beam)
+			// Health only changes on the server, the shooter predicts the hit number
+			if (HasAuthority())
 			{
-				Beam->SetVectorParameter(FName("Target"), BeamHitResult.Location);
+				UGameplayStatics::ApplyDamage(BeamHitResult.Actor.Get(),
+					Damage,
+					GetController(),
+					this,
+					UDamageType::StaticClass());
+			}
+			if (IsLocallyControlled())
+			{
+				// The widget is created in Blueprint
+				SHOOTER_LLM_SCOPE(HitNumbers);
+				HitEnemy->ShowHitNumber(Damage, BeamHitResult.Location);
 			}
 		}
+	}
+	else
+	{
+		SHOOTER_TRACE(Hit, this, nullptr, NAME_None, 0.f, false, IsLocallyControlled() ? ShotInputTime : 0.0);
+		SpawnImpactEffects(BeamHitResult);
+	}
+}
+
+void AShooterCharacter::SpawnImpactEffects(const FHitResult& BeamHitResult)
+{
+	// ImpactParticles covers surfaces the impact table has no particles for
+	UShooterImpactSubsystem* Impacts = GetWorld()->GetSubsystem<UShooterImpactSubsystem>();
+	if (Impacts)
+	{
+		Impacts->SpawnImpact(BeamHitResult, ImpactParticles);
+	}
+}
+
+void AShooterCharacter::SendShotToServer()
+{
+	if (EquippedWeapon == nullptr) return;
+
+	FShotRequest Shot;
+	GetShotViewRay(Shot.Origin, Shot.Direction);
+	const AGameStateBase* GameState{ GetWorld()->GetGameState() };
+	Shot.Timestamp = GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds();
+	Shot.Seq = static_cast<uint8>(ShotSeq);
+	Shot.PredictedAmmo = static_cast<uint8>(FMath::Clamp(EquippedWeapon->GetAmmo(), 0, 255));
+	// The view ray stays unrotated, the server derives the same offset from these and SpreadSeed
+	Shot.Spread = ShotSpread;
+	Shot.BurstIndex = ShotBurstIndex;
+
+	++ShotsSent;
+	ShotBitsSent += Shot.GetNumBits();
+
+	ServerFire(Shot);
+}
+
+bool AShooterCharacter::ValidateShot(const FShotRequest& Shot) const
+{
+	if (EquippedWeapon == nullptr || EquippedWeapon->GetAmmo() <= 0) return false;
+
+	if (CombatState == ECombatState::ECS_Reloading || CombatState == ECombatState::ECS_Equipping) return false;
+
+	// Allow for jitter between RPCs, but not for a client firing twice as fast as the weapon
+	const UShooterCombatClock* CombatClock = GetWorld()->GetSubsystem<UShooterCombatClock>();
+	const double SimTime{ CombatClock ? CombatClock->GetSimTime() : GetWorld()->GetTimeSeconds() };
+	if (SimTime - LastServerShotTime < EquippedWeapon->GetAutoFireRate() * 0.5f) return false;
+
+	// Stale or from the future
+	const float ShotAge{ GetWorld()->GetTimeSeconds() - Shot.Timestamp };
+	if (ShotAge > 1.f || ShotAge < -0.25f) return false;
+
+	// The client may only shoot from roughly where the server thinks its camera is
+	FVector ServerStart;
+	FVector ServerDirection;
+	GetShotViewRay(ServerStart, ServerDirection);
+	if (FVector::DistSquared(ServerStart, Shot.Origin) > FMath::Square(ShotOriginTolerance)) return false;
+
+	return true;
+}
+
+void AShooterCharacter::ServerFire_Implementation(const FShotRequest& Shot)
+{
+	++ServerShotsReceived;
+
+	// Reliable and in order, so the byte only ever moves forward from the last one
+	LastReceivedShotSeq += static_cast<uint8>(Shot.Seq - static_cast<uint8>(LastReceivedShotSeq));
+
+	if (!ValidateShot(Shot))
+	{
+		++ServerShotsRejected;
+		if (EquippedWeapon)
+		{
+			ClientCorrectAmmo(Shot.Seq, EquippedWeapon->GetAmmo(), GetCarriedAmmo(EquippedWeapon->GetAmmoType()));
+		}
+		return;
+	}
+
+	// Our own burst count and speed set a floor, a client may claim more recoil and spread but never less.
+	// A couple of shots of slack cover the jitter in RPC arrival times
+	const UShooterCombatClock* CombatClock = GetWorld()->GetSubsystem<UShooterCombatClock>();
+	const double Now{ CombatClock ? CombatClock->GetSimTime() : GetWorld()->GetTimeSeconds() };
+	ServerBurstIndex = Now - LastServerShotTime > EquippedWeapon->GetRecoilRecoveryTime() ? 0 : static_cast<uint8>(FMath::Min(ServerBurstIndex + 1, 255));
+	const uint8 BurstIndex{ static_cast<uint8>(FMath::Max<int32>(Shot.BurstIndex, ServerBurstIndex - 2)) };
+	FVector Velocity{ GetVelocity() };
+	Velocity.Z = 0.f;
+	const uint8 MinSpread{ ShooterSpread::QuantizeSpread(FMath::Max(GetVelocitySpreadFactor(Velocity.Size()) - 0.25f, 0.f)) };
+	const uint8 Spread{ FMath::Max(Shot.Spread, MinSpread) };
+
+	LastServerShotTime = Now;
+	EquippedWeapon->DecreaseAmmo();
+
+	if (EquippedWeapon->GetWeaponType() == EWeaponType::EWT_Grenade)
+	{
+		ThrowGrenade(Shot.Origin, Shot.Direction);
+	}
+	else
+	{
+		// Resolve the hit along the client's ray, it was checked against our view above
+		FVector Direction{ Shot.Direction };
+		if (CVarFireDispersion.GetValueOnGameThread() != 0)
+		{
+			const FRotator ShotOffset{ ShooterSpread::GetShotOffset(EquippedWeapon->GetRecoilOffsets(), EquippedWeapon->GetSpreadDegrees(), SpreadSeed, LastReceivedShotSeq, BurstIndex, Spread) };
+			Direction = (Shot.Direction.Rotation() + ShotOffset).Vector();
+		}
+
+		FHitResult HitResult;
+		const FVector End{ Shot.Origin + Direction * 50'000.f };
+		FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ServerShotTrace), false, this);
+		QueryParams.bReturnPhysicalMaterial = true;
+		GetWorld()->LineTraceSingleByChannel(HitResult, Shot.Origin, End, ECC_Weapon, QueryParams);
+		ShooterStats::AddShots();
+		ShooterStats::AddTraces();
 
+		FVector HitLocation{ End };
+		if (HitResult.bBlockingHit)
+		{
+			HitLocation = HitResult.Location;
+			ProcessBulletHit(HitResult);
+		}
+
+		MulticastShotFX(HitLocation);
+	}
+
+	if (Shot.PredictedAmmo != EquippedWeapon->GetAmmo())
+	{
+		++ServerCorrections;
+		ClientCorrectAmmo(Shot.Seq, EquippedWeapon->GetAmmo(), GetCarriedAmmo(EquippedWeapon->GetAmmoType()));
 	}
 }
 
+void AShooterCharacter::ServerReload_Implementation()
+{
+	ReloadWeapon();
+}
+
+void AShooterCharacter::ServerExchangeInventoryItems_Implementation(uint8 NewItemIndex)
+{
+	if (EquippedWeapon == nullptr) return;
+
+	ExchangeInventoryItems(EquippedWeapon->GetSlotIndex(), NewItemIndex);
+}
+
+void AShooterCharacter::ServerPickupItem_Implementation(AItem* Item)
+{
+	if (Item == nullptr || CombatState != ECombatState::ECS_Unoccupied) return;
+
+	// Only items still lying on the ground, and near where the server has us
+	if (Item->GetItemState() != EItemState::EIS_Pickup) return;
+	if (FVector::DistSquared(Item->GetActorLocation(), GetActorLocation()) > FMath::Square(PickupRange)) return;
+
+	Item->StartItemCurve(this);
+}
+
+void AShooterCharacter::ClientCorrectAmmo_Implementation(uint8 Seq, int32 WeaponAmmo, int32 NewCarriedAmmo)
+{
+	if (EquippedWeapon == nullptr) return;
+
+	// Shots fired after Seq are still on their way to the server, keep them predicted
+	const int32 ShotsInFlight{ static_cast<uint8>(ShotSeq - Seq) };
+	const int32 CorrectedAmmo{ FMath::Max(WeaponAmmo - ShotsInFlight, 0) };
+	const EAmmoType AmmoType{ EquippedWeapon->GetAmmoType() };
+
+	if (CorrectedAmmo == EquippedWeapon->GetAmmo() && NewCarriedAmmo == GetCarriedAmmo(AmmoType)) return;
+
+	++ClientCorrections;
+	EquippedWeapon->SetAmmo(CorrectedAmmo);
+	SetCarriedAmmo(AmmoType, NewCarriedAmmo);
+}
+
+void AShooterCharacter::MulticastShotFX_Implementation(FVector_NetQuantize HitLocation)
+{
+	// The shooter already played all of this when it fired, a dedicated server has nothing to show
+	if (IsLocallyControlled() || IsNetMode(NM_DedicatedServer)) return;
+	if (EquippedWeapon == nullptr) return;
+
+	SHOOTER_LLM_SCOPE(CombatFX);
+
+	const USkeletalMeshSocket* BarrelSocket = EquippedWeapon->GetItemMesh()->GetSocketByName("BarrelSocket");
+	if (BarrelSocket)
+	{
+		const FTransform SocketTransform = BarrelSocket->GetSocketTransform(EquippedWeapon->GetItemMesh());
+
+		if (EquippedWeapon->GetMuzzleFlash())
+		{
+			UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), EquippedWeapon->GetMuzzleFlash(), SocketTransform);
+		}
+
+		UParticleSystemComponent* Beam = UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), BeamParticles, SocketTransform);
+		if (Beam)
+		{
+			Beam->SetVectorParameter(FName("Target"), HitLocation);
+		}
+	}
+
+	if (EquippedWeapon->GetFireSound())
+	{
+		UGameplayStatics::PlaySoundAtLocation(this, EquippedWeapon->GetFireSound(), GetActorLocation());
+	}
+
+	PlayGunfireMontage();
+}
+
 void AShooterCharacter::PlayGunfireMontage()
 {
 	// Play Hip Fire Montage
@@ -664,12 +1274,19 @@ void AShooterCharacter::ReloadWeapon()
 	// Check ammo of the correct type
 	if (CarryingAmmo() && !EquippedWeapon->ClipIsFull()) 
 	{
+		// The server refills the magazine and sends the result back when it finishes
+		if (!HasAuthority() && IsLocallyControlled())
+		{
+			ServerReload();
+		}
+
 		if (bAiming)
 		{
 			StopAiming();
 		}
 
-		CombatState = ECombatState::ECS_Reloading;
+		SetCombatState(ECombatState::ECS_Reloading);
+		SHOOTER_TRACE(ReloadStart, this, EquippedWeapon, GetCarriedAmmo(EquippedWeapon->GetAmmoType()));
 
 		UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
 		if (AnimInstance && ReloadMontage)
@@ -684,14 +1301,8 @@ bool AShooterCharacter::CarryingAmmo()
 {
 	if (EquippedWeapon == nullptr) return false;
 
-	auto AmmoType = EquippedWeapon->GetAmmoType();
+	return GetCarriedAmmo(EquippedWeapon->GetAmmoType()) > 0;
 
-	if (AmmoMap.Contains(AmmoType))
-	{
-		return AmmoMap[AmmoType] > 0;
-	}
-	return false;
-	
 }
 
 void AShooterCharacter::GrabClip()
@@ -761,15 +1372,39 @@ void AShooterCharacter::SixKeyPressed()
 void AShooterCharacter::ExchangeInventoryItems(int32 CurrentItemIndex, int32 NewItemIndex)
 {
 	if ((CurrentItemIndex == NewItemIndex) || (NewItemIndex >= Inventory.Num()) || (CombatState != ECombatState::ECS_Unoccupied)) return;
-	auto OldEquippedWeapon = EquippedWeapon;
-	auto NewWeapon = Cast<AWeapon>(Inventory[NewItemIndex]);
+	if (!Inventory[NewItemIndex].IsValid()) return;
 
-	EquipWeapon(NewWeapon);
+	SHOOTER_TRACE(Swap, this, CurrentItemIndex, NewItemIndex);
+
+	if (HasAuthority())
+	{
+		UShooterWeaponPool* WeaponPool = GetWorld()->GetSubsystem<UShooterWeaponPool>();
+		if (WeaponPool == nullptr) return;
 
-	OldEquippedWeapon->SetItemState(EItemState::EIS_PickedUp);
-	NewWeapon->SetItemState(EItemState::EIS_Equipped);
+		// Taken before the old weapon goes back, so it is never the same actor and EquippedWeapon always replicates
+		AWeapon* OldEquippedWeapon = EquippedWeapon;
+		AWeapon* NewWeapon = WeaponPool->Acquire(Inventory[NewItemIndex]);
+		if (NewWeapon == nullptr) return;
 
-	CombatState = ECombatState::ECS_Equipping;
+		ShooterHitch::AddEvent(EShooterHitchEvent::Swap, NewWeapon);
+
+		NewWeapon->SetSlotIndex(NewItemIndex);
+		EquipWeapon(NewWeapon);
+		SetInventoryWeapon(NewItemIndex, NewWeapon, true);
+
+		if (OldEquippedWeapon)
+		{
+			SetInventoryWeapon(CurrentItemIndex, OldEquippedWeapon, false);
+			WeaponPool->Release(OldEquippedWeapon);
+		}
+	}
+	else if (IsLocallyControlled())
+	{
+		// Only the server can make the weapon actor, it arrives through OnRep_EquippedWeapon
+		ServerExchangeInventoryItems(static_cast<uint8>(NewItemIndex));
+	}
+
+	SetCombatState(ECombatState::ECS_Equipping);
 	UAnimInstance* AnimInstance = GetMesh()->GetAnimInstance();
 	if (AnimInstance && EquipMontage)
 	{
@@ -778,16 +1413,67 @@ void AShooterCharacter::ExchangeInventoryItems(int32 CurrentItemIndex, int32 New
 	}
 }
 
+void AShooterCharacter::ScriptedFire(bool bPressed)
+{
+	if (bPressed)
+	{
+		// Not user input, keep these shots out of the input latency samples
+		bFireButtonPressed = true;
+		ShotInputTime = 0.0;
+		FireWeapon();
+	}
+	else
+	{
+		FireButtonReleased();
+	}
+}
+
+void AShooterCharacter::ScriptedAim(bool bAim)
+{
+	if (bAim)
+	{
+		AimingButtonPressed();
+	}
+	else
+	{
+		AimingButtonReleased();
+	}
+}
+
+void AShooterCharacter::ScriptedReload()
+{
+	ReloadButtonPressed();
+}
+
+void AShooterCharacter::ScriptedSelectSlot(int32 SlotIndex)
+{
+	if (EquippedWeapon == nullptr || EquippedWeapon->GetSlotIndex() == SlotIndex) return;
+	ExchangeInventoryItems(EquippedWeapon->GetSlotIndex(), SlotIndex);
+}
+
+void AShooterCharacter::ScriptedRefillAmmo()
+{
+	InitializeCarriedAmmo();
+	if (EquippedWeapon)
+	{
+		EquippedWeapon->SetAmmo(EquippedWeapon->GetMagazineCapacity());
+	}
+}
+
 void AShooterCharacter::Aim()
 {
 	bAiming = true;
 	GetCharacterMovement()->MaxWalkSpeed = CrouchMovementSpeed;
+	WakeCameraZoom();
+	WakeCrosshairSpread();
 }
 
 void AShooterCharacter::StopAiming()
 {
 	bAiming = false;
 	GetCharacterMovement()->MaxWalkSpeed = BaseMovementSpeed;
+	WakeCameraZoom();
+	WakeCrosshairSpread();
 }
 
 // Called every frame
@@ -795,15 +1481,145 @@ void AShooterCharacter::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+	// Camera zoom and item focus follow the view of whoever controls us on this machine, with or without a renderer.
+	// Servers and other players' pawns have neither
+	if (IsLocallyControlled())
+	{
+		TickSubsystems(DeltaTime);
+	}
+	ShooterStats::RecordFrame();
+}
+
+void AShooterCharacter::TickSubsystems(float DeltaTime)
+{
 	// Handle interpolation for zoom when aiming
-	CameraInterpZoom(DeltaTime);
-	
-	// Calculate crosshair spread multiplier
-	CalculateCrosshairSpread(DeltaTime);
+	if (bCameraZoomActive)
+	{
+		CameraInterpZoom(DeltaTime);
+	}
 
 	// Check OverlappedItemCount, then trace for items
 	TraceForItems();
-	
+}
+
+bool AShooterCharacter::CombatStep(float StepTime, double SimTime)
+{
+	if (bFiringBullet && SimTime >= CrosshairShootEndTime)
+	{
+		FinishCrosshairBulletFire();
+	}
+
+	// May fire the next shot, which spreads the crosshairs in this same step
+	if (CombatState == ECombatState::ECS_FireTimerInProgress && SimTime >= AutoFireSimTime)
+	{
+		AutoFireReset();
+	}
+
+	StepCrosshairSpread(StepTime);
+	return true;
+}
+
+void AShooterCharacter::CombatPresent(float Alpha)
+{
+	CrosshairPresentAlpha = Alpha;
+}
+
+uint32 AShooterCharacter::GetCombatStateHash() const
+{
+	// The fire deadlines are set from the step a shot fired on, they stand in for the shot times
+	uint32 Hash{ GetTypeHash(static_cast<uint8>(CombatState)) };
+	Hash = HashCombine(Hash, GetTypeHash(ShotSeq));
+	Hash = HashCombine(Hash, GetTypeHash(ShotBurstIndex));
+	Hash = HashCombine(Hash, GetTypeHash(LastShotTime));
+	Hash = HashCombine(Hash, GetTypeHash(AutoFireSimTime));
+	Hash = HashCombine(Hash, GetTypeHash(CrosshairShootEndTime));
+	Hash = HashCombine(Hash, GetTypeHash(static_cast<uint8>(bFiringBullet)));
+	Hash = HashCombine(Hash, GetTypeHash(CrosshairSpreadMultiplier));
+	return HashCombine(Hash, GetTypeHash(Inventory.Num()));
+}
+
+void AShooterCharacter::LogNetStats() const
+{
+	const float BytesPerShot{ ShotsSent > 0 ? ShotBitsSent / 8.f / ShotsSent : 0.f };
+	const float ClientCorrectionRate{ ShotsSent > 0 ? 100.f * ClientCorrections / ShotsSent : 0.f };
+	const float RejectRate{ ServerShotsReceived > 0 ? 100.f * ServerShotsRejected / ServerShotsReceived : 0.f };
+	const float ServerCorrectionRate{ ServerShotsReceived > 0 ? 100.f * ServerCorrections / ServerShotsReceived : 0.f };
+
+	UE_LOG(LogShooter, Log, TEXT("%s (%s): sent %d shots, %.1f bytes each, %d corrections applied (%.1f%%)"),
+		*GetName(), HasAuthority() ? TEXT("server") : TEXT("client"), ShotsSent, BytesPerShot, ClientCorrections, ClientCorrectionRate);
+	UE_LOG(LogShooter, Log, TEXT("%s: received %d shots, %d rejected (%.1f%%), %d mispredicted (%.1f%%)"),
+		*GetName(), ServerShotsReceived, ServerShotsRejected, RejectRate, ServerCorrections, ServerCorrectionRate);
+
+	const float BytesPerInventoryDelta{ InventorySlots.DeltasSent > 0 ? InventorySlots.BitsSent / 8.f / InventorySlots.DeltasSent : 0.f };
+	UE_LOG(LogShooter, Log, TEXT("%s: sent %d inventory deltas, %.1f bytes each"),
+		*GetName(), InventorySlots.DeltasSent, BytesPerInventoryDelta);
+}
+
+void AShooterCharacter::ReportShotLatency()
+{
+	UE_LOG(LogShooter, Log, TEXT("Shot latency over %d shots (fresh view %d)"), ShotCount, CVarFireFreshView.GetValueOnGameThread());
+	UE_LOG(LogShooter, Log, TEXT("Input to trace ms: %s"), *InputToTraceMs.ToString());
+	UE_LOG(LogShooter, Log, TEXT("Input to FX ms: %s"), *InputToFXMs.ToString());
+}
+
+void AShooterCharacter::BenchmarkCharacterTick(int32 Iterations)
+{
+	if (Iterations <= 0)
+	{
+		Iterations = 10000;
+	}
+
+	// Keep the real state so the benchmark doesn't leave the camera or crosshairs somewhere odd
+	const float SavedFOV{ CameraCurrentFOV };
+	const float SavedInAirFactor{ CrosshairInAirFactor };
+	const float SavedAimFactor{ CrosshairAimFactor };
+	const float SavedShootingFactor{ CrosshairShootingFactor };
+	const bool bSavedFiringBullet{ bFiringBullet };
+	const float DeltaTime{ 1.f / 60.f };
+
+	// Idle: let everything converge first, then time the frames that follow
+	for (int32 Frame = 0; Frame < 300; ++Frame)
+	{
+		TickSubsystems(DeltaTime);
+		StepCrosshairSpread(DeltaTime);
+	}
+
+	FPercentileSampler IdleMicroseconds(Iterations);
+	for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+	{
+		const uint32 StartCycles{ FPlatformTime::Cycles() };
+		TickSubsystems(DeltaTime);
+		StepCrosshairSpread(DeltaTime);
+		IdleMicroseconds.AddSample(FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles) * 1000.f);
+	}
+
+	// Combat: a shot every frame keeps every sub-system awake
+	FPercentileSampler CombatMicroseconds(Iterations);
+	for (int32 Iteration = 0; Iteration < Iterations; ++Iteration)
+	{
+		bFiringBullet = (Iteration % 2) == 0;
+		CameraCurrentFOV = bAiming ? CameraDefaultFOV : CameraZoomedFOV;
+		WakeCameraZoom();
+		WakeCrosshairSpread();
+
+		const uint32 StartCycles{ FPlatformTime::Cycles() };
+		TickSubsystems(DeltaTime);
+		StepCrosshairSpread(DeltaTime);
+		CombatMicroseconds.AddSample(FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles) * 1000.f);
+	}
+
+	CameraCurrentFOV = SavedFOV;
+	CrosshairInAirFactor = SavedInAirFactor;
+	CrosshairAimFactor = SavedAimFactor;
+	CrosshairShootingFactor = SavedShootingFactor;
+	bFiringBullet = bSavedFiringBullet;
+	WakeCameraZoom();
+	WakeCrosshairSpread();
+
+	UE_LOG(LogShooter, Log, TEXT("Character tick over %d frames, us. Idle: avg %.3f %s"),
+		Iterations, IdleMicroseconds.GetAverage(), *IdleMicroseconds.ToString());
+	UE_LOG(LogShooter, Log, TEXT("Character tick over %d frames, us. Combat: avg %.3f %s"),
+		Iterations, CombatMicroseconds.GetAverage(), *CombatMicroseconds.ToString());
 }
 
 // Called to bind functionality to input
@@ -844,9 +1660,8 @@ void AShooterCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputCo
 
 void AShooterCharacter::FinishReloading()
 {
-	//TODO: Update AmmoMap
 	// Udpate the Combat State
-	CombatState = ECombatState::ECS_Unoccupied;
+	SetCombatState(ECombatState::ECS_Unoccupied);
 
 	if (bAimingButtonPressed)
 	{
@@ -857,40 +1672,44 @@ void AShooterCharacter::FinishReloading()
 
 	const auto AmmoType{ EquippedWeapon->GetAmmoType() };
 
-	if (AmmoMap.Contains(AmmoType))
-	{
-		// Amount of ammo the Character is carrying of the EquippedWeapon type
-		int32 CarriedAmmo = AmmoMap[AmmoType];
+	// Amount of ammo the Character is carrying of the EquippedWeapon type
+	int32 AmmoCarried = GetCarriedAmmo(AmmoType);
 
-		// Space left in the magazine of the EquippedWeapon
-		const int32 MagEmptySpace = EquippedWeapon->GetMagazineCapacity() - EquippedWeapon->GetAmmo();
+	// Space left in the magazine of the EquippedWeapon
+	const int32 MagEmptySpace = EquippedWeapon->GetMagazineCapacity() - EquippedWeapon->GetAmmo();
 
-		if (MagEmptySpace > CarriedAmmo)
-		{
-			// Reload the magazine with all the ammo we are carrying
-			EquippedWeapon->ReloadAmmo(CarriedAmmo);
-			CarriedAmmo = 0;
-			AmmoMap.Add(AmmoType, CarriedAmmo);
-		}
-		else
-		{
-			// fill the magazine
-			EquippedWeapon->ReloadAmmo(MagEmptySpace);
-			CarriedAmmo -= MagEmptySpace;
-			AmmoMap.Add(AmmoType, CarriedAmmo);
-		}
+	if (MagEmptySpace > AmmoCarried)
+	{
+		// Reload the magazine with all the ammo we are carrying
+		EquippedWeapon->ReloadAmmo(AmmoCarried);
+		AmmoCarried = 0;
+		SetCarriedAmmo(AmmoType, AmmoCarried);
+	}
+	else
+	{
+		// fill the magazine
+		EquippedWeapon->ReloadAmmo(MagEmptySpace);
+		AmmoCarried -= MagEmptySpace;
+		SetCarriedAmmo(AmmoType, AmmoCarried);
+	}
+	SHOOTER_TRACE(ReloadEnd, this, EquippedWeapon, AmmoCarried);
 
+	// A remote client reloaded on its own timeline, make sure it ends up with our numbers
+	if (HasAuthority() && !IsLocallyControlled())
+	{
+		ClientCorrectAmmo(static_cast<uint8>(LastReceivedShotSeq), EquippedWeapon->GetAmmo(), AmmoCarried);
 	}
 }
 
 void AShooterCharacter::FinishEquipping()
 {
-	CombatState = ECombatState::ECS_Unoccupied;
+	SetCombatState(ECombatState::ECS_Unoccupied);
 }
 
 float AShooterCharacter::GetCrosshairSpreadMultiplier() const
 {
-	return CrosshairSpreadMultiplier;
+	// The HUD draws every frame, blend between combat steps so the crosshairs don't move in stairs
+	return FMath::Lerp(PreviousCrosshairSpreadMultiplier, CrosshairSpreadMultiplier, CrosshairPresentAlpha);
 }
 
 void AShooterCharacter::IncrementOverlappedItemCount(int8 Amount)
@@ -922,6 +1741,11 @@ void AShooterCharacter::GetPickupItem(AItem* Item)
 		UGameplayStatics::PlaySound2D(this, Item->GetEquipSound());
 	}
 
+	ShooterHitch::AddEvent(EShooterHitchEvent::Pickup, Item);
+
+	// The client's curve ends here too, the server's own curve fills the inventory and it replicates back
+	if (!HasAuthority()) return;
+
 	auto Weapon = Cast<AWeapon>(Item);
 	if (Weapon)
 	{
@@ -929,10 +1753,14 @@ void AShooterCharacter::GetPickupItem(AItem* Item)
 		//SwapWeapon(Weapon);
 		if (Inventory.Num() < INVENTORY_CAPACITY)
 		{
-			Weapon->SetSlotIndex(Inventory.Num());
-			Inventory.Add(Weapon);
-			Weapon->SetItemState(EItemState::EIS_PickedUp);
+			// Only the record goes into the inventory, the actor waits in the pool until a slot is equipped
+			SetInventoryWeapon(Inventory.Num(), Weapon, false);
 
+			UShooterWeaponPool* WeaponPool = GetWorld()->GetSubsystem<UShooterWeaponPool>();
+			if (WeaponPool)
+			{
+				WeaponPool->Release(Weapon);
+			}
 		}
 		else {
 			SwapWeapon(Weapon);
@@ -5,8 +5,15 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "AmmoType.h"
+#include "PercentileSampler.h"
+#include "ShooterInventory.h"
+#include "CombatSimInterface.h"
+#include "Engine/NetSerialization.h"
+#include "Shooter.h"
 #include "ShooterCharacter.generated.h"
 
+class AItem;
+
 
 
 
@@ -22,9 +29,50 @@ enum class ECombatState : uint8
 };
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FEquipItemDelegate, int32, CurrentSlotIndex, int32, NewSlotIndex);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FCarriedAmmoChangedDelegate, EAmmoType, AmmoType, int32, CarriedAmmo);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FInventorySlotChangedDelegate, int32, SlotIndex, const FInventoryWeaponRecord&, Record);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FCombatStateChangedDelegate, ECombatState, NewCombatState);
+
+/* One predicted shot as sent to the server, quantized to keep the RPC small */
+USTRUCT()
+struct FShotRequest
+{
+	GENERATED_BODY()
+
+	/* Start of the view ray, rounded to whole centimetres */
+	UPROPERTY()
+	FVector_NetQuantize Origin;
+
+	/* View direction, 16 bits per component */
+	UPROPERTY()
+	FVector_NetQuantizeNormal Direction;
+
+	/* Server world time when the client fired */
+	UPROPERTY()
+	float Timestamp = 0.f;
+
+	/* Wraps around, only compared with recent shots */
+	UPROPERTY()
+	uint8 Seq = 0;
+
+	/* Magazine ammo the client has after this shot */
+	UPROPERTY()
+	uint8 PredictedAmmo = 0;
+
+	/* Crosshair spread multiplier, see ShooterSpread::QuantizeSpread */
+	UPROPERTY()
+	uint8 Spread = 0;
+
+	/* Shot of the current burst, picks the recoil offset */
+	UPROPERTY()
+	uint8 BurstIndex = 0;
+
+	/* Payload size on the wire, without RPC headers */
+	int32 GetNumBits() const;
+};
 
 UCLASS()
-class SHOOTER_API AShooterCharacter : public ACharacter
+class SHOOTER_API AShooterCharacter : public ACharacter, public ICombatSimInterface
 {
 	GENERATED_BODY()
 
@@ -57,7 +105,10 @@ protected:
 	/* Called when the fire weapon is pressed */
 	void FireWeapon();
 
-	bool GetBeamEndLocation(const FVector& MuzzleSocketLocation, FHitResult& OutHitResult);
+	/* Advances ShotSeq and the recoil burst, returns the spread and recoil offset of the shot about to be fired */
+	FRotator PrepareShot();
+
+	bool GetBeamEndLocation(const FVector& MuzzleSocketLocation, const FRotator& ShotOffset, FHitResult& OutHitResult);
 
 	/* Set bAiming to true or false with button press */
 	void AimingButtonPressed();
@@ -67,10 +118,28 @@ protected:
 	void FreeAimButtonPressed();
 	void FreeAimButtonReleased();
 
+	/* Interpolates the camera FOV toward the aim target, sleeps once it arrives */
 	void CameraInterpZoom(float DeltaTime);
 
+	/* Interpolates the crosshair spread factors, sleeps once all of them are at rest */
 	void CalculateCrosshairSpread(float DeltaTime);
 
+	/* One combat step of the crosshair spread: keeps the last step's multiplier to blend from, wakes on speed changes and interpolates */
+	void StepCrosshairSpread(float StepTime);
+
+	/* Restart the camera zoom after aiming was toggled */
+	void WakeCameraZoom();
+
+	/* Restart the crosshair spread after aiming, firing, speed or movement mode changed */
+	void WakeCrosshairSpread();
+
+	/* Runs the per-frame sub-systems that are awake, camera zoom and item focus. Combat runs on the combat clock instead.
+	 * Split from Tick so it can be timed on its own */
+	void TickSubsystems(float DeltaTime);
+
+	/* Wakes the crosshair spread on jumping, falling and landing */
+	virtual void OnMovementModeChanged(EMovementMode PrevMovementMode, uint8 PreviousCustomMode = 0) override;
+
 	void StartCrosshairBulletFire();
 
 	UFUNCTION()
@@ -85,8 +154,14 @@ protected:
 	UFUNCTION()
 	void AutoFireReset();
 
-	/* Line trace for items under the crosshairs */
-	bool TraceUnderCrosshairs(FHitResult& OutHitResult, FVector& OutHitLocation);
+	/* Line trace under the crosshairs, on ECC_Weapon for aiming shots or ECC_Interact for item focus. AimOffset turns the ray away from the crosshair */
+	bool TraceUnderCrosshairs(FHitResult& OutHitResult, FVector& OutHitLocation, ECollisionChannel TraceChannel = ECC_Weapon, const FRotator& AimOffset = FRotator::ZeroRotator);
+
+	/**
+	 * Same trace as TraceUnderCrosshairs, but along the view the camera will have this frame.
+	 * Built from the current control rotation and camera boom instead of last frame's camera.
+	 */
+	bool TraceFromFreshView(FHitResult& OutHitResult, FVector& OutHitLocation, const FRotator& AimOffset = FRotator::ZeroRotator);
 
 	/* Trace for items if OverlappedItemCount > 0 */
 	void TraceForItems();
@@ -97,26 +172,88 @@ protected:
 	/* Takes a weapon and attaches it to the mesh */
 	void EquipWeapon(AWeapon* WeaponToEquip);
 
-	/* Detach weapon and let it fall to ground */
+	/* Runs the client side of EquipWeapon for the weapon the server equipped */
+	UFUNCTION()
+	void OnRep_EquippedWeapon(AWeapon* PreviousWeapon);
+
+	/* Broadcasts the ammo types whose count changed */
+	UFUNCTION()
+	void OnRep_CarriedAmmo(const TArray<int32>& PreviousCarriedAmmo);
+
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/* Detach weapon and let it fall to ground. Server only */
 	void DropWeapon();
 
 	
 	void SelectButtonPressed();
 	void SelectButtonReleased();
 
-	/* Drops currently equipped Weapon and Equips TraceHitItem */
+	/* Drops currently equipped Weapon and Equips TraceHitItem. Server only */
 	void SwapWeapon(AWeapon* WeaponToSwap);
 
-	/* Initialize the Ammo Map with ammo values */
-	void InitializeAmmoMap();
+	/* Fills CarriedAmmo with the starting ammo values */
+	void InitializeCarriedAmmo();
+
+	/* Sets the carried ammo of AmmoType and broadcasts CarriedAmmoChangedDelegate */
+	void SetCarriedAmmo(EAmmoType AmmoType, int32 Amount);
+
+	/* Sets CombatState and broadcasts CombatStateChangedDelegate */
+	void SetCombatState(ECombatState NewCombatState);
+
+	/* Puts Record into Inventory at SlotIndex and broadcasts InventorySlotChangedDelegate. Server only, clients get slots through InventorySlots */
+	void SetInventorySlot(int32 SlotIndex, const FInventoryWeaponRecord& Record);
+
+	/* Stores Weapon's record in SlotIndex, flagged as the equipped slot when Weapon is the one in hand */
+	void SetInventoryWeapon(int32 SlotIndex, AWeapon* Weapon, bool bEquipped);
 
 	/* Check to make sure our weapon has ammo */
 	bool WeaponHasAmmo();
 
 	/* Fire weapon functions*/
 	void PlayFireSound();
-	void SendBullet();
+	void SendBullet(const FRotator& ShotOffset);
+
+	/* Spawns the equipped grenade weapon's grenade and throws it along Direction. Server only */
+	void ThrowGrenade(const FVector& Start, const FVector& Direction);
 	void PlayGunfireMontage();
+
+	/* Impact FX, hit numbers and, on the server, damage for one bullet */
+	void ProcessBulletHit(const FHitResult& BeamHitResult);
+
+	/* Surface effects and bullet hole for a hit on anything that doesn't handle bullets itself */
+	void SpawnImpactEffects(const FHitResult& BeamHitResult);
+
+	/* Start and direction of the ray shots are resolved along */
+	void GetShotViewRay(FVector& OutStart, FVector& OutDirection) const;
+
+	/* Client side of a predicted shot, after ammo was taken locally */
+	void SendShotToServer();
+
+	/* Server checks on a client shot: ammo, fire rate, age and view origin */
+	bool ValidateShot(const FShotRequest& Shot) const;
+
+	UFUNCTION(Server, Reliable)
+	void ServerFire(const FShotRequest& Shot);
+
+	UFUNCTION(Server, Reliable)
+	void ServerReload();
+
+	/* The server turns the record in NewItemIndex into the equipped weapon, the client only plays the montage */
+	UFUNCTION(Server, Reliable)
+	void ServerExchangeInventoryItems(uint8 NewItemIndex);
+
+	/* The server runs Item's curve too and picks it up at the end, the client's curve is only for show */
+	UFUNCTION(Server, Reliable)
+	void ServerPickupItem(AItem* Item);
+
+	/* Server result after a mispredicted shot or a reload. Seq is the last shot the server has seen */
+	UFUNCTION(Client, Reliable)
+	void ClientCorrectAmmo(uint8 Seq, int32 WeaponAmmo, int32 NewCarriedAmmo);
+
+	/* Tracer and sound for everyone except the shooter, who already predicted them */
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastShotFX(FVector_NetQuantize HitLocation);
 	
 	/* Reload Weapon functions and varaibles */
 	void ReloadButtonPressed();
@@ -148,9 +285,25 @@ public:
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+	/* ICombatSimInterface: the fire timer and crosshair spread, stepped for as long as the character lives */
+	virtual bool CombatStep(float StepTime, double SimTime) override;
+	virtual void CombatPresent(float Alpha) override;
+	virtual uint32 GetCombatStateHash() const override;
+
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
+	/* Logs bytes per shot, rejected shots and ammo corrections of this character */
+	void LogNetStats() const;
+
+	/* Logs input-to-trace and input-to-FX latency percentiles of the shots fired so far */
+	UFUNCTION(Exec)
+	void ReportShotLatency();
+
+	/* Logs the cost of the per-frame sub-systems while idle and while every one of them is awake */
+	UFUNCTION(Exec)
+	void BenchmarkCharacterTick(int32 Iterations);
+
 private: 
 
 	/* Camera boom position the camera behind the character*/
@@ -209,10 +362,23 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	float ZoomInterpSpeed;
 
-	/* Determines the spread of the crosshairs */
+	/* True while the camera FOV is still moving toward its target */
+	bool bCameraZoomActive;
+
+	/* True while any crosshair spread factor is still moving toward its target */
+	bool bCrosshairSpreadActive;
+
+	/* Ground speed the velocity factor was last computed for */
+	float CrosshairLastSpeed;
+
+	/* Determines the spread of the crosshairs, as of the last combat step */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Crosshairs, meta = (AllowPrivateAccess = "true"))
 	float CrosshairSpreadMultiplier;
 
+	/* CrosshairSpreadMultiplier of the step before, and how far the frame is between the two */
+	float PreviousCrosshairSpreadMultiplier;
+	float CrosshairPresentAlpha;
+
 	/* Velocity component for crosshairs spread */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Crosshairs, meta = (AllowPrivateAccess = "true"))
 	float CrosshairVelocityFactor;
@@ -235,8 +401,11 @@ private:
 	/* True when bullet is fired */
 	bool bFiringBullet;
 
-	/* Set a timer between when the bullet is fired and when the crosshair returns back to normal */
-	FTimerHandle CrosshairShootTimer;
+	/* Shots only run their timers, ammo and slide: no trace, sound, montage or RPC. Set on the combat clock's determinism check fighter */
+	bool bDryFire;
+
+	/* Combat clock time the crosshair returns back to normal after a bullet is fired */
+	double CrosshairShootEndTime;
 
 	/* Left mouse button or right console trigger pressed */
 	bool bFireButtonPressed;
@@ -245,8 +414,64 @@ private:
 	bool bShouldfire;
 
 
-	/* Sets a timer between gunshots */
-	FTimerHandle AutoFireTimer;
+	/* Combat clock time the next gunshot is allowed */
+	double AutoFireSimTime;
+
+	/* Platform time of the input that caused the shot being fired, 0 for scripted shots */
+	double ShotInputTime;
+
+	/* Platform time the next gunshot is due, the "input" time of automatic shots */
+	double AutoFireDueTime;
+
+	/* Shots fired, tags the per-shot latency log */
+	int32 ShotCount;
+
+	/* Input to crosshair trace, in ms */
+	FPercentileSampler InputToTraceMs;
+
+	/* Input to beam and impact FX spawned, in ms */
+	FPercentileSampler InputToFXMs;
+
+	/* Sequence number of the last shot fired. Only its low byte is sent with the shot, the server rebuilds the rest */
+	uint32 ShotSeq;
+
+	/* Seeds the spread of every shot together with its full sequence number. Set by the server, only the owner needs it */
+	UPROPERTY(Replicated)
+	int32 SpreadSeed;
+
+	/* Shot of the current burst and quantized spread of the last shot fired */
+	uint8 ShotBurstIndex;
+	uint8 ShotSpread;
+
+	/* Combat clock time of the last shot fired, a longer pause than the weapon's recoil recovery starts a new burst */
+	double LastShotTime;
+
+	/* Server: full sequence number of the last shot received from the owning client, extended from the byte each shot carries */
+	uint32 LastReceivedShotSeq;
+
+	/* Server: combat clock time of the last accepted client shot */
+	double LastServerShotTime;
+
+	/* Server: burst of the accepted client shots, a floor for the burst index they claim */
+	uint8 ServerBurstIndex;
+
+	/* How far a client shot's origin may be from the server's view of it */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Network, meta = (AllowPrivateAccess = "true"))
+	float ShotOriginTolerance;
+
+	/* How far from the server's view of the character a client may pick an item up */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Network, meta = (AllowPrivateAccess = "true"))
+	float PickupRange;
+
+	/* Network counters, client side */
+	int32 ShotsSent;
+	int64 ShotBitsSent;
+	int32 ClientCorrections;
+
+	/* Network counters, server side */
+	int32 ServerShotsReceived;
+	int32 ServerShotsRejected;
+	int32 ServerCorrections;
 
 	/* True if we should trace ever frame for items */
 	bool bShouldTraceForItems;
@@ -259,7 +484,7 @@ private:
 	class AItem* TraceHitItemLastFrame;
 
 	/* Currently equipped Weapon*/
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
+	UPROPERTY(ReplicatedUsing = OnRep_EquippedWeapon, VisibleAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	 AWeapon* EquippedWeapon;
 
 	/* Set this in Blueprints for the default Weapon class */
@@ -278,9 +503,9 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Items, meta = (AllowPrivateAccess = "true"))
 	float CameraInterpElevation;
 
-	/* Map to keep track of ammo of the different ammo types */
-	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Items, meta = (AllowPrivateAccess = "true"))
-	TMap<EAmmoType, int32> AmmoMap;
+	/* Carried ammo indexed by EAmmoType, always ECS_NAX entries. Only changed entries replicate */
+	UPROPERTY(ReplicatedUsing = OnRep_CarriedAmmo, VisibleAnywhere, BlueprintReadOnly, Category = Items, meta = (AllowPrivateAccess = "true"))
+	TArray<int32> CarriedAmmo;
 
 	/* Starting ammount of 9mm ammo */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Items, meta = (AllowPrivateAccess = "true"))
@@ -290,6 +515,10 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Items, meta = (AllowPrivateAccess = "true"))
 	int32 StartingARAmmo;
 
+	/* Starting ammount of grenades */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Items, meta = (AllowPrivateAccess = "true"))
+	int32 StartingGrenadeAmmo;
+
 	/* CombatState can only fire or reload when unoccupied */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	ECombatState CombatState;
@@ -315,9 +544,13 @@ private:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Combat, meta = (AllowPrivateAccess = "true"))
 	USceneComponent* HandSceneComponent;
 
-	/*Array AItem for Inventory*/
+	/* Weapon records indexed by slot. Only the equipped slot's weapon exists as an actor */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Inventory, meta = (AllowPrivateAccess = "true"))
-	TArray<AItem*> Inventory;
+	TArray<FInventoryWeaponRecord> Inventory;
+
+	/* Replicated copy of Inventory, sent slot by slot to the owning client */
+	UPROPERTY(Replicated)
+	FInventorySlotArray InventorySlots;
 
 	const int32 INVENTORY_CAPACITY{ 6 };
 
@@ -325,6 +558,18 @@ private:
 	UPROPERTY(BlueprintAssignable, Category = Delegates, meta = (AllowPrivateAccess = "true"))
 	FEquipItemDelegate EquipItemDelegate;
 
+	/* Broadcast when the ammo carried of one type changes */
+	UPROPERTY(BlueprintAssignable, Category = Delegates, meta = (AllowPrivateAccess = "true"))
+	FCarriedAmmoChangedDelegate CarriedAmmoChangedDelegate;
+
+	/* Broadcast when an inventory slot gets a new record */
+	UPROPERTY(BlueprintAssignable, Category = Delegates, meta = (AllowPrivateAccess = "true"))
+	FInventorySlotChangedDelegate InventorySlotChangedDelegate;
+
+	/* Broadcast when CombatState changes */
+	UPROPERTY(BlueprintAssignable, Category = Delegates, meta = (AllowPrivateAccess = "true"))
+	FCombatStateChangedDelegate CombatStateChangedDelegate;
+
 	
 	bool bAimingButtonPressed;
 
@@ -351,9 +596,35 @@ public:
 
 	void GetPickupItem(AItem* Item);
 
+	FORCEINLINE void SetDryFire(bool bDry) { bDryFire = bDry; }
 	FORCEINLINE ECombatState GetCombatState() const { return CombatState; }
 
 	FORCEINLINE AWeapon* GetEquippedWeapon() const { return EquippedWeapon; }
 
+	/* Ammo of AmmoType the character is carrying outside the magazine */
+	int32 GetCarriedAmmo(EAmmoType AmmoType) const;
+
+	FORCEINLINE const TArray<FInventoryWeaponRecord>& GetInventory() const { return Inventory; }
+	FORCEINLINE int32 GetInventoryCapacity() const { return INVENTORY_CAPACITY; }
+
+	/* Called by InventorySlots on the owning client when a slot arrives or changes */
+	void OnInventorySlotReplicated(int32 SlotIndex, const FInventoryWeaponRecord& Record);
+
+	FORCEINLINE FEquipItemDelegate& OnEquipItem() { return EquipItemDelegate; }
+	FORCEINLINE FCarriedAmmoChangedDelegate& OnCarriedAmmoChanged() { return CarriedAmmoChangedDelegate; }
+	FORCEINLINE FInventorySlotChangedDelegate& OnInventorySlotChanged() { return InventorySlotChangedDelegate; }
+	FORCEINLINE FCombatStateChangedDelegate& OnCombatStateChanged() { return CombatStateChangedDelegate; }
+
+	/* Scripted control for perf scenarios and bots, goes through the same handlers as player input */
+	void ScriptedFire(bool bPressed);
+	void ScriptedAim(bool bAim);
+	void ScriptedReload();
+
+	/* Equips the inventory slot, same as the number keys */
+	void ScriptedSelectSlot(int32 SlotIndex);
+
+	/* Tops up the magazine and the carried ammo of every type to the starting amounts */
+	void ScriptedRefillAmmo();
+
 	
 };
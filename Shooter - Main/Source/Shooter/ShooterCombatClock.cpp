@@ -0,0 +1,438 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterCombatClock.h"
+#include "Shooter.h"
+#include "Engine/World.h"
+#include "Kismet/GameplayStatics.h"
+#include "Misc/App.h"
+#include "Math/RandomStream.h"
+#include "EngineUtils.h"
+#include "CombatSimInterface.h"
+#include "ShooterCharacter.h"
+#include "Weapon.h"
+#include "Enemy.h"
+#include "ShooterReplaySubsystem.h"
+#include "ShooterStats.h"
+
+static TAutoConsoleVariable<int32> CVarCombatStepHz(
+	TEXT("Shooter.Combat.StepHz"),
+	60,
+	TEXT("Combat steps per second, e.g. 60 or 120. 0 steps once per frame with the frame's time, which ties combat to the frame rate."));
+
+static TAutoConsoleVariable<int32> CVarCombatMaxSteps(
+	TEXT("Shooter.Combat.MaxSteps"),
+	8,
+	TEXT("Most combat steps run in one frame. Time beyond them is dropped, so a long frame can't snowball into longer ones."));
+
+static TAutoConsoleVariable<int32> CVarCombatHeadless(
+	TEXT("Shooter.Combat.Headless"),
+	-1,
+	TEXT("1 runs only the combat steps and never blends visual state, 0 always blends. -1 is headless on dedicated servers and with -nullrhi."));
+
+static FAutoConsoleCommandWithWorld CombatCheckDeterminismCommand(
+	TEXT("Shooter.Combat.CheckDeterminism"),
+	TEXT("Plays a scripted fight with the local character's class and weapon at several frame rates and checks they end up identical."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UShooterCombatClock* Clock = World->GetSubsystem<UShooterCombatClock>();
+		AShooterCharacter* Character = Cast<AShooterCharacter>(UGameplayStatics::GetPlayerPawn(World, 0));
+		if (Clock == nullptr || Character == nullptr || Character->GetEquippedWeapon() == nullptr) return;
+
+		// Any enemy in the level will do for the hit-react windows
+		TActorIterator<AEnemy> EnemyIt(World);
+		UClass* EnemyClass = EnemyIt ? EnemyIt->GetClass() : nullptr;
+
+		// Out of the way above the player, the fight is over before anything there ticks
+		TArray<FString> Failures;
+		if (Clock->CheckDeterminism(Character->GetClass(), Character->GetEquippedWeapon()->GetClass(), EnemyClass,
+			Character->GetActorLocation() + FVector(0.f, 0.f, 5000.f), Failures))
+		{
+			UE_LOG(LogShooter, Log, TEXT("Combat step is deterministic across frame rates"));
+		}
+		for (const FString& Failure : Failures)
+		{
+			UE_LOG(LogShooter, Error, TEXT("Combat step differs: %s"), *Failure);
+		}
+	}));
+
+namespace ShooterCombat
+{
+	/* Sim time the scripted fight of the determinism check runs for */
+	constexpr double DeterminismSeconds = 2.0;
+
+	/* Seed of the jittered frame times and the fight's random draws, fixed so a failure can be reproduced */
+	constexpr int32 JitterSeed = 0x5EED;
+
+	enum class EScriptedInput : uint8
+	{
+		FirePressed,
+		FireReleased,
+		AimPressed,
+		AimReleased,
+		PickUp,
+		Hit
+	};
+
+	struct FScriptedInput
+	{
+		double Time;
+		EScriptedInput Input;
+	};
+
+	/* Applied on the first step starting at or after Time, like input buffered with the step it belongs to */
+	const FScriptedInput ScriptedInputs[] =
+	{
+		{ 0.0, EScriptedInput::FirePressed },
+		{ 0.3, EScriptedInput::AimPressed },
+		{ 0.5, EScriptedInput::PickUp },
+		{ 0.6, EScriptedInput::Hit },
+		{ 1.0, EScriptedInput::FireReleased },
+		{ 1.2, EScriptedInput::Hit },
+		{ 1.4, EScriptedInput::AimReleased },
+		{ 1.5, EScriptedInput::FirePressed },
+		{ 1.8, EScriptedInput::FireReleased }
+	};
+
+	struct FFrameRateProfile
+	{
+		const TCHAR* Name;
+		float MinFrameTime;
+		float MaxFrameTime;
+	};
+
+	/* The first profile is the reference the others are compared against */
+	const FFrameRateProfile FrameRateProfiles[] =
+	{
+		{ TEXT("60 fps"), 1.f / 60.f, 1.f / 60.f },
+		{ TEXT("30 fps"), 1.f / 30.f, 1.f / 30.f },
+		{ TEXT("144 fps"), 1.f / 144.f, 1.f / 144.f },
+		{ TEXT("240 fps"), 1.f / 240.f, 1.f / 240.f },
+		{ TEXT("jittered 20 to 250 fps"), 1.f / 250.f, 1.f / 20.f },
+		{ TEXT("hitching 4 fps"), 1.f / 4.f, 1.f / 4.f }
+	};
+}
+
+int32 FShooterFixedStep::Advance(float FrameTime)
+{
+	if (StepTime <= 0.f) return 0;
+
+	Accumulator += FrameTime;
+
+	int32 NumSteps{ 0 };
+	while (Accumulator >= StepTime && NumSteps < MaxSteps)
+	{
+		Accumulator -= StepTime;
+		++NumSteps;
+	}
+
+	// Out of steps, drop the whole steps still owed and keep the fraction for the blend
+	if (Accumulator >= StepTime)
+	{
+		const double Dropped{ FMath::FloorToDouble(Accumulator / StepTime) };
+		DroppedSteps += static_cast<int32>(Dropped);
+		Accumulator -= Dropped * StepTime;
+	}
+	return NumSteps;
+}
+
+void UShooterCombatClock::Deinitialize()
+{
+	Sims.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UShooterCombatClock::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterCombatClock, STATGROUP_Tickables);
+}
+
+void UShooterCombatClock::Tick(float DeltaTime)
+{
+	const int32 StepHz{ CVarCombatStepHz.GetValueOnGameThread() };
+	float Alpha{ 1.f };
+
+	if (StepHz > 0)
+	{
+		FixedStep.StepTime = 1.f / StepHz;
+		FixedStep.MaxSteps = FMath::Max(CVarCombatMaxSteps.GetValueOnGameThread(), 1);
+
+		const int32 NumSteps{ FixedStep.Advance(DeltaTime) };
+		for (int32 StepIndex = 0; StepIndex < NumSteps; ++StepIndex)
+		{
+			Step(FixedStep.StepTime);
+		}
+		Alpha = FixedStep.GetAlpha();
+	}
+	else
+	{
+		FixedStep.Accumulator = 0.0;
+		Step(DeltaTime);
+	}
+
+	if (!IsHeadless())
+	{
+		for (const FManagedSim& Managed : Sims)
+		{
+			if (Managed.Object.IsValid())
+			{
+				Managed.Sim->CombatPresent(Alpha);
+			}
+		}
+	}
+
+	Sims.RemoveAll([](const FManagedSim& Managed)
+	{
+		return Managed.bFinished || !Managed.Object.IsValid();
+	});
+}
+
+void UShooterCombatClock::Step(float StepTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterCombatStep);
+	CSV_SCOPED_TIMING_STAT(Shooter, CombatStep);
+
+	if (ScriptStep)
+	{
+		ScriptStep(SimTime);
+	}
+
+	SimTime += StepTime;
+	++SimFrame;
+
+	// Objects registered during the step start on the next one
+	const int32 NumSims{ Sims.Num() };
+	for (int32 Index = 0; Index < NumSims; ++Index)
+	{
+		if (Sims[Index].bFinished || !Sims[Index].Object.IsValid()) continue;
+
+		// A step may register others and grow the array, index it again afterwards
+		if (!Sims[Index].Sim->CombatStep(StepTime, SimTime))
+		{
+			Sims[Index].bFinished = true;
+		}
+	}
+}
+
+void UShooterCombatClock::Register(UObject* Object)
+{
+	ICombatSimInterface* Sim = Cast<ICombatSimInterface>(Object);
+	if (Sim == nullptr) return;
+
+	for (FManagedSim& Managed : Sims)
+	{
+		if (Managed.Object.Get() == Object)
+		{
+			Managed.bFinished = false;
+			return;
+		}
+	}
+	Sims.Add({ Object, Sim, false });
+}
+
+void UShooterCombatClock::Unregister(UObject* Object)
+{
+	// Only marked, Unregister may be called from inside a step
+	for (FManagedSim& Managed : Sims)
+	{
+		if (Managed.Object.Get() == Object)
+		{
+			Managed.bFinished = true;
+		}
+	}
+}
+
+bool UShooterCombatClock::IsHeadless() const
+{
+	const int32 Headless{ CVarCombatHeadless.GetValueOnGameThread() };
+	if (Headless >= 0) return Headless != 0;
+
+	return IsRunningDedicatedServer() || !FApp::CanEverRender();
+}
+
+bool UShooterCombatClock::CheckDeterminism(TSubclassOf<AShooterCharacter> CharacterClass, TSubclassOf<AWeapon> WeaponClass, TSubclassOf<AEnemy> EnemyClass,
+	const FVector& Location, TArray<FString>& OutFailures)
+{
+	if (CharacterClass == nullptr || WeaponClass == nullptr)
+	{
+		OutFailures.Add(TEXT("no character or weapon class to fight with"));
+		return false;
+	}
+	if (CVarCombatStepHz.GetValueOnGameThread() <= 0)
+	{
+		OutFailures.Add(TEXT("Shooter.Combat.StepHz is 0, combat follows the frame rate"));
+		return false;
+	}
+
+	const int32 NumFailures{ OutFailures.Num() };
+
+	// Put the live fight aside, every run starts its own from zero
+	TArray<FManagedSim> SavedSims{ MoveTemp(Sims) };
+	const FShooterFixedStep SavedFixedStep{ FixedStep };
+	const double SavedSimTime{ SimTime };
+	const uint32 SavedSimFrame{ SimFrame };
+
+	// Hit-react windows are drawn from the replay stream, every run draws the same ones
+	UShooterReplaySubsystem* Replay = GetWorld()->GetSubsystem<UShooterReplaySubsystem>();
+	const FRandomStream SavedStream{ Replay ? Replay->GetRandomStream() : FRandomStream() };
+
+	uint32 ReferenceHash{ 0 };
+	for (int32 Index = 0; Index < UE_ARRAY_COUNT(ShooterCombat::FrameRateProfiles); ++Index)
+	{
+		const ShooterCombat::FFrameRateProfile& Profile = ShooterCombat::FrameRateProfiles[Index];
+
+		Sims.Reset();
+		FixedStep = FShooterFixedStep();
+		SimTime = 0.0;
+		SimFrame = 0;
+		if (Replay)
+		{
+			Replay->GetRandomStream().Initialize(ShooterCombat::JitterSeed);
+		}
+
+		FRandomStream Jitter(ShooterCombat::JitterSeed);
+		uint32 Hash{ 0 };
+		int32 Frames{ 0 };
+		if (!PlayScriptedFight(CharacterClass, WeaponClass, EnemyClass, Location, [&Profile, &Jitter]()
+		{
+			return Jitter.FRandRange(Profile.MinFrameTime, Profile.MaxFrameTime);
+		}, Hash, Frames))
+		{
+			OutFailures.Add(FString::Printf(TEXT("%s: could not spawn the fight"), Profile.Name));
+			break;
+		}
+
+		UE_LOG(LogShooter, Log, TEXT("Combat determinism: %u steps of %.2f ms in %d frames at %s, %d steps dropped, hash %08x"),
+			SimFrame, FixedStep.StepTime * 1000.f, Frames, Profile.Name, FixedStep.DroppedSteps, Hash);
+
+		if (Index == 0)
+		{
+			ReferenceHash = Hash;
+		}
+		else if (Hash != ReferenceHash)
+		{
+			OutFailures.Add(FString::Printf(TEXT("%s hashes to %08x, %s to %08x"),
+				Profile.Name, Hash, ShooterCombat::FrameRateProfiles[0].Name, ReferenceHash));
+		}
+	}
+
+	Sims = MoveTemp(SavedSims);
+	FixedStep = SavedFixedStep;
+	SimTime = SavedSimTime;
+	SimFrame = SavedSimFrame;
+	if (Replay)
+	{
+		Replay->GetRandomStream() = SavedStream;
+	}
+	return OutFailures.Num() == NumFailures;
+}
+
+bool UShooterCombatClock::PlayScriptedFight(TSubclassOf<AShooterCharacter> CharacterClass, TSubclassOf<AWeapon> WeaponClass, TSubclassOf<AEnemy> EnemyClass,
+	const FVector& Location, TFunctionRef<float()> NextFrameTime, uint32& OutHash, int32& OutFrames)
+{
+	UWorld* World = GetWorld();
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	// The character registers itself and spawns its default weapon from BeginPlay, like a player's would
+	AShooterCharacter* Character = World->SpawnActor<AShooterCharacter>(CharacterClass, Location, FRotator::ZeroRotator, SpawnParams);
+	AWeapon* GroundWeapon = World->SpawnActor<AWeapon>(WeaponClass, Location + FVector(200.f, 0.f, 0.f), FRotator::ZeroRotator, SpawnParams);
+	AEnemy* Enemy = EnemyClass ? World->SpawnActor<AEnemy>(EnemyClass, Location + FVector(600.f, 0.f, 0.f), FRotator::ZeroRotator, SpawnParams) : nullptr;
+	AWeapon* HeldWeapon = Character ? Character->GetEquippedWeapon() : nullptr;
+
+	const bool bSpawned{ Character && GroundWeapon && HeldWeapon };
+	if (bSpawned)
+	{
+		Character->SetDryFire(true);
+
+		uint32 Hash{ 0 };
+		const auto HashFight = [&]()
+		{
+			Hash = HashCombine(Hash, Character->GetCombatStateHash());
+			Hash = HashCombine(Hash, HeldWeapon->GetCombatStateHash());
+			Hash = HashCombine(Hash, GroundWeapon->GetCombatStateHash());
+			if (Enemy)
+			{
+				Hash = HashCombine(Hash, Enemy->GetCombatStateHash());
+			}
+		};
+
+		int32 NextInput{ 0 };
+		ScriptStep = [&](double StepStartTime)
+		{
+			// State as the last step left it, then the input due on this one
+			HashFight();
+			while (NextInput < UE_ARRAY_COUNT(ShooterCombat::ScriptedInputs) && StepStartTime >= ShooterCombat::ScriptedInputs[NextInput].Time)
+			{
+				switch (ShooterCombat::ScriptedInputs[NextInput].Input)
+				{
+				case ShooterCombat::EScriptedInput::FirePressed:
+					Character->ScriptedFire(true);
+					break;
+
+				case ShooterCombat::EScriptedInput::FireReleased:
+					Character->ScriptedFire(false);
+					break;
+
+				case ShooterCombat::EScriptedInput::AimPressed:
+					Character->ScriptedAim(true);
+					break;
+
+				case ShooterCombat::EScriptedInput::AimReleased:
+					Character->ScriptedAim(false);
+					break;
+
+				case ShooterCombat::EScriptedInput::PickUp:
+					GroundWeapon->StartItemCurve(Character);
+					break;
+
+				case ShooterCombat::EScriptedInput::Hit:
+					if (Enemy)
+					{
+						FHitResult HitResult;
+						HitResult.TraceStart = Character->GetActorLocation();
+						HitResult.TraceEnd = Enemy->GetActorLocation();
+						HitResult.Location = HitResult.TraceEnd;
+						Enemy->BulletHit_Implementation(HitResult);
+					}
+					break;
+
+				default:
+					break;
+				}
+				++NextInput;
+			}
+		};
+
+		// The real frame path, MaxSteps and presenting included
+		OutFrames = 0;
+		while (SimTime < ShooterCombat::DeterminismSeconds)
+		{
+			Tick(NextFrameTime());
+			++OutFrames;
+		}
+		HashFight();
+		ScriptStep = nullptr;
+		OutHash = Hash;
+	}
+
+	// A picked up weapon went to the weapon pool, which keeps it
+	if (GroundWeapon && GroundWeapon->GetItemState() != EItemState::EIS_PickedUp)
+	{
+		GroundWeapon->Destroy();
+	}
+	if (Enemy)
+	{
+		Enemy->Destroy();
+	}
+	if (HeldWeapon)
+	{
+		HeldWeapon->Destroy();
+	}
+	if (Character)
+	{
+		Character->Destroy();
+	}
+	return bSpawned;
+}
@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShooterTickableWorldSubsystem.h"
+#include "ShooterCombatClock.generated.h"
+
+class ICombatSimInterface;
+class AShooterCharacter;
+class AWeapon;
+class AEnemy;
+
+/* Turns variable frame times into a whole number of fixed steps, carrying the remainder to the next frame */
+struct SHOOTER_API FShooterFixedStep
+{
+	float StepTime = 1.f / 60.f;
+
+	/* Steps one frame may run. A frame longer than this drops the rest instead of falling further behind */
+	int32 MaxSteps = 8;
+
+	/* Frame time not yet stepped, always less than StepTime after Advance */
+	double Accumulator = 0.0;
+
+	/* Steps dropped so far by frames owing more than MaxSteps */
+	int32 DroppedSteps = 0;
+
+	/* Adds a frame's time, returns the number of steps due */
+	int32 Advance(float FrameTime);
+
+	/* How far the frame is between the last step and the next one, for blending visual state */
+	FORCEINLINE float GetAlpha() const { return StepTime > 0.f ? static_cast<float>(Accumulator / StepTime) : 1.f; }
+};
+
+/**
+ * Runs combat on a fixed timestep, Shooter.Combat.StepHz steps per second whatever the frame rate: fire timers,
+ * crosshair spread, item interpolation, the pistol slide and hit-react windows. Objects implementing
+ * ICombatSimInterface register while they have something to simulate and are stepped in order of registration.
+ * After the steps of a frame they blend their visual state by the leftover fraction of a step.
+ * Headless servers skip that blend and only run the steps.
+ */
+UCLASS()
+class SHOOTER_API UShooterCombatClock : public UShooterTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	/* FTickableGameObject interface */
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/* Starts stepping Object from the next step on. Registering twice does nothing */
+	void Register(UObject* Object);
+
+	void Unregister(UObject* Object);
+
+	/* True when visual state is not blended: dedicated servers and -nullrhi, or as Shooter.Combat.Headless says */
+	bool IsHeadless() const;
+
+	/**
+	 * Plays a scripted fight through Tick at several frame rates, some long enough to hit MaxSteps, and compares the
+	 * fight's combat state after every step bit for bit. The fight spawns its own character of CharacterClass, a weapon
+	 * of WeaponClass for it to pick up and, when EnemyClass is set, an enemy it hits, all near Location.
+	 * The clock's own objects and time are put aside meanwhile. Adds a line to OutFailures for each frame rate
+	 * that differs from the first, returns true when none do.
+	 */
+	bool CheckDeterminism(TSubclassOf<AShooterCharacter> CharacterClass, TSubclassOf<AWeapon> WeaponClass, TSubclassOf<AEnemy> EnemyClass,
+		const FVector& Location, TArray<FString>& OutFailures);
+
+	/* Time at the end of the last step. Combat deadlines are set and checked against it */
+	FORCEINLINE double GetSimTime() const { return SimTime; }
+
+	FORCEINLINE uint32 GetSimFrame() const { return SimFrame; }
+	FORCEINLINE float GetStepTime() const { return FixedStep.StepTime; }
+	FORCEINLINE int32 GetNumSims() const { return Sims.Num(); }
+
+private:
+
+	struct FManagedSim
+	{
+		TWeakObjectPtr<UObject> Object;
+		ICombatSimInterface* Sim;
+
+		/* Returned false from its last step. Still presented this frame, removed after */
+		bool bFinished;
+	};
+
+	/* Runs one step of StepTime on every registered object */
+	void Step(float StepTime);
+
+	/* One run of the determinism check's fight, ticked with frame times from NextFrameTime until it has played out */
+	bool PlayScriptedFight(TSubclassOf<AShooterCharacter> CharacterClass, TSubclassOf<AWeapon> WeaponClass, TSubclassOf<AEnemy> EnemyClass,
+		const FVector& Location, TFunctionRef<float()> NextFrameTime, uint32& OutHash, int32& OutFrames);
+
+	/* Set while the determinism check plays its fight, runs at the start of every step with the time it starts at */
+	TFunction<void(double)> ScriptStep;
+
+	TArray<FManagedSim> Sims;
+
+	FShooterFixedStep FixedStep;
+
+	double SimTime = 0.0;
+
+	uint32 SimFrame = 0;
+};
@@ -0,0 +1,258 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterDeathManager.h"
+#include "Shooter.h"
+#include "Enemy.h"
+#include "ShooterGameModeBase.h"
+#include "ShooterLLM.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Kismet/GameplayStatics.h"
+
+static TAutoConsoleVariable<int32> CVarDeathMaxRagdolls(
+	TEXT("Shooter.Death.MaxRagdolls"),
+	8,
+	TEXT("Most enemy ragdolls simulating at once. Deaths over the cap play an animated death."));
+
+static TAutoConsoleVariable<float> CVarDeathSettleSpeed(
+	TEXT("Shooter.Death.SettleSpeed"),
+	10.f,
+	TEXT("Ragdolls slower than this (cm/s) count as resting."));
+
+static TAutoConsoleVariable<float> CVarDeathSettleTime(
+	TEXT("Shooter.Death.SettleTime"),
+	0.5f,
+	TEXT("Seconds a ragdoll must rest before its pose is frozen."));
+
+static TAutoConsoleVariable<float> CVarDeathMaxRagdollTime(
+	TEXT("Shooter.Death.MaxRagdollTime"),
+	4.f,
+	TEXT("Ragdolls are frozen after this many seconds even if they never settle."));
+
+static FAutoConsoleCommandWithWorldAndArgs DeathStressCommand(
+	TEXT("Shooter.Death.Stress"),
+	TEXT("Shooter.Death.Stress [NumDeaths=100] [Duration=1]. Kills enemies over Duration seconds and logs ragdoll and frame time stats."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UShooterDeathManager* DeathManager = World ? World->GetSubsystem<UShooterDeathManager>() : nullptr;
+		if (DeathManager)
+		{
+			const int32 NumDeaths{ Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 100 };
+			const float Duration{ Args.Num() > 1 ? FCString::Atof(*Args[1]) : 1.f };
+			DeathManager->RunStressTest(NumDeaths, Duration);
+		}
+	}));
+
+void UShooterDeathManager::Deinitialize()
+{
+	DyingBodies.Empty();
+	NumSimulatingRagdolls = 0;
+
+	Super::Deinitialize();
+}
+
+TStatId UShooterDeathManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterDeathManager, STATGROUP_Tickables);
+}
+
+void UShooterDeathManager::HandleDeath(AEnemy* Enemy)
+{
+	if (Enemy == nullptr) return;
+
+	FDyingBody Body;
+	Body.Enemy = Enemy;
+	Body.StartTime = GetWorld()->GetTimeSeconds();
+	Body.RestTime = 0.f;
+	Body.FreezeTime = 0.f;
+
+	if (NumSimulatingRagdolls < CVarDeathMaxRagdolls.GetValueOnGameThread())
+	{
+		Body.Mode = EDeathMode::Ragdoll;
+		Enemy->StartRagdoll();
+		++NumSimulatingRagdolls;
+	}
+	else
+	{
+		// Over the physics budget, the death animation costs no simulation
+		Body.Mode = EDeathMode::Animated;
+		Body.FreezeTime = Body.StartTime + Enemy->PlayDeathMontage();
+
+		if (StressTest.bRunning)
+		{
+			++StressTest.NumAnimated;
+		}
+	}
+
+	DyingBodies.Add(Body);
+}
+
+void UShooterDeathManager::CancelDeath(AEnemy* Enemy)
+{
+	for (int32 Index = DyingBodies.Num() - 1; Index >= 0; --Index)
+	{
+		if (DyingBodies[Index].Enemy == Enemy)
+		{
+			if (DyingBodies[Index].Mode == EDeathMode::Ragdoll)
+			{
+				--NumSimulatingRagdolls;
+			}
+			DyingBodies.RemoveAtSwap(Index);
+		}
+	}
+}
+
+void UShooterDeathManager::Tick(float DeltaTime)
+{
+	const float WorldTime{ GetWorld()->GetTimeSeconds() };
+	const float SettleSpeedSquared{ FMath::Square(CVarDeathSettleSpeed.GetValueOnGameThread()) };
+	const float SettleTime{ CVarDeathSettleTime.GetValueOnGameThread() };
+	const float MaxRagdollTime{ CVarDeathMaxRagdollTime.GetValueOnGameThread() };
+
+	for (int32 Index = DyingBodies.Num() - 1; Index >= 0; --Index)
+	{
+		FDyingBody& Body = DyingBodies[Index];
+		AEnemy* Enemy = Body.Enemy.Get();
+		if (Enemy == nullptr)
+		{
+			if (Body.Mode == EDeathMode::Ragdoll)
+			{
+				--NumSimulatingRagdolls;
+			}
+			DyingBodies.RemoveAtSwap(Index);
+			continue;
+		}
+
+		if (Body.Mode == EDeathMode::Ragdoll)
+		{
+			const FVector Velocity{ Enemy->GetMesh()->GetPhysicsLinearVelocity() };
+			Body.RestTime = Velocity.SizeSquared() < SettleSpeedSquared ? Body.RestTime + DeltaTime : 0.f;
+
+			if (Body.RestTime >= SettleTime || WorldTime - Body.StartTime >= MaxRagdollTime)
+			{
+				FinishDeath(Index);
+			}
+		}
+		else if (WorldTime >= Body.FreezeTime)
+		{
+			FinishDeath(Index);
+		}
+	}
+
+	if (StressTest.bRunning)
+	{
+		TickStressTest(DeltaTime);
+	}
+}
+
+void UShooterDeathManager::FinishDeath(int32 BodyIndex)
+{
+	const FDyingBody Body = DyingBodies[BodyIndex];
+	DyingBodies.RemoveAtSwap(BodyIndex);
+
+	if (Body.Mode == EDeathMode::Ragdoll)
+	{
+		--NumSimulatingRagdolls;
+	}
+
+	// The enemy broadcasts EnemyDeathFinishedDelegate, a pool may take the body back from there
+	Body.Enemy->FreezeDeathPose();
+}
+
+void UShooterDeathManager::RunStressTest(int32 NumDeaths, float Duration)
+{
+	if (StressTest.bRunning || NumDeaths <= 0) return;
+
+	StressTest = FStressTest();
+
+	// Use living enemies first, then fill up from the wave pools or copies of an existing enemy
+	UClass* EnemyClass = nullptr;
+	FVector SpawnOrigin{ FVector::ZeroVector };
+	for (TActorIterator<AEnemy> It(GetWorld()); It && StressTest.Victims.Num() < NumDeaths; ++It)
+	{
+		EnemyClass = It->GetClass();
+		if (It->IsHidden() || It->IsDying()) continue;
+
+		SpawnOrigin = It->GetActorLocation();
+		StressTest.Victims.Add(*It);
+	}
+
+	if (EnemyClass == nullptr)
+	{
+		UE_LOG(LogShooter, Warning, TEXT("Death stress test needs at least one enemy in the world"));
+		return;
+	}
+
+	AShooterGameModeBase* GameMode = Cast<AShooterGameModeBase>(UGameplayStatics::GetGameMode(this));
+	while (StressTest.Victims.Num() < NumDeaths)
+	{
+		// Spread the extra enemies on a grid so their capsules don't start interpenetrating
+		const int32 GridIndex{ StressTest.Victims.Num() };
+		const FVector Offset{ (GridIndex % 10) * 150.f, (GridIndex / 10) * 150.f, 0.f };
+		const FTransform SpawnTransform{ FRotator::ZeroRotator, SpawnOrigin + Offset };
+
+		AEnemy* Enemy = nullptr;
+		if (GameMode)
+		{
+			Enemy = GameMode->AcquireEnemy(EnemyClass);
+			if (Enemy)
+			{
+				Enemy->ActivateFromPool(SpawnTransform);
+			}
+		}
+		else
+		{
+			SHOOTER_LLM_SCOPE(Enemies);
+			FActorSpawnParameters SpawnParams;
+			SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+			Enemy = GetWorld()->SpawnActor<AEnemy>(EnemyClass, SpawnTransform, SpawnParams);
+		}
+
+		if (Enemy == nullptr) break;
+		StressTest.Victims.Add(Enemy);
+	}
+
+	StressTest.DeathInterval = Duration / StressTest.Victims.Num();
+	StressTest.bRunning = true;
+
+	UE_LOG(LogShooter, Log, TEXT("Death stress test: %d deaths over %.2fs, ragdoll cap %d"),
+		StressTest.Victims.Num(), Duration, CVarDeathMaxRagdolls.GetValueOnGameThread());
+}
+
+void UShooterDeathManager::TickStressTest(float DeltaTime)
+{
+	StressTest.Elapsed += DeltaTime;
+	StressTest.TimeUntilNextDeath -= DeltaTime;
+
+	while (StressTest.TimeUntilNextDeath <= 0.f && StressTest.NextVictim < StressTest.Victims.Num())
+	{
+		AEnemy* Victim = StressTest.Victims[StressTest.NextVictim++].Get();
+		if (Victim)
+		{
+			UGameplayStatics::ApplyDamage(Victim, Victim->GetMaxHealth(), nullptr, nullptr, UDamageType::StaticClass());
+		}
+		StressTest.TimeUntilNextDeath += StressTest.DeathInterval;
+	}
+
+	const float FrameMs{ DeltaTime * 1000.f };
+	StressTest.MaxFrameMs = FMath::Max(StressTest.MaxFrameMs, FrameMs);
+	StressTest.TotalFrameMs += FrameMs;
+	++StressTest.NumFrames;
+	StressTest.PeakRagdolls = FMath::Max(StressTest.PeakRagdolls, NumSimulatingRagdolls);
+
+	// Keep measuring until every body has been frozen
+	if (StressTest.NextVictim >= StressTest.Victims.Num() && DyingBodies.Num() == 0)
+	{
+		StressTest.bRunning = false;
+
+		UE_LOG(LogShooter, Log, TEXT("Death stress test finished after %.2fs: peak ragdolls %d (cap %d), animated deaths %d, frame ms avg %.2f max %.2f"),
+			StressTest.Elapsed,
+			StressTest.PeakRagdolls,
+			CVarDeathMaxRagdolls.GetValueOnGameThread(),
+			StressTest.NumAnimated,
+			StressTest.TotalFrameMs / FMath::Max(StressTest.NumFrames, 1),
+			StressTest.MaxFrameMs);
+	}
+}
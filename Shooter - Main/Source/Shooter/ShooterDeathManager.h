@@ -0,0 +1,91 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShooterTickableWorldSubsystem.h"
+#include "ShooterDeathManager.generated.h"
+
+class AEnemy;
+
+/**
+ * Turns dying enemies into ragdolls under a global cap on simulating bodies.
+ * Settled ragdolls are frozen into a static pose; deaths over the cap play an animated death instead.
+ */
+UCLASS()
+class SHOOTER_API UShooterDeathManager : public UShooterTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	/* FTickableGameObject interface */
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/* Called from AEnemy::Die. Picks ragdoll or animated death depending on the budget */
+	void HandleDeath(AEnemy* Enemy);
+
+	/* Drops an enemy without finishing its death, e.g. when it is pooled early */
+	void CancelDeath(AEnemy* Enemy);
+
+	/* Kills NumDeaths enemies over Duration seconds and logs ragdoll counts and frame times. The Deaths perf scenario runs it against a physics time threshold */
+	void RunStressTest(int32 NumDeaths, float Duration);
+
+	FORCEINLINE int32 GetNumSimulatingRagdolls() const { return NumSimulatingRagdolls; }
+
+	/* True until every stress test victim has died and its body was frozen */
+	FORCEINLINE bool IsStressTestRunning() const { return StressTest.bRunning; }
+	FORCEINLINE int32 GetStressTestPeakRagdolls() const { return StressTest.PeakRagdolls; }
+
+private:
+
+	enum class EDeathMode : uint8
+	{
+		Ragdoll,
+		Animated
+	};
+
+	struct FDyingBody
+	{
+		TWeakObjectPtr<AEnemy> Enemy;
+		EDeathMode Mode;
+
+		/* World time the death started */
+		float StartTime;
+
+		/* Seconds the ragdoll has been below the settle speed */
+		float RestTime;
+
+		/* World time an animated death should freeze */
+		float FreezeTime;
+	};
+
+	/* Stop simulating and hold the current pose */
+	void FinishDeath(int32 BodyIndex);
+
+	void TickStressTest(float DeltaTime);
+
+	TArray<FDyingBody> DyingBodies;
+
+	int32 NumSimulatingRagdolls = 0;
+
+	/* Stress test state, running while victims are left to kill or their bodies are still settling */
+	struct FStressTest
+	{
+		TArray<TWeakObjectPtr<AEnemy>> Victims;
+		int32 NextVictim = 0;
+		float DeathInterval = 0.f;
+		float TimeUntilNextDeath = 0.f;
+		float Elapsed = 0.f;
+		int32 PeakRagdolls = 0;
+		int32 NumAnimated = 0;
+		float MaxFrameMs = 0.f;
+		double TotalFrameMs = 0.0;
+		int32 NumFrames = 0;
+		bool bRunning = false;
+	};
+	FStressTest StressTest;
+};
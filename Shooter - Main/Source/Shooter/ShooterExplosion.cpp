@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterExplosion.h"
+#include "Engine/World.h"
+#include "Kismet/GameplayStatics.h"
+#include "Async/ParallelFor.h"
+#include "Enemy.h"
+#include "ShooterStats.h"
+#include "ShooterHitchMonitor.h"
+
+static TAutoConsoleVariable<int32> CVarExplosionParallelOcclusion(
+	TEXT("Shooter.Explosion.ParallelOcclusion"),
+	16,
+	TEXT("Explosions reaching at least this many enemies run their occlusion tests on worker threads. 0 keeps them on the game thread"));
+
+namespace ShooterExplosion
+{
+	FResult Explode(UWorld* World, const FVector& Origin, const FShooterExplosion& Explosion, AActor* DamageCauser, AController* InstigatorController)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ShooterExplosion);
+		CSV_SCOPED_TIMING_STAT(Shooter, Explosion);
+
+		FResult Result;
+		if (World == nullptr || Explosion.Radius <= 0.f) return Result;
+
+		ShooterHitch::AddEvent(EShooterHitchEvent::Explosion, DamageCauser);
+
+		// One query for everything in range, instead of a sweep and a trace per component
+		TArray<FOverlapResult> Overlaps;
+		FCollisionQueryParams OverlapParams(SCENE_QUERY_STAT(ExplosionOverlap), false, DamageCauser);
+		World->OverlapMultiByObjectType(Overlaps, Origin, FQuat::Identity, FCollisionObjectQueryParams(ECC_Pawn),
+			FCollisionShape::MakeSphere(Explosion.Radius), OverlapParams);
+
+		// Struct of arrays, padded to a multiple of four so the falloff loop never needs a scalar tail
+		TArray<AEnemy*> Enemies;
+		TArray<float> X;
+		TArray<float> Y;
+		TArray<float> Z;
+		Enemies.Reserve(Overlaps.Num());
+		for (const FOverlapResult& Overlap : Overlaps)
+		{
+			AEnemy* Enemy = Cast<AEnemy>(Overlap.GetActor());
+
+			// The mesh overlaps as well, only the capsule counts so every enemy is in the batch once
+			if (Enemy == nullptr || Enemy->IsDying() || Overlap.GetComponent() != Enemy->GetRootComponent()) continue;
+
+			const FVector Location{ Enemy->GetActorLocation() };
+			Enemies.Add(Enemy);
+			X.Add(Location.X);
+			Y.Add(Location.Y);
+			Z.Add(Location.Z);
+		}
+
+		const int32 NumEnemies{ Enemies.Num() };
+		Result.Enemies = NumEnemies;
+		if (NumEnemies == 0) return Result;
+
+		const int32 NumPadded{ Align(NumEnemies, 4) };
+		X.SetNumZeroed(NumPadded);
+		Y.SetNumZeroed(NumPadded);
+		Z.SetNumZeroed(NumPadded);
+
+		TArray<float> Damage;
+		Damage.SetNumUninitialized(NumPadded);
+
+		// Linear falloff between the radii, clamped to [MinDamageFraction, 1]
+		const VectorRegister OriginX = VectorSetFloat1(Origin.X);
+		const VectorRegister OriginY = VectorSetFloat1(Origin.Y);
+		const VectorRegister OriginZ = VectorSetFloat1(Origin.Z);
+		const VectorRegister InnerRadius = VectorSetFloat1(Explosion.InnerRadius);
+		const VectorRegister InvFalloffRange = VectorSetFloat1(1.f / FMath::Max(Explosion.Radius - Explosion.InnerRadius, KINDA_SMALL_NUMBER));
+		const VectorRegister MinFraction = VectorSetFloat1(Explosion.MinDamageFraction);
+		const VectorRegister BaseDamage = VectorSetFloat1(Explosion.Damage);
+		const VectorRegister MinDistanceSquared = VectorSetFloat1(KINDA_SMALL_NUMBER);
+		for (int32 i = 0; i < NumPadded; i += 4)
+		{
+			const VectorRegister DeltaX = VectorSubtract(VectorLoad(&X[i]), OriginX);
+			const VectorRegister DeltaY = VectorSubtract(VectorLoad(&Y[i]), OriginY);
+			const VectorRegister DeltaZ = VectorSubtract(VectorLoad(&Z[i]), OriginZ);
+
+			VectorRegister DistanceSquared = VectorMultiply(DeltaX, DeltaX);
+			DistanceSquared = VectorMultiplyAdd(DeltaY, DeltaY, DistanceSquared);
+			DistanceSquared = VectorMultiplyAdd(DeltaZ, DeltaZ, DistanceSquared);
+			DistanceSquared = VectorMax(DistanceSquared, MinDistanceSquared);
+
+			const VectorRegister Distance = VectorMultiply(DistanceSquared, VectorReciprocalSqrt(DistanceSquared));
+			const VectorRegister Falloff = VectorMultiply(VectorSubtract(Distance, InnerRadius), InvFalloffRange);
+			const VectorRegister Fraction = VectorMin(VectorMax(VectorSubtract(VectorOne(), Falloff), MinFraction), VectorOne());
+			VectorStore(VectorMultiply(BaseDamage, Fraction), &Damage[i]);
+		}
+
+		// Only world geometry occludes, enemies in front don't shield the ones behind them. Scene queries only take
+		// a read lock, so a crowd's worth of tests can go wide
+		TArray<uint8> Occluded;
+		Occluded.SetNumZeroed(NumEnemies);
+		const FCollisionObjectQueryParams OcclusionObjects(ECC_WorldStatic);
+		const FCollisionQueryParams OcclusionParams(SCENE_QUERY_STAT(ExplosionOcclusion), false, DamageCauser);
+		const int32 ParallelThreshold{ CVarExplosionParallelOcclusion.GetValueOnGameThread() };
+		ParallelFor(NumEnemies, [&](int32 Index)
+		{
+			const FVector Target{ X[Index], Y[Index], Z[Index] };
+			Occluded[Index] = World->LineTraceTestByObjectType(Origin, Target, OcclusionObjects, OcclusionParams) ? 1 : 0;
+		}, ParallelThreshold <= 0 || NumEnemies < ParallelThreshold);
+		ShooterStats::AddTraces(NumEnemies);
+
+		// One damage call per enemy with everything it takes from this explosion
+		Result.Hits.Reserve(NumEnemies);
+		for (int32 Index = 0; Index < NumEnemies; ++Index)
+		{
+			float EnemyDamage{ Damage[Index] };
+			if (Occluded[Index])
+			{
+				++Result.Occluded;
+				EnemyDamage *= Explosion.OccludedDamageFraction;
+			}
+
+			const int32 RoundedDamage{ FMath::RoundToInt(EnemyDamage) };
+			if (RoundedDamage <= 0) continue;
+
+			UGameplayStatics::ApplyDamage(Enemies[Index], RoundedDamage, InstigatorController, DamageCauser, UDamageType::StaticClass());
+			Result.Hits.Emplace(Enemies[Index], RoundedDamage);
+		}
+		return Result;
+	}
+}
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShooterExplosion.generated.h"
+
+class AController;
+class AEnemy;
+
+/* Radial damage of an explosion */
+USTRUCT(BlueprintType)
+struct FShooterExplosion
+{
+	GENERATED_BODY()
+
+	/* Damage up to InnerRadius, falls off linearly from there to Radius */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Explosion)
+	float Damage = 120.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Explosion)
+	float InnerRadius = 150.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Explosion)
+	float Radius = 600.f;
+
+	/* Fraction of Damage left at Radius */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Explosion, meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float MinDamageFraction = 0.1f;
+
+	/* Fraction of the damage that gets through world geometry between the explosion and an enemy */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Explosion, meta = (ClampMin = "0.0", ClampMax = "1.0"))
+	float OccludedDamageFraction = 0.f;
+};
+
+namespace ShooterExplosion
+{
+	struct FResult
+	{
+		/* Enemies inside the radius, occluded or not */
+		int32 Enemies = 0;
+
+		/* Enemies behind world geometry */
+		int32 Occluded = 0;
+
+		/* Enemies that took damage and how much, for hit numbers */
+		TArray<TPair<AEnemy*, int32>> Hits;
+	};
+
+	/**
+	 * Damages every enemy in range of Origin. One sphere overlap finds them, falloff is computed for all of them
+	 * four at a time, occlusion tests run as one batch and each enemy then takes a single ApplyDamage.
+	 * Health only changes on the server, call it there.
+	 */
+	SHOOTER_API FResult Explode(UWorld* World, const FVector& Origin, const FShooterExplosion& Explosion, AActor* DamageCauser, AController* InstigatorController);
+}
@@ -0,0 +1,385 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterFlowFieldManager.h"
+#include "Shooter.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "NavigationSystem.h"
+#include "NavigationPath.h"
+#include "NavMesh/NavMeshBoundsVolume.h"
+
+DECLARE_STATS_GROUP(TEXT("ShooterFlowField"), STATGROUP_ShooterFlowField, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Flow field update"), STAT_FlowFieldUpdate, STATGROUP_ShooterFlowField);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cells expanded"), STAT_FlowFieldCellsExpanded, STATGROUP_ShooterFlowField);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Samples"), STAT_FlowFieldSamples, STATGROUP_ShooterFlowField);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Fields"), STAT_FlowFieldFields, STATGROUP_ShooterFlowField);
+
+static TAutoConsoleVariable<float> CVarFlowCellSize(
+	TEXT("Shooter.Flow.CellSize"),
+	100.f,
+	TEXT("Flow field cell size in cm. Grows if the level would need more than 512 cells per axis. Read when the grid is built."));
+
+static TAutoConsoleVariable<int32> CVarFlowCellsPerFrame(
+	TEXT("Shooter.Flow.CellsPerFrame"),
+	4000,
+	TEXT("Grid cells projected or expanded per frame while building the grid and rebuilding fields."));
+
+static TAutoConsoleVariable<float> CVarFlowMaxStepHeight(
+	TEXT("Shooter.Flow.MaxStepHeight"),
+	45.f,
+	TEXT("Neighbouring cells further apart in height than this are not connected."));
+
+static FAutoConsoleCommandWithWorldAndArgs FlowBenchmarkCommand(
+	TEXT("Shooter.Flow.Benchmark"),
+	TEXT("Shooter.Flow.Benchmark [NumAgents=500]. Compares flow field samples against navmesh path queries toward the first player."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UShooterFlowFieldManager* FlowFieldManager = World ? World->GetSubsystem<UShooterFlowFieldManager>() : nullptr;
+		if (FlowFieldManager)
+		{
+			FlowFieldManager->RunBenchmark(Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 500);
+		}
+	}));
+
+namespace ShooterFlowField
+{
+	constexpr int32 MaxCellsPerAxis = 512;
+
+	/* Neighbour offsets, ordered so the opposite of direction D is (D + 4) % 8 */
+	constexpr int32 NumDirections = 8;
+	constexpr int32 OffsetX[NumDirections] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+	constexpr int32 OffsetY[NumDirections] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+}
+
+void UShooterFlowFieldManager::Deinitialize()
+{
+	Fields.Empty();
+	CellHeight.Empty();
+	Walkable.Empty();
+
+	Super::Deinitialize();
+}
+
+TStatId UShooterFlowFieldManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterFlowFieldManager, STATGROUP_Tickables);
+}
+
+void UShooterFlowFieldManager::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_FlowFieldUpdate);
+
+	if (!bGridInitialized && !InitGrid()) return;
+
+	const int32 Budget{ CVarFlowCellsPerFrame.GetValueOnGameThread() };
+	if (!bGridReady)
+	{
+		BuildGridStep(Budget);
+		return;
+	}
+
+	GatherPlayers();
+
+	// Rebuild a field once its player is in another cell. A running build is finished first, restarting it
+	// on every cell change would never publish anything while the player keeps moving
+	for (FField& Field : Fields)
+	{
+		if (Field.PendingGoalCell != INDEX_NONE) continue;
+
+		// Mid-air players keep the last goal
+		const int32 PlayerCell{ LocationToCell(Field.Target->GetActorLocation()) };
+		if (PlayerCell != INDEX_NONE && Walkable[PlayerCell] && PlayerCell != Field.GoalCell)
+		{
+			StartFieldBuild(Field, PlayerCell);
+		}
+	}
+
+	CellsUpdatedLastFrame = 0;
+	for (FField& Field : Fields)
+	{
+		if (Field.PendingGoalCell == INDEX_NONE) continue;
+		if (CellsUpdatedLastFrame >= Budget) break;
+
+		CellsUpdatedLastFrame += BuildFieldStep(Field, Budget - CellsUpdatedLastFrame);
+	}
+
+	INC_DWORD_STAT_BY(STAT_FlowFieldCellsExpanded, CellsUpdatedLastFrame);
+	SET_DWORD_STAT(STAT_FlowFieldFields, Fields.Num());
+}
+
+bool UShooterFlowFieldManager::InitGrid()
+{
+	// Wait for the navigation system to have data to project onto
+	UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (NavSystem == nullptr || NavSystem->GetDefaultNavDataInstance() == nullptr) return false;
+
+	bGridInitialized = true;
+
+	FBox Bounds(ForceInit);
+	for (TActorIterator<ANavMeshBoundsVolume> It(GetWorld()); It; ++It)
+	{
+		Bounds += It->GetComponentsBoundingBox();
+	}
+
+	if (!Bounds.IsValid)
+	{
+		// An empty grid makes every sample fail, enemies fall back to navmesh paths
+		UE_LOG(LogShooter, Warning, TEXT("No NavMeshBoundsVolume found, flow fields are disabled"));
+		bGridReady = true;
+		return true;
+	}
+
+	const FVector BoundsSize{ Bounds.GetSize() };
+	CellSize = FMath::Max(CVarFlowCellSize.GetValueOnGameThread(), FMath::Max(BoundsSize.X, BoundsSize.Y) / ShooterFlowField::MaxCellsPerAxis);
+	SizeX = FMath::Max(FMath::CeilToInt(BoundsSize.X / CellSize), 1);
+	SizeY = FMath::Max(FMath::CeilToInt(BoundsSize.Y / CellSize), 1);
+	GridOrigin = FVector2D(Bounds.Min);
+	GridCenterZ = Bounds.GetCenter().Z;
+	GridHalfHeight = Bounds.GetExtent().Z;
+
+	CellHeight.SetNumZeroed(SizeX * SizeY);
+	Walkable.Init(false, SizeX * SizeY);
+	GridBuildCursor = 0;
+
+	UE_LOG(LogShooter, Log, TEXT("Building %dx%d flow field grid with %.0f cm cells"), SizeX, SizeY, CellSize);
+	return true;
+}
+
+int32 UShooterFlowFieldManager::BuildGridStep(int32 Budget)
+{
+	UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (NavSystem == nullptr) return 0;
+
+	// One height per cell, so stacked floors collapse onto whichever the projection finds first
+	const FVector QueryExtent{ CellSize * 0.5f, CellSize * 0.5f, GridHalfHeight };
+	const int32 NumCells{ SizeX * SizeY };
+	const int32 EndCell{ FMath::Min(GridBuildCursor + Budget, NumCells) };
+	const int32 Used{ EndCell - GridBuildCursor };
+
+	for (; GridBuildCursor < EndCell; ++GridBuildCursor)
+	{
+		const FVector CellCenter{
+			GridOrigin.X + ((GridBuildCursor % SizeX) + 0.5f) * CellSize,
+			GridOrigin.Y + ((GridBuildCursor / SizeX) + 0.5f) * CellSize,
+			GridCenterZ };
+
+		FNavLocation NavLocation;
+		if (NavSystem->ProjectPointToNavigation(CellCenter, NavLocation, QueryExtent))
+		{
+			Walkable[GridBuildCursor] = true;
+			CellHeight[GridBuildCursor] = NavLocation.Location.Z;
+		}
+	}
+
+	if (GridBuildCursor >= NumCells)
+	{
+		bGridReady = true;
+		UE_LOG(LogShooter, Log, TEXT("Flow field grid ready, %d of %d cells walkable"), Walkable.CountSetBits(), NumCells);
+	}
+	return Used;
+}
+
+void UShooterFlowFieldManager::GatherPlayers()
+{
+	Fields.RemoveAll([](const FField& Field) { return !Field.Target.IsValid(); });
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		APawn* Pawn = It->Get() ? It->Get()->GetPawn() : nullptr;
+		if (Pawn && FindField(Pawn) == nullptr)
+		{
+			FField& Field = Fields.AddDefaulted_GetRef();
+			Field.Target = Pawn;
+		}
+	}
+}
+
+void UShooterFlowFieldManager::StartFieldBuild(FField& Field, int32 GoalCell)
+{
+	const int32 NumCells{ SizeX * SizeY };
+
+	Field.PendingGoalCell = GoalCell;
+	Field.PendingDistance.Init(MAX_uint16, NumCells);
+	Field.PendingDirection.Init(NoDirection, NumCells);
+	Field.Frontier.Reset();
+	Field.FrontierHead = 0;
+
+	Field.PendingDistance[GoalCell] = 0;
+	Field.Frontier.Add(GoalCell);
+}
+
+int32 UShooterFlowFieldManager::BuildFieldStep(FField& Field, int32 Budget)
+{
+	int32 Used{ 0 };
+	while (Field.FrontierHead < Field.Frontier.Num() && Used < Budget)
+	{
+		const int32 Cell{ Field.Frontier[Field.FrontierHead++] };
+		const uint16 NextDistance{ static_cast<uint16>(FMath::Min<int32>(Field.PendingDistance[Cell] + 1, MAX_uint16 - 1)) };
+		++Used;
+
+		for (int32 Direction = 0; Direction < ShooterFlowField::NumDirections; ++Direction)
+		{
+			int32 Neighbour;
+			if (!CanStep(Cell, Direction, Neighbour) || Field.PendingDistance[Neighbour] != MAX_uint16) continue;
+
+			// Found from Cell, so the way back to the goal is the opposite step
+			Field.PendingDistance[Neighbour] = NextDistance;
+			Field.PendingDirection[Neighbour] = static_cast<uint8>((Direction + ShooterFlowField::NumDirections / 2) % ShooterFlowField::NumDirections);
+			Field.Frontier.Add(Neighbour);
+		}
+	}
+
+	if (Field.FrontierHead >= Field.Frontier.Num())
+	{
+		// Publish. Swapping keeps both allocations around for the next rebuild
+		Swap(Field.Distance, Field.PendingDistance);
+		Swap(Field.Direction, Field.PendingDirection);
+		Field.GoalCell = Field.PendingGoalCell;
+		Field.PendingGoalCell = INDEX_NONE;
+		Field.Frontier.Reset();
+		Field.FrontierHead = 0;
+	}
+	return Used;
+}
+
+bool UShooterFlowFieldManager::CanStep(int32 Cell, int32 Direction, int32& OutNeighbour) const
+{
+	const int32 X{ Cell % SizeX };
+	const int32 Y{ Cell / SizeX };
+	const int32 DX{ ShooterFlowField::OffsetX[Direction] };
+	const int32 DY{ ShooterFlowField::OffsetY[Direction] };
+	const int32 NX{ X + DX };
+	const int32 NY{ Y + DY };
+
+	if (NX < 0 || NY < 0 || NX >= SizeX || NY >= SizeY) return false;
+
+	OutNeighbour = NY * SizeX + NX;
+	if (!Walkable[OutNeighbour]) return false;
+	if (FMath::Abs(CellHeight[OutNeighbour] - CellHeight[Cell]) > CVarFlowMaxStepHeight.GetValueOnGameThread()) return false;
+
+	// Diagonals may not cut a blocked corner
+	if (DX != 0 && DY != 0)
+	{
+		return Walkable[Y * SizeX + NX] && Walkable[NY * SizeX + X];
+	}
+	return true;
+}
+
+const UShooterFlowFieldManager::FField* UShooterFlowFieldManager::FindField(const APawn* Target) const
+{
+	return Fields.FindByPredicate([Target](const FField& Field) { return Field.Target == Target; });
+}
+
+bool UShooterFlowFieldManager::HasField(const APawn* Target) const
+{
+	const FField* Field = FindField(Target);
+	return Field && Field->GoalCell != INDEX_NONE;
+}
+
+int32 UShooterFlowFieldManager::LocationToCell(const FVector& Location) const
+{
+	if (SizeX == 0 || SizeY == 0) return INDEX_NONE;
+
+	const int32 X{ FMath::FloorToInt((Location.X - GridOrigin.X) / CellSize) };
+	const int32 Y{ FMath::FloorToInt((Location.Y - GridOrigin.Y) / CellSize) };
+	if (X < 0 || Y < 0 || X >= SizeX || Y >= SizeY) return INDEX_NONE;
+
+	return Y * SizeX + X;
+}
+
+FVector UShooterFlowFieldManager::CellToLocation(int32 Cell) const
+{
+	return FVector(
+		GridOrigin.X + ((Cell % SizeX) + 0.5f) * CellSize,
+		GridOrigin.Y + ((Cell / SizeX) + 0.5f) * CellSize,
+		CellHeight[Cell]);
+}
+
+bool UShooterFlowFieldManager::GetFlowDirection(const APawn* Target, const FVector& Location, FVector& OutDirection) const
+{
+	INC_DWORD_STAT(STAT_FlowFieldSamples);
+
+	const FField* Field = FindField(Target);
+	if (Field == nullptr || Field->GoalCell == INDEX_NONE) return false;
+
+	const int32 Cell{ LocationToCell(Location) };
+	if (Cell == INDEX_NONE) return false;
+
+	if (Cell == Field->GoalCell)
+	{
+		// Same cell as the player, head straight for them
+		OutDirection = (Target->GetActorLocation() - Location).GetSafeNormal2D();
+		return true;
+	}
+
+	const uint8 Direction{ Field->Direction[Cell] };
+	if (Direction == NoDirection) return false;
+
+	OutDirection = FVector(ShooterFlowField::OffsetX[Direction], ShooterFlowField::OffsetY[Direction], 0.f).GetSafeNormal();
+	return true;
+}
+
+void UShooterFlowFieldManager::RunBenchmark(int32 NumAgents)
+{
+	const FField* Field = Fields.Num() > 0 ? &Fields[0] : nullptr;
+	APawn* Target = Field ? Field->Target.Get() : nullptr;
+	UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	if (NumAgents <= 0 || Target == nullptr || Field->GoalCell == INDEX_NONE || NavSystem == nullptr)
+	{
+		UE_LOG(LogShooter, Warning, TEXT("Flow field benchmark needs a player with a finished field and a navmesh"));
+		return;
+	}
+
+	// Start every agent on a random cell that can reach the player
+	TArray<int32> ReachableCells;
+	for (int32 Cell = 0; Cell < Field->Distance.Num(); ++Cell)
+	{
+		if (Field->Distance[Cell] != MAX_uint16)
+		{
+			ReachableCells.Add(Cell);
+		}
+	}
+
+	FRandomStream Stream(NumAgents);
+	TArray<FVector> AgentLocations;
+	AgentLocations.Reserve(NumAgents);
+	for (int32 Agent = 0; Agent < NumAgents; ++Agent)
+	{
+		AgentLocations.Add(CellToLocation(ReachableCells[Stream.RandHelper(ReachableCells.Num())]));
+	}
+
+	// Samples are too cheap to time once, repeat them
+	constexpr int32 FlowIterations = 100;
+	int32 NumSteered{ 0 };
+	double StartTime{ FPlatformTime::Seconds() };
+	for (int32 Iteration = 0; Iteration < FlowIterations; ++Iteration)
+	{
+		for (const FVector& Location : AgentLocations)
+		{
+			FVector Direction;
+			NumSteered += GetFlowDirection(Target, Location, Direction) ? 1 : 0;
+		}
+	}
+	const double FlowSeconds{ FMath::Max(FPlatformTime::Seconds() - StartTime, 1e-9) };
+
+	// What every enemy issuing its own MoveTo would cost on each repath
+	int32 NumPaths{ 0 };
+	const FVector TargetLocation{ Target->GetActorLocation() };
+	StartTime = FPlatformTime::Seconds();
+	for (const FVector& Location : AgentLocations)
+	{
+		UNavigationPath* Path = NavSystem->FindPathToLocationSynchronously(GetWorld(), Location, TargetLocation);
+		NumPaths += (Path && Path->IsValid()) ? 1 : 0;
+	}
+	const double NavSeconds{ FMath::Max(FPlatformTime::Seconds() - StartTime, 1e-9) };
+
+	const double FlowQueriesPerSecond{ NumAgents * FlowIterations / FlowSeconds };
+	const double NavQueriesPerSecond{ NumAgents / NavSeconds };
+	UE_LOG(LogShooter, Log, TEXT("Flow field: %d agents x %d, %.0f queries/s, %d steered"),
+		NumAgents, FlowIterations, FlowQueriesPerSecond, NumSteered / FlowIterations);
+	UE_LOG(LogShooter, Log, TEXT("Navmesh paths: %d agents, %.0f queries/s, %d found, %.2f ms total"),
+		NumAgents, NavQueriesPerSecond, NumPaths, NavSeconds * 1000.0);
+	UE_LOG(LogShooter, Log, TEXT("Flow field is %.1fx the navmesh query rate"), FlowQueriesPerSecond / NavQueriesPerSecond);
+}
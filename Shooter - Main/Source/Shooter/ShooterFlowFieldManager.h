@@ -0,0 +1,113 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShooterTickableWorldSubsystem.h"
+#include "ShooterFlowFieldManager.generated.h"
+
+/**
+ * Grid distance fields toward every player, shared by all enemies chasing them.
+ * The walkable grid is sampled from the navmesh once. Each field is rebuilt with a time-sliced
+ * breadth first search when its player changes cell, and the old field is kept until the new one is done.
+ * Steering from a field is a single cell lookup, however many enemies use it.
+ */
+UCLASS()
+class SHOOTER_API UShooterFlowFieldManager : public UShooterTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	/* FTickableGameObject interface */
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/* True once a field toward Target has been built */
+	bool HasField(const APawn* Target) const;
+
+	/**
+	 * Direction to walk from Location to reach Target, flattened to the ground plane.
+	 * Returns false outside the grid or in cells that can't reach Target.
+	 */
+	bool GetFlowDirection(const APawn* Target, const FVector& Location, FVector& OutDirection) const;
+
+	/* Compares field samples against navmesh path queries for NumAgents agents and logs queries per second */
+	void RunBenchmark(int32 NumAgents);
+
+	FORCEINLINE bool IsGridReady() const { return bGridReady; }
+
+private:
+
+	struct FField
+	{
+		TWeakObjectPtr<APawn> Target;
+
+		/* Cell the published field leads to, INDEX_NONE before the first build */
+		int32 GoalCell = INDEX_NONE;
+
+		/* Neighbour index of the next cell toward the goal, NoDirection when unreachable */
+		TArray<uint8> Direction;
+
+		/* Steps to the goal, MAX_uint16 when unreachable */
+		TArray<uint16> Distance;
+
+		/* Rebuild in progress, published into the arrays above when the frontier runs dry */
+		int32 PendingGoalCell = INDEX_NONE;
+		TArray<uint8> PendingDirection;
+		TArray<uint16> PendingDistance;
+		TArray<int32> Frontier;
+		int32 FrontierHead = 0;
+	};
+
+	/* Works out the grid from the navmesh bounds volumes */
+	bool InitGrid();
+
+	/* Projects up to Budget cells onto the navmesh, returns the number used */
+	int32 BuildGridStep(int32 Budget);
+
+	/* Starts a rebuild of Field toward GoalCell */
+	void StartFieldBuild(FField& Field, int32 GoalCell);
+
+	/* Expands up to Budget cells of the pending search, returns the number used */
+	int32 BuildFieldStep(FField& Field, int32 Budget);
+
+	/* Adds fields for new players and drops those of players that left */
+	void GatherPlayers();
+
+	const FField* FindField(const APawn* Target) const;
+
+	int32 LocationToCell(const FVector& Location) const;
+
+	FVector CellToLocation(int32 Cell) const;
+
+	/* Whether a step from Cell to its neighbour in Direction is allowed */
+	bool CanStep(int32 Cell, int32 Direction, int32& OutNeighbour) const;
+
+	static constexpr uint8 NoDirection = MAX_uint8;
+
+	/* Grid layout */
+	FVector2D GridOrigin;
+	float CellSize = 0.f;
+	int32 SizeX = 0;
+	int32 SizeY = 0;
+	float GridCenterZ = 0.f;
+	float GridHalfHeight = 0.f;
+
+	/* Navmesh height per cell, only valid where Walkable is set */
+	TArray<float> CellHeight;
+	TBitArray<> Walkable;
+
+	/* Next cell to project while the grid is being built */
+	int32 GridBuildCursor = 0;
+
+	bool bGridInitialized = false;
+	bool bGridReady = false;
+
+	TArray<FField> Fields;
+
+	/* Cells expanded by field rebuilds last frame */
+	int32 CellsUpdatedLastFrame = 0;
+};
@@ -2,4 +2,220 @@
 
 
 #include "ShooterGameModeBase.h"
+#include "Shooter.h"
+#include "Enemy.h"
+#include "ShooterLLM.h"
+#include "ShooterHitchMonitor.h"
+#include "Kismet/GameplayStatics.h"
+#include "TimerManager.h"
 
+AShooterGameModeBase::AShooterGameModeBase() :
+	SpawnPointTag(FName("EnemySpawn")),
+	MaxActivationsPerFrame(2),
+	ActivationBudgetMs(1.f),
+	CorpseLingerTime(3.f),
+	CurrentWaveIndex(-1),
+	WaveEnemiesRemaining(0),
+	PoolLocation(0.f, 0.f, -100'000.f)
+{
+	// Tick drains the activation queue
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+void AShooterGameModeBase::BeginPlay()
+{
+	Super::BeginPlay();
+
+	UGameplayStatics::GetAllActorsWithTag(this, SpawnPointTag, SpawnPoints);
+
+	if (Waves.Num() > 0 && SpawnPoints.Num() == 0)
+	{
+		UE_LOG(LogShooter, Warning, TEXT("No actors tagged %s, enemy waves are disabled"), *SpawnPointTag.ToString());
+		return;
+	}
+
+	// Pay for skeletal mesh, movement and anim instance setup during load rather than mid-wave
+	PreallocateEnemyPools();
+
+	StartNextWave();
+}
+
+void AShooterGameModeBase::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	ProcessPendingSpawns();
+}
+
+void AShooterGameModeBase::PreallocateEnemyPools()
+{
+	// Size each pool for the largest wave of its class
+	TMap<UClass*, int32> PoolSizes;
+	for (const FEnemyWave& Wave : Waves)
+	{
+		if (Wave.EnemyClass == nullptr) continue;
+
+		int32& PoolSize = PoolSizes.FindOrAdd(Wave.EnemyClass);
+		PoolSize = FMath::Max(PoolSize, Wave.EnemyCount);
+	}
+
+	for (const TPair<UClass*, int32>& PoolSize : PoolSizes)
+	{
+		FEnemyPool& Pool = EnemyPools.FindOrAdd(PoolSize.Key);
+		for (int32 i = 0; i < PoolSize.Value; ++i)
+		{
+			SpawnPooledEnemy(PoolSize.Key, Pool);
+		}
+	}
+}
+
+AEnemy* AShooterGameModeBase::SpawnPooledEnemy(UClass* EnemyClass, FEnemyPool& Pool)
+{
+	SHOOTER_LLM_SCOPE(Enemies);
+	ShooterHitch::AddEvent(EShooterHitchEvent::Spawn, this, EnemyClass->GetFName());
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AEnemy* Enemy = GetWorld()->SpawnActor<AEnemy>(EnemyClass, PoolLocation, FRotator::ZeroRotator, SpawnParams);
+	if (Enemy)
+	{
+		Enemy->DeactivateForPool();
+		Enemy->EnemyDiedDelegate.AddUniqueDynamic(this, &AShooterGameModeBase::OnEnemyDied);
+		Enemy->EnemyDeathFinishedDelegate.AddUniqueDynamic(this, &AShooterGameModeBase::OnEnemyDeathFinished);
+		Pool.Inactive.Add(Enemy);
+		++Pool.NumAllocated;
+	}
+	return Enemy;
+}
+
+AEnemy* AShooterGameModeBase::AcquireEnemy(UClass* EnemyClass)
+{
+	if (EnemyClass == nullptr) return nullptr;
+
+	FEnemyPool& Pool = EnemyPools.FindOrAdd(EnemyClass);
+	if (Pool.Inactive.Num() == 0)
+	{
+		// Pool ran dry, this spawn will hitch. The high-water mark tells us how big to make it
+		if (SpawnPooledEnemy(EnemyClass, Pool) == nullptr) return nullptr;
+		++Pool.NumGrown;
+	}
+
+	AEnemy* Enemy = Pool.Inactive.Pop(false);
+	++Pool.NumActive;
+	Pool.HighWaterMark = FMath::Max(Pool.HighWaterMark, Pool.NumActive);
+	return Enemy;
+}
+
+void AShooterGameModeBase::ReleaseEnemy(AEnemy* Enemy)
+{
+	if (Enemy == nullptr) return;
+
+	FEnemyPool* Pool = EnemyPools.Find(Enemy->GetClass());
+	if (Pool == nullptr)
+	{
+		// Placed in the level rather than spawned from a pool
+		Enemy->Destroy();
+		return;
+	}
+
+	Enemy->DeactivateForPool();
+	Enemy->SetActorLocation(PoolLocation);
+	Pool->Inactive.Add(Enemy);
+	--Pool->NumActive;
+}
+
+void AShooterGameModeBase::StartNextWave()
+{
+	++CurrentWaveIndex;
+	if (!Waves.IsValidIndex(CurrentWaveIndex)) return;
+
+	const FEnemyWave& Wave = Waves[CurrentWaveIndex];
+
+	GetWorldTimerManager().SetTimer(NextWaveTimer, [this, Wave]()
+	{
+		// Queue the whole wave, Tick activates it a few enemies at a time
+		for (int32 i = 0; i < Wave.EnemyCount; ++i)
+		{
+			const AActor* SpawnPoint = SpawnPoints[i % SpawnPoints.Num()];
+			PendingSpawns.Add({ Wave.EnemyClass, SpawnPoint->GetActorTransform() });
+		}
+		WaveEnemiesRemaining = Wave.EnemyCount;
+
+		UE_LOG(LogShooter, Log, TEXT("Starting wave %d with %d enemies"), CurrentWaveIndex, Wave.EnemyCount);
+
+		// An empty wave is over as soon as it starts
+		CheckWaveComplete();
+	}, FMath::Max(Wave.DelayBeforeWave, KINDA_SMALL_NUMBER), false);
+}
+
+void AShooterGameModeBase::ProcessPendingSpawns()
+{
+	if (PendingSpawns.Num() == 0) return;
+
+	const double StartTime{ FPlatformTime::Seconds() };
+	int32 NumActivated{ 0 };
+
+	while (PendingSpawns.Num() > 0 && NumActivated < MaxActivationsPerFrame)
+	{
+		const FPendingEnemySpawn PendingSpawn = PendingSpawns[0];
+		PendingSpawns.RemoveAt(0, 1, false);
+
+		AEnemy* Enemy = AcquireEnemy(PendingSpawn.EnemyClass);
+		if (Enemy)
+		{
+			Enemy->ActivateFromPool(PendingSpawn.SpawnTransform);
+			WaveEnemies.Add(Enemy);
+		}
+		else
+		{
+			// Never coming, don't let the wave wait for it
+			--WaveEnemiesRemaining;
+			CheckWaveComplete();
+		}
+		++NumActivated;
+
+		// Always activate at least one so a tiny budget can't stall the wave
+		if ((FPlatformTime::Seconds() - StartTime) * 1000.0 > ActivationBudgetMs) break;
+	}
+}
+
+void AShooterGameModeBase::CheckWaveComplete()
+{
+	if (WaveEnemiesRemaining <= 0)
+	{
+		WaveEnemiesRemaining = 0;
+		StartNextWave();
+	}
+}
+
+void AShooterGameModeBase::OnEnemyDied(AEnemy* Enemy)
+{
+	// e.g. a death stress test victim
+	if (WaveEnemies.Remove(Enemy) == 0) return;
+
+	--WaveEnemiesRemaining;
+	CheckWaveComplete();
+}
+
+void AShooterGameModeBase::OnEnemyDeathFinished(AEnemy* Enemy)
+{
+	// Leave the body around for a moment before recycling it
+	FTimerHandle CorpseTimer;
+	FTimerDelegate CorpseDelegate = FTimerDelegate::CreateUObject(this, &AShooterGameModeBase::ReleaseEnemy, Enemy);
+	GetWorldTimerManager().SetTimer(CorpseTimer, CorpseDelegate, FMath::Max(CorpseLingerTime, KINDA_SMALL_NUMBER), false);
+}
+
+void AShooterGameModeBase::ReportEnemyPools() const
+{
+	for (const TPair<UClass*, FEnemyPool>& Pool : EnemyPools)
+	{
+		UE_LOG(LogShooter, Log, TEXT("Enemy pool %s: allocated %d, active %d, inactive %d, high-water %d, grown %d"),
+			*GetNameSafe(Pool.Key),
+			Pool.Value.NumAllocated,
+			Pool.Value.NumActive,
+			Pool.Value.Inactive.Num(),
+			Pool.Value.HighWaterMark,
+			Pool.Value.NumGrown);
+	}
+}
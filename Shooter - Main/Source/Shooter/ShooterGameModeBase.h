@@ -6,12 +6,150 @@
 #include "GameFramework/GameModeBase.h"
 #include "ShooterGameModeBase.generated.h"
 
+class AEnemy;
+
+USTRUCT(BlueprintType)
+struct FEnemyWave
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TSubclassOf<AEnemy> EnemyClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 EnemyCount = 0;
+
+	/* Seconds to wait after the previous wave is cleared */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float DelayBeforeWave = 5.f;
+};
+
+/* Pre-allocated enemies of one class */
+USTRUCT()
+struct FEnemyPool
+{
+	GENERATED_BODY()
+
+	/* Deactivated enemies ready to be reused */
+	UPROPERTY()
+	TArray<AEnemy*> Inactive;
+
+	/* Enemies handed out and not yet released */
+	int32 NumActive = 0;
+
+	/* Highest NumActive seen */
+	int32 HighWaterMark = 0;
+
+	/* Enemies spawned after pre-allocation because the pool ran dry */
+	int32 NumGrown = 0;
+
+	/* Every enemy this pool has ever spawned */
+	int32 NumAllocated = 0;
+};
+
+/* A pooled enemy waiting to be activated */
+struct FPendingEnemySpawn
+{
+	UClass* EnemyClass;
+	FTransform SpawnTransform;
+};
+
 /**
- * 
+ *
  */
 UCLASS()
 class SHOOTER_API AShooterGameModeBase : public AGameModeBase
 {
 	GENERATED_BODY()
-	
+
+public:
+	AShooterGameModeBase();
+
+	virtual void Tick(float DeltaTime) override;
+
+	/* Takes an enemy from its class pool, growing the pool if it is empty. Its death only counts for the wave if the wave spawned it */
+	AEnemy* AcquireEnemy(UClass* EnemyClass);
+
+	/* Deactivates an enemy and returns it to its class pool */
+	void ReleaseEnemy(AEnemy* Enemy);
+
+	/* Logs allocation and high-water mark of every enemy pool */
+	UFUNCTION(Exec)
+	void ReportEnemyPools() const;
+
+protected:
+	virtual void BeginPlay() override;
+
+	/* Spawn enough deactivated enemies for the largest wave of each class */
+	void PreallocateEnemyPools();
+
+	/* Spawns a deactivated enemy and adds it to the class pool */
+	AEnemy* SpawnPooledEnemy(UClass* EnemyClass, FEnemyPool& Pool);
+
+	void StartNextWave();
+
+	/* Starts the next wave once no enemy of the current one is queued or alive */
+	void CheckWaveComplete();
+
+	/* Activates queued enemies until the per-frame budget runs out */
+	void ProcessPendingSpawns();
+
+	UFUNCTION()
+	void OnEnemyDied(AEnemy* Enemy);
+
+	/* Body has been frozen by the death manager, recycle it after CorpseLingerTime */
+	UFUNCTION()
+	void OnEnemyDeathFinished(AEnemy* Enemy);
+
+private:
+
+	/* Waves played in order after BeginPlay */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Waves, meta = (AllowPrivateAccess = "true"))
+	TArray<FEnemyWave> Waves;
+
+	/* Enemies spawn at actors with this tag */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Waves, meta = (AllowPrivateAccess = "true"))
+	FName SpawnPointTag;
+
+	/* Most enemies activated in a single frame */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Waves, meta = (AllowPrivateAccess = "true"))
+	int32 MaxActivationsPerFrame;
+
+	/* Stop activating enemies once this many ms were spent in a frame */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Waves, meta = (AllowPrivateAccess = "true"))
+	float ActivationBudgetMs;
+
+	/* How long a frozen body stays in the world before it goes back to the pool */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Waves, meta = (AllowPrivateAccess = "true"))
+	float CorpseLingerTime;
+
+	/* Enemy pools keyed by class */
+	UPROPERTY()
+	TMap<UClass*, FEnemyPool> EnemyPools;
+
+	UPROPERTY()
+	TArray<AActor*> SpawnPoints;
+
+	/* Enemies waiting for activation, oldest first */
+	TArray<FPendingEnemySpawn> PendingSpawns;
+
+	/* Index into Waves of the wave in progress, -1 before the first */
+	int32 CurrentWaveIndex;
+
+	/* Enemies of the current wave that are queued or alive */
+	int32 WaveEnemiesRemaining;
+
+	/* Enemies activated for the current wave. Only their deaths count towards it, not those of enemies acquired for anything else */
+	UPROPERTY()
+	TSet<AEnemy*> WaveEnemies;
+
+	FTimerHandle NextWaveTimer;
+
+	/* Where deactivated enemies wait, out of sight */
+	FVector PoolLocation;
+
+public:
+
+	FORCEINLINE int32 GetCurrentWaveIndex() const { return CurrentWaveIndex; }
+	FORCEINLINE int32 GetWaveEnemiesRemaining() const { return WaveEnemiesRemaining; }
 };
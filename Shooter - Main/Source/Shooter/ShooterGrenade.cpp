@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterGrenade.h"
+#include "Components/SphereComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "GameFramework/ProjectileMovementComponent.h"
+#include "Kismet/GameplayStatics.h"
+#include "Sound/SoundCue.h"
+#include "Enemy.h"
+#include "ShooterCharacter.h"
+#include "ShooterLLM.h"
+
+AShooterGrenade::AShooterGrenade() :
+	FuseTime(2.5f),
+	ThrowSpeed(1500.f),
+	ThrowLoft(15.f),
+	ExplosionParticles(nullptr),
+	ExplosionSound(nullptr)
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	bReplicates = true;
+	SetReplicatingMovement(true);
+
+	CollisionSphere = CreateDefaultSubobject<USphereComponent>(TEXT("CollisionSphere"));
+	CollisionSphere->InitSphereRadius(8.f);
+	CollisionSphere->SetCollisionProfileName(FName("BlockAllDynamic"));
+	SetRootComponent(CollisionSphere);
+
+	GrenadeMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("GrenadeMesh"));
+	GrenadeMesh->SetupAttachment(CollisionSphere);
+	GrenadeMesh->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+
+	ProjectileMovement = CreateDefaultSubobject<UProjectileMovementComponent>(TEXT("ProjectileMovement"));
+	ProjectileMovement->UpdatedComponent = CollisionSphere;
+	ProjectileMovement->InitialSpeed = 0.f;
+	ProjectileMovement->bShouldBounce = true;
+	ProjectileMovement->Bounciness = 0.3f;
+	ProjectileMovement->Friction = 0.4f;
+	ProjectileMovement->bRotationFollowsVelocity = true;
+}
+
+void AShooterGrenade::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// The thrower's capsule would stop the grenade where it spawns
+	if (GetInstigator())
+	{
+		CollisionSphere->IgnoreActorWhenMoving(GetInstigator(), true);
+	}
+
+	if (HasAuthority())
+	{
+		GetWorldTimerManager().SetTimer(FuseTimer, this, &AShooterGrenade::Explode, FuseTime);
+	}
+}
+
+void AShooterGrenade::Throw(const FVector& Direction)
+{
+	FRotator ThrowRotation{ Direction.Rotation() };
+	ThrowRotation.Pitch = FMath::Min(ThrowRotation.Pitch + ThrowLoft, 89.f);
+	ProjectileMovement->Velocity = ThrowRotation.Vector() * ThrowSpeed;
+}
+
+void AShooterGrenade::Explode()
+{
+	// Lifted off the floor the grenade rests on, occlusion tests starting on it would all count as blocked
+	const FVector Origin{ GetActorLocation() + FVector(0.f, 0.f, 50.f) };
+	const ShooterExplosion::FResult Result{ ShooterExplosion::Explode(GetWorld(), Origin, Explosion, this, GetInstigatorController()) };
+
+	// The thrower predicts hit numbers for bullets, a listen server host sees them for its own grenades too
+	const AShooterCharacter* Thrower = Cast<AShooterCharacter>(GetInstigator());
+	if (Thrower && Thrower->IsLocallyControlled())
+	{
+		SHOOTER_LLM_SCOPE(HitNumbers);
+		for (const TPair<AEnemy*, int32>& Hit : Result.Hits)
+		{
+			Hit.Key->ShowHitNumber(Hit.Value, Hit.Key->GetActorLocation());
+		}
+	}
+
+	MulticastExplosionFX(GetActorLocation());
+	Destroy();
+}
+
+void AShooterGrenade::MulticastExplosionFX_Implementation(FVector_NetQuantize Location)
+{
+	SHOOTER_LLM_SCOPE(CombatFX);
+	if (ExplosionParticles)
+	{
+		UGameplayStatics::SpawnEmitterAtLocation(GetWorld(), ExplosionParticles, Location);
+	}
+	if (ExplosionSound)
+	{
+		UGameplayStatics::PlaySoundAtLocation(this, ExplosionSound, Location);
+	}
+}
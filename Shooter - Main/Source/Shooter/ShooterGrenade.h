@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "ShooterExplosion.h"
+#include "ShooterGrenade.generated.h"
+
+class USphereComponent;
+class UStaticMeshComponent;
+class UProjectileMovementComponent;
+class UParticleSystem;
+class USoundCue;
+
+/**
+ * Thrown by a grenade weapon. Bounces until its fuse runs out, then explodes through ShooterExplosion::Explode.
+ * Spawned and detonated on the server, clients see the replicated movement and the explosion FX.
+ */
+UCLASS()
+class SHOOTER_API AShooterGrenade : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AShooterGrenade();
+
+	/* Sets the velocity the grenade leaves the hand with */
+	void Throw(const FVector& Direction);
+
+	FORCEINLINE const FShooterExplosion& GetExplosion() const { return Explosion; }
+
+protected:
+	virtual void BeginPlay() override;
+
+	void Explode();
+
+	/* Rare enough to be reliable, it has to arrive before the grenade is destroyed on clients */
+	UFUNCTION(NetMulticast, Reliable)
+	void MulticastExplosionFX(FVector_NetQuantize Location);
+
+private:
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Components, meta = (AllowPrivateAccess = "true"))
+	USphereComponent* CollisionSphere;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Components, meta = (AllowPrivateAccess = "true"))
+	UStaticMeshComponent* GrenadeMesh;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Components, meta = (AllowPrivateAccess = "true"))
+	UProjectileMovementComponent* ProjectileMovement;
+
+	/* Seconds from the throw to the explosion */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Grenade, meta = (AllowPrivateAccess = "true"))
+	float FuseTime;
+
+	/* Speed the grenade leaves the hand with */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Grenade, meta = (AllowPrivateAccess = "true"))
+	float ThrowSpeed;
+
+	/* Degrees the throw is lifted above the aim direction */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Grenade, meta = (AllowPrivateAccess = "true"))
+	float ThrowLoft;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Grenade, meta = (AllowPrivateAccess = "true"))
+	FShooterExplosion Explosion;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Grenade, meta = (AllowPrivateAccess = "true"))
+	UParticleSystem* ExplosionParticles;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Grenade, meta = (AllowPrivateAccess = "true"))
+	USoundCue* ExplosionSound;
+
+	FTimerHandle FuseTimer;
+};
@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterHUD.h"
+#include "ShooterCharacter.h"
+#include "ShooterPlayerController.h"
+#include "Weapon.h"
+#include "Engine/Canvas.h"
+#include "Engine/Texture2D.h"
+#include "CanvasItem.h"
+
+AShooterHUD::AShooterHUD() :
+	CrosshairSpreadMax(16.f),
+	CrosshairScale(1.f),
+	CrosshairColor(FLinearColor::White)
+{
+
+}
+
+void AShooterHUD::DrawHUD()
+{
+	Super::DrawHUD();
+
+	AShooterPlayerController* ShooterController = Cast<AShooterPlayerController>(PlayerOwner);
+	if (ShooterController == nullptr || !ShooterController->GetUseNativeCrosshairs()) return;
+
+	AShooterCharacter* ShooterCharacter = Cast<AShooterCharacter>(ShooterController->GetPawn());
+	if (ShooterCharacter == nullptr) return;
+
+	AWeapon* Weapon = ShooterCharacter->GetEquippedWeapon();
+	if (Weapon == nullptr || Canvas == nullptr) return;
+
+	const FVector2D Center{ Canvas->ClipX * 0.5f, Canvas->ClipY * 0.5f };
+	const float Spread{ ShooterCharacter->GetCrosshairSpreadMultiplier() * CrosshairSpreadMax };
+
+	// All five in one pass, no widget layout or Blueprint bindings involved
+	DrawCrosshair(Weapon->GetCrosshairsMiddle(), Center, FVector2D::ZeroVector);
+	DrawCrosshair(Weapon->GetCrosshairsLeft(), Center, FVector2D(-Spread, 0.f));
+	DrawCrosshair(Weapon->GetCrosshairsRight(), Center, FVector2D(Spread, 0.f));
+	DrawCrosshair(Weapon->GetCrosshairsTop(), Center, FVector2D(0.f, -Spread));
+	DrawCrosshair(Weapon->GetCrosshairsBottom(), Center, FVector2D(0.f, Spread));
+}
+
+void AShooterHUD::DrawCrosshair(UTexture2D* Texture, const FVector2D& Center, const FVector2D& Offset)
+{
+	if (Texture == nullptr) return;
+
+	const FVector2D Size{ Texture->GetSurfaceWidth() * CrosshairScale, Texture->GetSurfaceHeight() * CrosshairScale };
+	const FVector2D Position{ Center + Offset - Size * 0.5f };
+
+	FCanvasTileItem TileItem(Position, Texture->Resource, Size, CrosshairColor);
+	TileItem.BlendMode = SE_BLEND_Translucent;
+	Canvas->DrawItem(TileItem);
+}
@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/HUD.h"
+#include "ShooterHUD.generated.h"
+
+class UTexture2D;
+
+/**
+ * Draws the equipped weapon's crosshairs straight onto the canvas, spread by the character's crosshair multiplier.
+ * AShooterPlayerController spawns it in place of the game mode's HUD while bUseNativeCrosshairs is set.
+ */
+UCLASS()
+class SHOOTER_API AShooterHUD : public AHUD
+{
+	GENERATED_BODY()
+
+public:
+	AShooterHUD();
+
+	virtual void DrawHUD() override;
+
+protected:
+
+	/* Draws Texture centered on Center + Offset */
+	void DrawCrosshair(UTexture2D* Texture, const FVector2D& Center, const FVector2D& Offset);
+
+private:
+
+	/* Distance in pixels the outer crosshairs move per unit of crosshair spread */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Crosshairs, meta = (AllowPrivateAccess = "true"))
+	float CrosshairSpreadMax;
+
+	/* Scale applied to the crosshair textures' own size */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Crosshairs, meta = (AllowPrivateAccess = "true"))
+	float CrosshairScale;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Crosshairs, meta = (AllowPrivateAccess = "true"))
+	FLinearColor CrosshairColor;
+};
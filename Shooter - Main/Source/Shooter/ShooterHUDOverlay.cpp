@@ -0,0 +1,213 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterHUDOverlay.h"
+#include "Shooter.h"
+#include "Weapon.h"
+#include "PercentileSampler.h"
+#include "Components/RetainerBox.h"
+#include "Components/InvalidationBox.h"
+#include "Framework/Application/SlateApplication.h"
+
+namespace ShooterSlateTiming
+{
+	/* Times Slate ticks between OnPreTick and OnPostTick for a fixed number of seconds */
+	struct FMeasurement
+	{
+		FPercentileSampler TickMs{ 4096 };
+		FDelegateHandle PreTickHandle;
+		FDelegateHandle PostTickHandle;
+		double TickStartTime = 0.0;
+		double EndTime = 0.0;
+		bool bRunning = false;
+	};
+
+	static FMeasurement Measurement;
+
+	static void Stop()
+	{
+		FSlateApplication& SlateApplication = FSlateApplication::Get();
+		SlateApplication.OnPreTick().Remove(Measurement.PreTickHandle);
+		SlateApplication.OnPostTick().Remove(Measurement.PostTickHandle);
+		Measurement.bRunning = false;
+
+		UE_LOG(LogShooter, Log, TEXT("Slate tick over %d frames, ms: avg %.3f %s"),
+			Measurement.TickMs.Num(), Measurement.TickMs.GetAverage(), *Measurement.TickMs.ToString());
+	}
+
+	static void Start(float Seconds)
+	{
+		if (Measurement.bRunning || !FSlateApplication::IsInitialized()) return;
+
+		Measurement.TickMs.Reset();
+		Measurement.EndTime = FPlatformTime::Seconds() + Seconds;
+		Measurement.bRunning = true;
+
+		FSlateApplication& SlateApplication = FSlateApplication::Get();
+		Measurement.PreTickHandle = SlateApplication.OnPreTick().AddLambda([](float DeltaTime)
+		{
+			Measurement.TickStartTime = FPlatformTime::Seconds();
+		});
+		Measurement.PostTickHandle = SlateApplication.OnPostTick().AddLambda([](float DeltaTime)
+		{
+			const double Now{ FPlatformTime::Seconds() };
+			Measurement.TickMs.AddSample(static_cast<float>((Now - Measurement.TickStartTime) * 1000.0));
+			if (Now >= Measurement.EndTime)
+			{
+				Stop();
+			}
+		});
+	}
+}
+
+static FAutoConsoleCommand SlateTimingCommand(
+	TEXT("Shooter.UI.MeasureSlate"),
+	TEXT("Shooter.UI.MeasureSlate [Seconds=5]. Logs Slate tick time percentiles, run before and after UI changes."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		ShooterSlateTiming::Start(Args.Num() > 0 ? FCString::Atof(*Args[0]) : 5.f);
+	}));
+
+void UShooterHUDOverlay::NativeConstruct()
+{
+	Super::NativeConstruct();
+
+	if (ShooterCharacter == nullptr)
+	{
+		SetShooterCharacter(Cast<AShooterCharacter>(GetOwningPlayerPawn()));
+	}
+}
+
+void UShooterHUDOverlay::NativeDestruct()
+{
+	UnbindCharacter();
+
+	Super::NativeDestruct();
+}
+
+void UShooterHUDOverlay::SetShooterCharacter(AShooterCharacter* Character)
+{
+	if (Character == ShooterCharacter) return;
+
+	UnbindCharacter();
+	ShooterCharacter = Character;
+	if (ShooterCharacter == nullptr) return;
+
+	ShooterCharacter->OnEquipItem().AddDynamic(this, &UShooterHUDOverlay::OnEquipItem);
+	ShooterCharacter->OnCarriedAmmoChanged().AddDynamic(this, &UShooterHUDOverlay::OnCarriedAmmoChanged);
+	ShooterCharacter->OnInventorySlotChanged().AddDynamic(this, &UShooterHUDOverlay::OnInventorySlotChanged);
+	ShooterCharacter->OnCombatStateChanged().AddDynamic(this, &UShooterHUDOverlay::OnCombatStateChanged);
+
+	// Push everything once, events keep it current from here
+	const TArray<FInventoryWeaponRecord>& Inventory = ShooterCharacter->GetInventory();
+	for (int32 SlotIndex = 0; SlotIndex < Inventory.Num(); ++SlotIndex)
+	{
+		PushInventorySlot(SlotIndex, Inventory[SlotIndex]);
+	}
+	if (ShooterCharacter->GetEquippedWeapon())
+	{
+		UpdateEquippedSlot(-1, ShooterCharacter->GetEquippedWeapon()->GetSlotIndex());
+	}
+	UpdateCombatState(ShooterCharacter->GetCombatState());
+	BindEquippedWeapon();
+	RefreshAmmo();
+	InvalidatePanel(InventoryRetainer, InventoryInvalidation);
+}
+
+void UShooterHUDOverlay::UnbindCharacter()
+{
+	if (BoundWeapon)
+	{
+		BoundWeapon->AmmoChangedDelegate.RemoveDynamic(this, &UShooterHUDOverlay::OnWeaponAmmoChanged);
+		BoundWeapon = nullptr;
+	}
+
+	if (ShooterCharacter)
+	{
+		ShooterCharacter->OnEquipItem().RemoveDynamic(this, &UShooterHUDOverlay::OnEquipItem);
+		ShooterCharacter->OnCarriedAmmoChanged().RemoveDynamic(this, &UShooterHUDOverlay::OnCarriedAmmoChanged);
+		ShooterCharacter->OnInventorySlotChanged().RemoveDynamic(this, &UShooterHUDOverlay::OnInventorySlotChanged);
+		ShooterCharacter->OnCombatStateChanged().RemoveDynamic(this, &UShooterHUDOverlay::OnCombatStateChanged);
+		ShooterCharacter = nullptr;
+	}
+}
+
+void UShooterHUDOverlay::BindEquippedWeapon()
+{
+	AWeapon* EquippedWeapon = ShooterCharacter ? ShooterCharacter->GetEquippedWeapon() : nullptr;
+	if (EquippedWeapon == BoundWeapon) return;
+
+	if (BoundWeapon)
+	{
+		BoundWeapon->AmmoChangedDelegate.RemoveDynamic(this, &UShooterHUDOverlay::OnWeaponAmmoChanged);
+	}
+	BoundWeapon = EquippedWeapon;
+	if (BoundWeapon)
+	{
+		BoundWeapon->AmmoChangedDelegate.AddDynamic(this, &UShooterHUDOverlay::OnWeaponAmmoChanged);
+	}
+}
+
+void UShooterHUDOverlay::RefreshAmmo()
+{
+	if (BoundWeapon == nullptr || ShooterCharacter == nullptr) return;
+
+	UpdateAmmo(BoundWeapon->GetAmmo(), ShooterCharacter->GetCarriedAmmo(BoundWeapon->GetAmmoType()));
+	InvalidatePanel(AmmoRetainer, AmmoInvalidation);
+}
+
+void UShooterHUDOverlay::InvalidatePanel(URetainerBox* Retainer, UInvalidationBox* Invalidation)
+{
+	if (Invalidation)
+	{
+		Invalidation->InvalidateCache();
+	}
+	if (Retainer)
+	{
+		Retainer->RequestRender();
+	}
+}
+
+void UShooterHUDOverlay::OnEquipItem(int32 CurrentSlotIndex, int32 NewSlotIndex)
+{
+	// EquippedWeapon is already the new weapon when this is broadcast
+	UpdateEquippedSlot(CurrentSlotIndex, NewSlotIndex);
+	InvalidatePanel(InventoryRetainer, InventoryInvalidation);
+
+	BindEquippedWeapon();
+	RefreshAmmo();
+}
+
+void UShooterHUDOverlay::OnCarriedAmmoChanged(EAmmoType AmmoType, int32 CarriedAmmo)
+{
+	if (BoundWeapon && BoundWeapon->GetAmmoType() == AmmoType)
+	{
+		RefreshAmmo();
+	}
+}
+
+void UShooterHUDOverlay::OnInventorySlotChanged(int32 SlotIndex, const FInventoryWeaponRecord& Record)
+{
+	PushInventorySlot(SlotIndex, Record);
+	InvalidatePanel(InventoryRetainer, InventoryInvalidation);
+}
+
+void UShooterHUDOverlay::PushInventorySlot(int32 SlotIndex, const FInventoryWeaponRecord& Record)
+{
+	// Put away weapons have no actor to read the icons from
+	const FWeaponDataTable* WeaponData = Record.IsValid() ? AWeapon::FindWeaponData(Record.WeaponType) : nullptr;
+	UpdateInventorySlot(SlotIndex, Record,
+		WeaponData ? WeaponData->InventoryIcon : nullptr,
+		WeaponData ? WeaponData->AmmoIcon : nullptr);
+}
+
+void UShooterHUDOverlay::OnCombatStateChanged(ECombatState NewCombatState)
+{
+	UpdateCombatState(NewCombatState);
+	InvalidatePanel(AmmoRetainer, AmmoInvalidation);
+}
+
+void UShooterHUDOverlay::OnWeaponAmmoChanged(AWeapon* Weapon, int32 Ammo)
+{
+	RefreshAmmo();
+}
@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blueprint/UserWidget.h"
+#include "AmmoType.h"
+#include "ShooterCharacter.h"
+#include "ShooterHUDOverlay.generated.h"
+
+class AWeapon;
+class URetainerBox;
+class UInvalidationBox;
+class UTexture2D;
+
+/**
+ * Native base for the HUD Overlay Blueprint. Listens to the character's and equipped weapon's change events
+ * and pushes them to Blueprint, so the widget needs no per-frame property bindings.
+ * After each change only the affected retainer or invalidation panel is redrawn.
+ */
+UCLASS()
+class SHOOTER_API UShooterHUDOverlay : public UUserWidget
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Starts listening to Character's events and pushes its current state. Called by the player controller on possess */
+	void SetShooterCharacter(AShooterCharacter* Character);
+
+protected:
+
+	virtual void NativeConstruct() override;
+
+	virtual void NativeDestruct() override;
+
+	/* Equipped weapon ammo or carried ammo of its type changed */
+	UFUNCTION(BlueprintImplementableEvent, Category = HUD)
+	void UpdateAmmo(int32 WeaponAmmo, int32 CarriedAmmo);
+
+	/* An inventory slot got a new weapon record. The icons come from the weapon data table row of its type */
+	UFUNCTION(BlueprintImplementableEvent, Category = HUD)
+	void UpdateInventorySlot(int32 SlotIndex, const FInventoryWeaponRecord& Record, UTexture2D* ItemIcon, UTexture2D* AmmoIcon);
+
+	/* The equipped slot changed, CurrentSlotIndex is -1 on the first equip */
+	UFUNCTION(BlueprintImplementableEvent, Category = HUD)
+	void UpdateEquippedSlot(int32 CurrentSlotIndex, int32 NewSlotIndex);
+
+	UFUNCTION(BlueprintImplementableEvent, Category = HUD)
+	void UpdateCombatState(ECombatState NewCombatState);
+
+private:
+
+	UFUNCTION()
+	void OnEquipItem(int32 CurrentSlotIndex, int32 NewSlotIndex);
+
+	UFUNCTION()
+	void OnCarriedAmmoChanged(EAmmoType AmmoType, int32 CarriedAmmo);
+
+	UFUNCTION()
+	void OnInventorySlotChanged(int32 SlotIndex, const FInventoryWeaponRecord& Record);
+
+	/* Looks up the icons for Record and calls UpdateInventorySlot */
+	void PushInventorySlot(int32 SlotIndex, const FInventoryWeaponRecord& Record);
+
+	UFUNCTION()
+	void OnCombatStateChanged(ECombatState NewCombatState);
+
+	UFUNCTION()
+	void OnWeaponAmmoChanged(AWeapon* Weapon, int32 Ammo);
+
+	void UnbindCharacter();
+
+	/* Moves the ammo listener to the currently equipped weapon */
+	void BindEquippedWeapon();
+
+	void RefreshAmmo();
+
+	/* Redraw a retained panel and its invalidation box on the next frame */
+	void InvalidatePanel(URetainerBox* Retainer, UInvalidationBox* Invalidation);
+
+	/* Optional panels around the ammo counter and the inventory bar, bound by name from the Blueprint.
+	 * Retainers should render on invalidation rather than on phase so they only redraw when asked to */
+	UPROPERTY(meta = (BindWidgetOptional))
+	URetainerBox* AmmoRetainer;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	UInvalidationBox* AmmoInvalidation;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	URetainerBox* InventoryRetainer;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	UInvalidationBox* InventoryInvalidation;
+
+	UPROPERTY()
+	AShooterCharacter* ShooterCharacter;
+
+	UPROPERTY()
+	AWeapon* BoundWeapon;
+};
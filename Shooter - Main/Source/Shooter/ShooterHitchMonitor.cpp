@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterHitchMonitor.h"
+#include "Shooter.h"
+#include "Engine/World.h"
+#include "Async/Async.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "RenderCore.h"
+
+static TAutoConsoleVariable<float> CVarHitchBudgetMs(
+	TEXT("Shooter.Hitch.BudgetMs"),
+	50.f,
+	TEXT("Frames longer than this many ms are written to Saved/Hitches with their gameplay events. 0 turns the monitor off"));
+
+static TAutoConsoleVariable<int32> CVarHitchMaxRecords(
+	TEXT("Shooter.Hitch.MaxRecords"),
+	32,
+	TEXT("Hitch records kept on disk, the oldest is overwritten first"));
+
+namespace ShooterHitch
+{
+	/* A runaway frame shouldn't turn into a runaway record */
+	constexpr int32 MaxEventsPerFrame = 1024;
+
+	void AddEvent(EShooterHitchEvent Type, const UObject* Source, FName Detail)
+	{
+		if (Source == nullptr || !IsInGameThread()) return;
+
+		// Each world keeps its own timeline, a PIE client's events don't end up in the server's hitches
+		const UWorld* World = Source->GetWorld();
+		UShooterHitchMonitor* Monitor = World ? World->GetSubsystem<UShooterHitchMonitor>() : nullptr;
+		if (Monitor)
+		{
+			Monitor->AddEvent(Type, Source, Detail);
+		}
+	}
+
+	const TCHAR* GetEventName(EShooterHitchEvent Type)
+	{
+		switch (Type)
+		{
+		case EShooterHitchEvent::Shot: return TEXT("Shot");
+		case EShooterHitchEvent::ImpactFX: return TEXT("ImpactFX");
+		case EShooterHitchEvent::CombatState: return TEXT("CombatState");
+		case EShooterHitchEvent::ItemState: return TEXT("ItemState");
+		case EShooterHitchEvent::Spawn: return TEXT("Spawn");
+		case EShooterHitchEvent::Pickup: return TEXT("Pickup");
+		case EShooterHitchEvent::Swap: return TEXT("Swap");
+		case EShooterHitchEvent::Drop: return TEXT("Drop");
+		case EShooterHitchEvent::Explosion: return TEXT("Explosion");
+		default: break;
+		}
+		return TEXT("Unknown");
+	}
+}
+
+void UShooterHitchMonitor::Deinitialize()
+{
+	bRecording = false;
+	Events.Reset();
+
+	Super::Deinitialize();
+}
+
+void UShooterHitchMonitor::AddEvent(EShooterHitchEvent Type, const UObject* Source, FName Detail)
+{
+	if (!bRecording || Events.Num() >= ShooterHitch::MaxEventsPerFrame) return;
+
+	Events.Add({ FPlatformTime::Seconds(), Type, Source ? Source->GetFName() : NAME_None, Detail });
+}
+
+TStatId UShooterHitchMonitor::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterHitchMonitor, STATGROUP_Tickables);
+}
+
+void UShooterHitchMonitor::Tick(float DeltaTime)
+{
+	const double Now{ FPlatformTime::Seconds() };
+	const double BudgetMs{ CVarHitchBudgetMs.GetValueOnGameThread() };
+
+	// Taken every frame, so a hitch shows only its own shots and traces
+	const ShooterStats::FCounterSnapshot Counters{ ShooterStats::TakeCounterSnapshot() };
+
+	// From the last tick to this one covers the end of the previous frame and the gameplay of this one,
+	// the same span the recorded events come from
+	const double FrameStartTime{ LastTickTime };
+	const double FrameMs{ (Now - LastTickTime) * 1000.0 };
+	LastTickTime = Now;
+
+	// Nothing to compare the first frame against, and it usually includes the map load
+	if (BudgetMs > 0.0 && FrameStartTime > 0.0 && FrameMs > BudgetMs)
+	{
+		WriteHitch(FrameMs, BudgetMs, FrameStartTime, Counters);
+	}
+
+	Events.Reset();
+	bRecording = BudgetMs > 0.0;
+}
+
+void UShooterHitchMonitor::WriteHitch(double FrameMs, double BudgetMs, double FrameStartTime, const ShooterStats::FCounterSnapshot& Counters)
+{
+	TSharedRef<FJsonObject> Record = MakeShared<FJsonObject>();
+	Record->SetStringField(TEXT("time"), FDateTime::UtcNow().ToIso8601());
+	Record->SetStringField(TEXT("map"), GetWorld()->GetMapName());
+	Record->SetNumberField(TEXT("frame"), static_cast<double>(GFrameCounter));
+	Record->SetNumberField(TEXT("frameMs"), FrameMs);
+	Record->SetNumberField(TEXT("budgetMs"), BudgetMs);
+
+	// Thread times are from the last completed frame
+	Record->SetNumberField(TEXT("gameThreadMs"), FPlatformTime::ToMilliseconds(GGameThreadTime));
+	Record->SetNumberField(TEXT("renderThreadMs"), FPlatformTime::ToMilliseconds(GRenderThreadTime));
+
+	TSharedRef<FJsonObject> CountersJson = MakeShared<FJsonObject>();
+	CountersJson->SetNumberField(TEXT("shots"), Counters.Shots);
+	CountersJson->SetNumberField(TEXT("traces"), Counters.Traces);
+	CountersJson->SetNumberField(TEXT("interpingItems"), Counters.InterpingItems);
+	CountersJson->SetNumberField(TEXT("liveHitNumbers"), Counters.LiveHitNumbers);
+	Record->SetObjectField(TEXT("counters"), CountersJson);
+
+	TArray<TSharedPtr<FJsonValue>> Timeline;
+	for (const FEvent& Event : Events)
+	{
+		TSharedRef<FJsonObject> EventJson = MakeShared<FJsonObject>();
+		EventJson->SetNumberField(TEXT("ms"), (Event.Time - FrameStartTime) * 1000.0);
+		EventJson->SetStringField(TEXT("type"), ShooterHitch::GetEventName(Event.Type));
+		EventJson->SetStringField(TEXT("source"), Event.Source.ToString());
+		if (!Event.Detail.IsNone())
+		{
+			EventJson->SetStringField(TEXT("detail"), Event.Detail.ToString());
+		}
+		Timeline.Add(MakeShared<FJsonValueObject>(EventJson));
+	}
+	Record->SetArrayField(TEXT("events"), Timeline);
+
+	FString Output;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	FJsonSerializer::Serialize(Record, Writer);
+
+	const int32 Slot{ NumHitches % FMath::Max(CVarHitchMaxRecords.GetValueOnGameThread(), 1) };
+	const FString RecordPath{ FPaths::ProjectSavedDir() / TEXT("Hitches") / FString::Printf(TEXT("Hitch-%02d.json"), Slot) };
+	++NumHitches;
+
+	UE_LOG(LogShooter, Warning, TEXT("Hitch: %.1f ms over a %.1f ms budget, %d events, %d shots, written to %s"),
+		FrameMs, BudgetMs, Events.Num(), Counters.Shots, *RecordPath);
+
+	// Writing on the game thread would make the next frame hitch too
+	AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, [Output = MoveTemp(Output), RecordPath]()
+	{
+		FFileHelper::SaveStringToFile(Output, *RecordPath);
+	});
+}
@@ -0,0 +1,76 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShooterTickableWorldSubsystem.h"
+#include "ShooterStats.h"
+#include "ShooterHitchMonitor.generated.h"
+
+/* Gameplay events kept for the hitch timeline */
+enum class EShooterHitchEvent : uint8
+{
+	Shot,
+	ImpactFX,
+	CombatState,
+	ItemState,
+	Spawn,
+	Pickup,
+	Swap,
+	Drop,
+	Explosion
+};
+
+namespace ShooterHitch
+{
+	/* Records an event for the frame in progress with the monitor of Source's world. Does nothing while that monitor is off, game thread only */
+	SHOOTER_API void AddEvent(EShooterHitchEvent Type, const UObject* Source, FName Detail = NAME_None);
+}
+
+/**
+ * Watches the time between frames against Shooter.Hitch.BudgetMs. When a frame goes over, the gameplay events
+ * recorded during it and the Shooter counters are written to Saved/Hitches, a ring of Shooter.Hitch.MaxRecords files,
+ * so every hitch comes with a timeline of what the game was doing.
+ */
+UCLASS()
+class SHOOTER_API UShooterHitchMonitor : public UShooterTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	/* FTickableGameObject interface */
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/* Adds an event to this world's timeline, see ShooterHitch::AddEvent */
+	void AddEvent(EShooterHitchEvent Type, const UObject* Source, FName Detail);
+
+	FORCEINLINE int32 GetNumHitches() const { return NumHitches; }
+
+private:
+
+	struct FEvent
+	{
+		double Time;
+		EShooterHitchEvent Type;
+		FName Source;
+		FName Detail;
+	};
+
+	/* Writes the events since the last tick as one record of the ring, off the game thread */
+	void WriteHitch(double FrameMs, double BudgetMs, double FrameStartTime, const ShooterStats::FCounterSnapshot& Counters);
+
+	/* Events since the monitor last ticked */
+	TArray<FEvent> Events;
+
+	/* Set on the first tick while Shooter.Hitch.BudgetMs is on, so AddEvent costs a branch while it is off */
+	bool bRecording = false;
+
+	/* Wall time of the previous tick, 0 before the first */
+	double LastTickTime = 0.0;
+
+	int32 NumHitches = 0;
+};
@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterImpactSubsystem.h"
+#include "Components/DecalComponent.h"
+#include "Engine/World.h"
+#include "Kismet/GameplayStatics.h"
+#include "Particles/ParticleSystem.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "Sound/SoundBase.h"
+#include "ShooterLLM.h"
+#include "ShooterHitchMonitor.h"
+
+static TAutoConsoleVariable<int32> CVarImpactMaxDecals(
+	TEXT("Shooter.Impact.MaxDecals"),
+	64,
+	TEXT("Bullet hole decals kept in the world, the oldest is moved to the newest hit once they are all in use"));
+
+void UShooterImpactSubsystem::Deinitialize()
+{
+	for (UDecalComponent* Decal : Decals)
+	{
+		if (Decal)
+		{
+			Decal->DestroyComponent();
+		}
+	}
+	Decals.Reset();
+	LoadedAssets.Reset();
+
+	Super::Deinitialize();
+}
+
+void UShooterImpactSubsystem::BuildTable()
+{
+	bTableBuilt = true;
+
+	auto Load = [this](auto& SoftPtr)
+	{
+		auto* Asset = SoftPtr.LoadSynchronous();
+		if (Asset)
+		{
+			LoadedAssets.Add(Asset);
+		}
+		return Asset;
+	};
+
+	bool bConfigured[SurfaceType_Max]{};
+	for (const FShooterImpactEffect& Entry : SurfaceEffects)
+	{
+		FResolvedEffect& Effect = Effects[Entry.Surface.GetValue()];
+		Effect.Particles = Load(Entry.Particles);
+		Effect.Sound = Load(Entry.Sound);
+		Effect.DecalMaterial = Load(Entry.DecalMaterial);
+		Effect.DecalSize = Entry.DecalSize;
+		bConfigured[Entry.Surface.GetValue()] = true;
+	}
+
+	// Every slot filled, so a lookup never has to fall back at runtime
+	for (int32 Surface = 0; Surface < SurfaceType_Max; ++Surface)
+	{
+		if (!bConfigured[Surface])
+		{
+			Effects[Surface] = Effects[SurfaceType_Default];
+		}
+	}
+}
+
+void UShooterImpactSubsystem::SpawnImpact(const FHitResult& HitResult, UParticleSystem* FallbackParticles)
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr || World->IsNetMode(NM_DedicatedServer)) return;
+
+	if (!bTableBuilt)
+	{
+		BuildTable();
+	}
+
+	SHOOTER_LLM_SCOPE(CombatFX);
+
+	// Traces that feed this ask for the physical material, anything without one is the default surface
+	const EPhysicalSurface Surface{ UPhysicalMaterial::DetermineSurfaceType(HitResult.PhysMaterial.Get()) };
+	const FResolvedEffect& Effect = Effects[Surface];
+
+	const FRotator SurfaceRotation{ HitResult.ImpactNormal.Rotation() };
+	UParticleSystem* Particles{ Effect.Particles ? Effect.Particles : FallbackParticles };
+	if (Particles)
+	{
+		ShooterHitch::AddEvent(EShooterHitchEvent::ImpactFX, HitResult.GetActor(), Particles->GetFName());
+
+		// Pooled, a burst of fire reuses finished components instead of creating one per hit
+		UGameplayStatics::SpawnEmitterAtLocation(World, Particles, HitResult.ImpactPoint, SurfaceRotation, FVector(1.f), true, EPSCPoolMethod::AutoRelease);
+	}
+	if (Effect.Sound)
+	{
+		UGameplayStatics::PlaySoundAtLocation(World, Effect.Sound, HitResult.ImpactPoint);
+	}
+	if (Effect.DecalMaterial)
+	{
+		PlaceDecal(HitResult, Effect);
+	}
+}
+
+void UShooterImpactSubsystem::PlaceDecal(const FHitResult& HitResult, const FResolvedEffect& Effect)
+{
+	// The decal isn't attached, on something that moves it would be left floating
+	const UPrimitiveComponent* HitComponent = HitResult.GetComponent();
+	if (HitComponent && HitComponent->Mobility != EComponentMobility::Static) return;
+
+	UDecalComponent* Decal{ nullptr };
+	const int32 MaxDecals{ FMath::Max(CVarImpactMaxDecals.GetValueOnGameThread(), 1) };
+	if (Decals.Num() < MaxDecals)
+	{
+		UWorld* World = GetWorld();
+		Decal = NewObject<UDecalComponent>(World);
+		Decal->bAllowAnyoneToDestroyMe = true;
+		Decal->SetFadeScreenSize(0.001f);
+		Decal->RegisterComponentWithWorld(World);
+		Decals.Add(Decal);
+	}
+	else
+	{
+		// Full, the oldest becomes the newest
+		NextDecal %= Decals.Num();
+		Decal = Decals[NextDecal];
+		++NextDecal;
+	}
+	if (Decal == nullptr) return;
+
+	// Projects along -X, into the surface. A random roll keeps a spray of holes from looking stamped
+	FRotator DecalRotation{ (-HitResult.ImpactNormal).Rotation() };
+	DecalRotation.Roll = FMath::FRandRange(-180.f, 180.f);
+	Decal->SetDecalMaterial(Effect.DecalMaterial);
+	Decal->DecalSize = Effect.DecalSize;
+	Decal->SetWorldLocationAndRotation(HitResult.ImpactPoint, DecalRotation);
+	Decal->MarkRenderStateDirty();
+}
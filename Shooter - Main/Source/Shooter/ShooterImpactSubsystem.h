@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Engine/EngineTypes.h"
+#include "ShooterImpactSubsystem.generated.h"
+
+class UParticleSystem;
+class USoundBase;
+class UMaterialInterface;
+class UDecalComponent;
+
+/* Effects for one physical surface type, from DefaultGame.ini */
+USTRUCT()
+struct FShooterImpactEffect
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TEnumAsByte<EPhysicalSurface> Surface = SurfaceType_Default;
+
+	UPROPERTY()
+	TSoftObjectPtr<UParticleSystem> Particles;
+
+	UPROPERTY()
+	TSoftObjectPtr<USoundBase> Sound;
+
+	/* No decal is placed while this is unset */
+	UPROPERTY()
+	TSoftObjectPtr<UMaterialInterface> DecalMaterial;
+
+	/* Decal extent, X is the projection depth */
+	UPROPERTY()
+	FVector DecalSize = FVector(4.f, 6.f, 6.f);
+};
+
+/**
+ * Bullet impacts on world geometry. Particles, sound and decal come from a table indexed by the physical surface
+ * that was hit, surfaces without an entry use the SurfaceType_Default one. Decals live in a ring of at most
+ * Shooter.Impact.MaxDecals components that recycles the oldest, so a long firefight doesn't pile them up.
+ */
+UCLASS(Config = Game)
+class SHOOTER_API UShooterImpactSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	/* Plays the effects for the surface under HitResult. FallbackParticles stands in when the table has none */
+	void SpawnImpact(const FHitResult& HitResult, UParticleSystem* FallbackParticles = nullptr);
+
+	FORCEINLINE int32 GetNumDecals() const { return Decals.Num(); }
+
+private:
+
+	struct FResolvedEffect
+	{
+		UParticleSystem* Particles = nullptr;
+		USoundBase* Sound = nullptr;
+		UMaterialInterface* DecalMaterial = nullptr;
+		FVector DecalSize = FVector::ZeroVector;
+	};
+
+	/* Loads SurfaceEffects into Effects, on the first impact so worlds that never see one don't load anything */
+	void BuildTable();
+
+	void PlaceDecal(const FHitResult& HitResult, const FResolvedEffect& Effect);
+
+	UPROPERTY(Config)
+	TArray<FShooterImpactEffect> SurfaceEffects;
+
+	/* Indexed by EPhysicalSurface */
+	FResolvedEffect Effects[SurfaceType_Max];
+
+	/* Keeps the assets Effects points at loaded */
+	UPROPERTY()
+	TArray<UObject*> LoadedAssets;
+
+	UPROPERTY()
+	TArray<UDecalComponent*> Decals;
+
+	/* Ring position of the decal to recycle next once the ring is full */
+	int32 NextDecal = 0;
+
+	bool bTableBuilt = false;
+};
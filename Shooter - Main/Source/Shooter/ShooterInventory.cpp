@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterInventory.h"
+#include "ShooterCharacter.h"
+#include "Weapon.h"
+
+bool FInventoryWeaponRecord::IsArchetypeOf(const AWeapon* Weapon) const
+{
+	return Weapon && Weapon->GetClass() == WeaponClass && Weapon->GetWeaponType() == WeaponType;
+}
+
+void FInventorySlotEntry::PostReplicatedAdd(const FInventorySlotArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnInventorySlotReplicated(SlotIndex, Record);
+	}
+}
+
+void FInventorySlotEntry::PostReplicatedChange(const FInventorySlotArray& InArraySerializer)
+{
+	if (InArraySerializer.Owner)
+	{
+		InArraySerializer.Owner->OnInventorySlotReplicated(SlotIndex, Record);
+	}
+}
+
+void FInventorySlotArray::SetSlot(int32 SlotIndex, const FInventoryWeaponRecord& Record)
+{
+	for (FInventorySlotEntry& Entry : Slots)
+	{
+		if (Entry.SlotIndex == SlotIndex)
+		{
+			if (Entry.Record != Record)
+			{
+				Entry.Record = Record;
+				MarkItemDirty(Entry);
+			}
+			return;
+		}
+	}
+
+	FInventorySlotEntry& Entry = Slots.AddDefaulted_GetRef();
+	Entry.SlotIndex = static_cast<uint8>(SlotIndex);
+	Entry.Record = Record;
+	MarkItemDirty(Entry);
+}
+
+bool FInventorySlotArray::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+	const int64 BitsBefore{ DeltaParms.Writer ? DeltaParms.Writer->GetNumBits() : 0 };
+
+	const bool bWroteDelta{ FFastArraySerializer::FastArrayDeltaSerialize<FInventorySlotEntry, FInventorySlotArray>(Slots, DeltaParms, *this) };
+
+	if (DeltaParms.Writer && bWroteDelta)
+	{
+		BitsSent += DeltaParms.Writer->GetNumBits() - BitsBefore;
+		++DeltasSent;
+	}
+	return bWroteDelta;
+}
@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "WeaponType.h"
+#include "ShooterInventory.generated.h"
+
+class AWeapon;
+class AShooterCharacter;
+struct FInventorySlotArray;
+
+/**
+ * A weapon as the inventory keeps it. Only the equipped weapon is an actor, every other slot is just this record
+ * until it is equipped again and UShooterWeaponPool turns it back into one.
+ */
+USTRUCT(BlueprintType)
+struct FInventoryWeaponRecord
+{
+	GENERATED_BODY()
+
+	/* Blueprint the weapon is spawned from, unset for an empty slot */
+	UPROPERTY(BlueprintReadOnly, Category = Inventory)
+	TSubclassOf<AWeapon> WeaponClass;
+
+	/* Picks the data table row, together with WeaponClass the weapon's archetype */
+	UPROPERTY(BlueprintReadOnly, Category = Inventory)
+	EWeaponType WeaponType = EWeaponType::EWT_SubmachineGun;
+
+	/* Rounds in the magazine. For the equipped slot, the rounds it had when it was equipped */
+	UPROPERTY(BlueprintReadOnly, Category = Inventory)
+	int32 Ammo = 0;
+
+	/* The slot of the weapon in hand */
+	UPROPERTY(BlueprintReadOnly, Category = Inventory)
+	uint8 bEquipped : 1;
+
+	FInventoryWeaponRecord() : bEquipped(false) {}
+
+	FORCEINLINE bool IsValid() const { return WeaponClass != nullptr; }
+
+	/* True when Weapon is this record's archetype. Every weapon shares a Blueprint, the class alone doesn't tell them apart */
+	bool IsArchetypeOf(const AWeapon* Weapon) const;
+
+	bool operator==(const FInventoryWeaponRecord& Other) const
+	{
+		return WeaponClass == Other.WeaponClass && WeaponType == Other.WeaponType && Ammo == Other.Ammo && bEquipped == Other.bEquipped;
+	}
+	bool operator!=(const FInventoryWeaponRecord& Other) const { return !(*this == Other); }
+};
+
+/* One inventory slot. Only slots that changed are sent */
+USTRUCT()
+struct FInventorySlotEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FInventoryWeaponRecord Record;
+
+	UPROPERTY()
+	uint8 SlotIndex = 0;
+
+	/* Fast array callbacks, client only */
+	void PostReplicatedAdd(const FInventorySlotArray& InArraySerializer);
+	void PostReplicatedChange(const FInventorySlotArray& InArraySerializer);
+};
+
+/**
+ * Replicated inventory slots of a character. Entries are keyed by SlotIndex, so their order on clients doesn't matter.
+ * Clients hear about changed slots through AShooterCharacter::OnInventorySlotReplicated.
+ */
+USTRUCT()
+struct FInventorySlotArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FInventorySlotEntry> Slots;
+
+	/* Set by the owning character, not replicated */
+	UPROPERTY(NotReplicated)
+	AShooterCharacter* Owner = nullptr;
+
+	/* Server: bits written by delta serialization and how many deltas were sent */
+	int64 BitsSent = 0;
+	int32 DeltasSent = 0;
+
+	/* Server: puts Record into SlotIndex and marks only that slot dirty */
+	void SetSlot(int32 SlotIndex, const FInventoryWeaponRecord& Record);
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+};
+
+template<>
+struct TStructOpsTypeTraits<FInventorySlotArray> : public TStructOpsTypeTraitsBase2<FInventorySlotArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterLLM.h"
+#include "Stats/Stats.h"
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+
+DECLARE_LLM_MEMORY_STAT(TEXT("Shooter Weapons"), STAT_ShooterWeaponsLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("Shooter Items"), STAT_ShooterItemsLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("Shooter Enemies"), STAT_ShooterEnemiesLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("Shooter HitNumbers"), STAT_ShooterHitNumbersLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("Shooter HUD"), STAT_ShooterHUDLLM, STATGROUP_LLMFULL);
+DECLARE_LLM_MEMORY_STAT(TEXT("Shooter CombatFX"), STAT_ShooterCombatFXLLM, STATGROUP_LLMFULL);
+
+/* All tags together in the summary group, "stat LLM" */
+DECLARE_LLM_MEMORY_STAT(TEXT("Shooter"), STAT_ShooterSummaryLLM, STATGROUP_LLM);
+
+namespace ShooterLLM
+{
+	void RegisterTags()
+	{
+		FLowLevelMemTracker& Tracker = FLowLevelMemTracker::Get();
+		const FName SummaryStat{ GET_STATFNAME(STAT_ShooterSummaryLLM) };
+
+		Tracker.RegisterProjectTag(static_cast<int32>(EShooterLLMTag::Weapons), GetTagName(EShooterLLMTag::Weapons), GET_STATFNAME(STAT_ShooterWeaponsLLM), SummaryStat);
+		Tracker.RegisterProjectTag(static_cast<int32>(EShooterLLMTag::Items), GetTagName(EShooterLLMTag::Items), GET_STATFNAME(STAT_ShooterItemsLLM), SummaryStat);
+		Tracker.RegisterProjectTag(static_cast<int32>(EShooterLLMTag::Enemies), GetTagName(EShooterLLMTag::Enemies), GET_STATFNAME(STAT_ShooterEnemiesLLM), SummaryStat);
+		Tracker.RegisterProjectTag(static_cast<int32>(EShooterLLMTag::HitNumbers), GetTagName(EShooterLLMTag::HitNumbers), GET_STATFNAME(STAT_ShooterHitNumbersLLM), SummaryStat);
+		Tracker.RegisterProjectTag(static_cast<int32>(EShooterLLMTag::HUD), GetTagName(EShooterLLMTag::HUD), GET_STATFNAME(STAT_ShooterHUDLLM), SummaryStat);
+		Tracker.RegisterProjectTag(static_cast<int32>(EShooterLLMTag::CombatFX), GetTagName(EShooterLLMTag::CombatFX), GET_STATFNAME(STAT_ShooterCombatFXLLM), SummaryStat);
+	}
+
+	const TCHAR* GetTagName(EShooterLLMTag Tag)
+	{
+		switch (Tag)
+		{
+		case EShooterLLMTag::Weapons: return TEXT("ShooterWeapons");
+		case EShooterLLMTag::Items: return TEXT("ShooterItems");
+		case EShooterLLMTag::Enemies: return TEXT("ShooterEnemies");
+		case EShooterLLMTag::HitNumbers: return TEXT("ShooterHitNumbers");
+		case EShooterLLMTag::HUD: return TEXT("ShooterHUD");
+		case EShooterLLMTag::CombatFX: return TEXT("ShooterCombatFX");
+		default: break;
+		}
+		return TEXT("ShooterUnknown");
+	}
+
+	int64 GetTagAmount(EShooterLLMTag Tag)
+	{
+		if (!FLowLevelMemTracker::IsEnabled()) return 0;
+
+		return FLowLevelMemTracker::Get().GetTagAmountForTracker(ELLMTracker::Default, static_cast<ELLMTag>(Tag));
+	}
+}
+
+#endif
@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+
+/* Shooter's Low-Level Memory Tracker tags. Run with -llm, then "stat LLMFULL", memreport or -llmcsv break memory down by them */
+enum class EShooterLLMTag : uint8
+{
+	/* Weapons handed straight to a character, default and restored inventory, and weapon data loading */
+	Weapons = static_cast<uint8>(ELLMTag::ProjectTagStart),
+
+	/* Item actors spawned to be picked up, ground weapons included */
+	Items,
+
+	Enemies,
+	HitNumbers,
+	HUD,
+	CombatFX,
+
+	End
+};
+
+#define SHOOTER_LLM_SCOPE(Tag) LLM_SCOPE(static_cast<ELLMTag>(EShooterLLMTag::Tag))
+
+namespace ShooterLLM
+{
+	/* Registers the tags with the tracker, called at module startup */
+	void RegisterTags();
+
+	const TCHAR* GetTagName(EShooterLLMTag Tag);
+
+	/* Bytes currently tracked under Tag, 0 when LLM isn't running */
+	int64 GetTagAmount(EShooterLLMTag Tag);
+}
+
+#else
+
+#define SHOOTER_LLM_SCOPE(Tag)
+
+#endif
@@ -0,0 +1,1029 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterPerfSubsystem.h"
+#include "Shooter.h"
+#include "Engine/World.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "RenderCore.h"
+#include "UObject/UObjectArray.h"
+#include "Enemy.h"
+#include "Weapon.h"
+#include "ShooterCharacter.h"
+#include "ShooterLLM.h"
+#include "ShooterExplosion.h"
+#include "ShooterWeaponPool.h"
+#include "ShooterCombatClock.h"
+#include "ShooterDeathManager.h"
+#include "EngineUtils.h"
+
+static TAutoConsoleVariable<int32> CVarPerfEnemies(
+	TEXT("Shooter.Perf.Enemies"),
+	50,
+	TEXT("Enemies spawned around the player by the Enemies scenario"));
+
+static TAutoConsoleVariable<int32> CVarPerfGroundItems(
+	TEXT("Shooter.Perf.GroundItems"),
+	100,
+	TEXT("Weapons scattered around the player by the GroundItems scenario"));
+
+static TAutoConsoleVariable<int32> CVarPerfShots(
+	TEXT("Shooter.Perf.Shots"),
+	300,
+	TEXT("Shots of automatic fire in the FullAuto scenario"));
+
+static TAutoConsoleVariable<int32> CVarPerfSwapCycles(
+	TEXT("Shooter.Perf.SwapCycles"),
+	60,
+	TEXT("Pickups and inventory slot exchanges in the PickupSwap scenario"));
+
+static TAutoConsoleVariable<int32> CVarPerfReloadCycles(
+	TEXT("Shooter.Perf.ReloadCycles"),
+	20,
+	TEXT("Reloads in the Reload scenario"));
+
+static TAutoConsoleVariable<int32> CVarPerfFrames(
+	TEXT("Shooter.Perf.Frames"),
+	600,
+	TEXT("Frames measured by the Enemies, GroundItems and Traces scenarios"));
+
+static TAutoConsoleVariable<int32> CVarPerfTracesPerFrame(
+	TEXT("Shooter.Perf.TracesPerFrame"),
+	256,
+	TEXT("Rays cast per channel each frame of the Traces scenario"));
+
+static TAutoConsoleVariable<int32> CVarPerfCrowdEnemies(
+	TEXT("Shooter.Perf.CrowdEnemies"),
+	200,
+	TEXT("Enemies in the crowd the Explosion scenario detonates in"));
+
+static TAutoConsoleVariable<int32> CVarPerfExplosions(
+	TEXT("Shooter.Perf.Explosions"),
+	30,
+	TEXT("Explosions in the Explosion scenario, each one does 1 damage so the crowd survives them all"));
+
+static TAutoConsoleVariable<int32> CVarPerfInventoryCharacters(
+	TEXT("Shooter.Perf.InventoryCharacters"),
+	32,
+	TEXT("Extra characters with a full inventory in the Inventories scenario"));
+
+static TAutoConsoleVariable<int32> CVarPerfDeaths(
+	TEXT("Shooter.Perf.Deaths"),
+	100,
+	TEXT("Enemies killed by the Deaths scenario, the same stress test as Shooter.Death.Stress"));
+
+static TAutoConsoleVariable<float> CVarPerfDeathDuration(
+	TEXT("Shooter.Perf.DeathDuration"),
+	1.f,
+	TEXT("Seconds the Deaths scenario spreads its kills over"));
+
+static FAutoConsoleCommandWithWorld PerfRunCommand(
+	TEXT("Shooter.Perf.Run"),
+	TEXT("Runs the perf scenarios and writes a report to Saved/Perf"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UShooterPerfSubsystem* Perf = World ? World->GetSubsystem<UShooterPerfSubsystem>() : nullptr;
+		if (Perf)
+		{
+			Perf->StartScenarios();
+		}
+	}));
+
+void UShooterPerfSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	if (!IsInGameWorld()) return;
+
+	if (FParse::Param(FCommandLine::Get(), TEXT("ShooterPerf")))
+	{
+		bExitWhenDone = true;
+		StartScenarios();
+	}
+}
+
+void UShooterPerfSubsystem::Deinitialize()
+{
+	if (Mode == EPerfMode::Running)
+	{
+		EndScenario();
+	}
+	Mode = EPerfMode::None;
+	SetPhysicsTimerEnabled(false);
+
+	Super::Deinitialize();
+}
+
+TStatId UShooterPerfSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterPerfSubsystem, STATGROUP_Tickables);
+}
+
+const TCHAR* UShooterPerfSubsystem::GetScenarioName(EPerfScenario Scenario)
+{
+	switch (Scenario)
+	{
+	case EPerfScenario::Enemies: return TEXT("Enemies");
+	case EPerfScenario::GroundItems: return TEXT("GroundItems");
+	case EPerfScenario::FullAuto: return TEXT("FullAuto");
+	case EPerfScenario::PickupSwap: return TEXT("PickupSwap");
+	case EPerfScenario::Reload: return TEXT("Reload");
+	case EPerfScenario::Traces: return TEXT("Traces");
+	case EPerfScenario::Explosion: return TEXT("Explosion");
+	case EPerfScenario::Inventories: return TEXT("Inventories");
+	case EPerfScenario::CombatDeterminism: return TEXT("CombatDeterminism");
+	case EPerfScenario::Deaths: return TEXT("Deaths");
+	default: break;
+	}
+	return TEXT("Unknown");
+}
+
+void UShooterPerfSubsystem::StartScenarios()
+{
+	if (Mode != EPerfMode::None)
+	{
+		UE_LOG(LogShooter, Warning, TEXT("Perf scenarios are already running"));
+		return;
+	}
+
+	Results.Reset();
+	Mode = EPerfMode::Pending;
+}
+
+void UShooterPerfSubsystem::Tick(float DeltaTime)
+{
+	switch (Mode)
+	{
+	case EPerfMode::Pending:
+		// Wait for the default weapon too, every scenario but Enemies needs it
+		if (GetReadyLocalCharacter())
+		{
+			Mode = EPerfMode::Running;
+			SetPhysicsTimerEnabled(true);
+			BeginScenario(EPerfScenario::Enemies);
+		}
+		break;
+
+	case EPerfMode::Running:
+		{
+			const double Now{ FPlatformTime::Seconds() };
+			CurrentResult.FrameMs.AddSample(static_cast<float>((Now - LastFrameTime) * 1000.0));
+			CurrentResult.GameThreadMs.AddSample(static_cast<float>(FPlatformTime::ToMilliseconds(GGameThreadTime)));
+			CurrentResult.PeakMemoryMB = FMath::Max(CurrentResult.PeakMemoryMB, FPlatformMemory::GetStats().UsedPhysical / (1024.0 * 1024.0));
+			LastFrameTime = Now;
+
+			++ScenarioFrame;
+			++CurrentResult.Frames;
+
+			const bool bDone{ StepScenario() };
+			if (!bDone && ScenarioFrame >= ScenarioFrameLimit)
+			{
+				CurrentResult.Failures.Add(FString::Printf(TEXT("stalled after %d frames with %d actions"), ScenarioFrame, CurrentResult.Actions));
+			}
+			if (bDone || ScenarioFrame >= ScenarioFrameLimit)
+			{
+				EndScenario();
+
+				const EPerfScenario NextScenario{ static_cast<EPerfScenario>(static_cast<uint8>(CurrentScenario) + 1) };
+				if (NextScenario == EPerfScenario::MAX)
+				{
+					FinishScenarios();
+				}
+				else
+				{
+					BeginScenario(NextScenario);
+				}
+			}
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+void UShooterPerfSubsystem::BeginScenario(EPerfScenario Scenario)
+{
+	CurrentScenario = Scenario;
+	CurrentResult = FPerfScenarioResult();
+	CurrentResult.Name = GetScenarioName(Scenario);
+	CurrentResult.MemoryStartMB = FPlatformMemory::GetStats().UsedPhysical / (1024.0 * 1024.0);
+	CurrentResult.PeakMemoryMB = CurrentResult.MemoryStartMB;
+	CurrentResult.ObjectsStart = GUObjectArray.GetObjectArrayNumMinusAvailable();
+
+	ScenarioFrame = 0;
+	bWaitingForCombatState = false;
+	LastFrameTime = FPlatformTime::Seconds();
+	PhysicsStartCycles = 0;
+
+	AShooterCharacter* Character = GetLocalCharacter();
+	if (Character == nullptr)
+	{
+		CurrentResult.Failures.Add(TEXT("no local character"));
+		ScenarioFrameLimit = 0;
+		return;
+	}
+	Character->ScriptedRefillAmmo();
+
+	switch (Scenario)
+	{
+	case EPerfScenario::Enemies:
+		ScenarioFrameLimit = CVarPerfFrames.GetValueOnGameThread();
+		SpawnEnemies(CVarPerfEnemies.GetValueOnGameThread());
+		break;
+
+	case EPerfScenario::GroundItems:
+		ScenarioFrameLimit = CVarPerfFrames.GetValueOnGameThread();
+
+		// Tight enough that the character overlaps a few of them and traces for items every frame
+		SpawnGroundWeapons(CVarPerfGroundItems.GetValueOnGameThread(), 150.f);
+		break;
+
+	case EPerfScenario::FullAuto:
+		ScenarioFrameLimit = CVarPerfShots.GetValueOnGameThread() * 20 + 600;
+		LastWeaponAmmo = Character->GetEquippedWeapon() ? Character->GetEquippedWeapon()->GetAmmo() : 0;
+		Character->ScriptedFire(true);
+		break;
+
+	case EPerfScenario::PickupSwap:
+		ScenarioFrameLimit = CVarPerfSwapCycles.GetValueOnGameThread() * 120 + 600;
+
+		// Enough to fill the inventory with some left over, so later pickups swap and drop
+		SpawnGroundWeapons(8, 150.f);
+		break;
+
+	case EPerfScenario::Reload:
+		ScenarioFrameLimit = CVarPerfReloadCycles.GetValueOnGameThread() * 300 + 600;
+		break;
+
+	case EPerfScenario::Traces:
+		ScenarioFrameLimit = CVarPerfFrames.GetValueOnGameThread();
+
+		// Visibility is what every trace used before the project channels, kept as the baseline
+		CurrentResult.ChannelTraces.SetNum(3);
+		CurrentResult.ChannelTraces[0].Channel = TEXT("Visibility");
+		CurrentResult.ChannelTraces[1].Channel = TEXT("Weapon");
+		CurrentResult.ChannelTraces[2].Channel = TEXT("Interact");
+
+		// Both kinds of clutter at once, the level a focus trace used to test every enemy in
+		SpawnEnemies(CVarPerfEnemies.GetValueOnGameThread());
+		SpawnGroundWeapons(CVarPerfGroundItems.GetValueOnGameThread(), 150.f);
+		break;
+
+	case EPerfScenario::Explosion:
+		ScenarioFrameLimit = CVarPerfExplosions.GetValueOnGameThread() * 10 + 600;
+		SpawnEnemyCrowd(CVarPerfCrowdEnemies.GetValueOnGameThread());
+		break;
+
+	case EPerfScenario::Inventories:
+		ScenarioFrameLimit = CVarPerfFrames.GetValueOnGameThread();
+		SpawnInventoryCharacters(CVarPerfInventoryCharacters.GetValueOnGameThread());
+		break;
+
+	case EPerfScenario::CombatDeterminism:
+		// Every frame rate is stepped within one frame
+		ScenarioFrameLimit = 1;
+		break;
+
+	case EPerfScenario::Deaths:
+		{
+			// Long enough for the kills and for every ragdoll to settle or time out after them
+			ScenarioFrameLimit = CVarPerfDeaths.GetValueOnGameThread() * 20 + 3000;
+
+			UShooterDeathManager* DeathManager = GetWorld()->GetSubsystem<UShooterDeathManager>();
+			if (DeathManager == nullptr)
+			{
+				CurrentResult.Failures.Add(TEXT("no death manager"));
+				break;
+			}
+			SpawnEnemyCrowd(CVarPerfDeaths.GetValueOnGameThread());
+			DeathManager->RunStressTest(CVarPerfDeaths.GetValueOnGameThread(), CVarPerfDeathDuration.GetValueOnGameThread());
+			if (!DeathManager->IsStressTestRunning())
+			{
+				CurrentResult.Failures.Add(TEXT("death stress test did not start"));
+			}
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	UE_LOG(LogShooter, Log, TEXT("Perf scenario %s started"), *CurrentResult.Name);
+}
+
+bool UShooterPerfSubsystem::StepScenario()
+{
+	AShooterCharacter* Character = GetLocalCharacter();
+	if (Character == nullptr || Character->GetEquippedWeapon() == nullptr) return true;
+
+	AWeapon* Weapon = Character->GetEquippedWeapon();
+
+	switch (CurrentScenario)
+	{
+	case EPerfScenario::Enemies:
+	case EPerfScenario::GroundItems:
+		return ScenarioFrame >= ScenarioFrameLimit;
+
+	case EPerfScenario::Traces:
+		BenchmarkTraces();
+		++CurrentResult.Actions;
+		return ScenarioFrame >= ScenarioFrameLimit;
+
+	case EPerfScenario::Inventories:
+		if (ScenarioFrame < ScenarioFrameLimit) return false;
+
+		// Counted at the end, once the significance manager has had time to put pooled weapons to sleep
+		for (TActorIterator<AWeapon> It(GetWorld()); It; ++It)
+		{
+			++CurrentResult.WeaponActors;
+			CurrentResult.TickingWeapons += It->IsActorTickEnabled() ? 1 : 0;
+		}
+		UE_LOG(LogShooter, Log, TEXT("Inventories: %d characters, %d weapon actors, %d ticking, %d pooled"),
+			CurrentResult.InventoryCharacters, CurrentResult.WeaponActors, CurrentResult.TickingWeapons,
+			GetWorld()->GetSubsystem<UShooterWeaponPool>() ? GetWorld()->GetSubsystem<UShooterWeaponPool>()->GetNumPooled() : 0);
+		return true;
+
+	case EPerfScenario::CombatDeterminism:
+		{
+			UShooterCombatClock* CombatClock = GetWorld()->GetSubsystem<UShooterCombatClock>();
+			if (CombatClock == nullptr)
+			{
+				CurrentResult.Failures.Add(TEXT("no combat clock"));
+				return true;
+			}
+			// The fight spawns its own fighters, out of the way above the player
+			UClass* FightWeaponClass = WeaponClass.LoadSynchronous();
+			UClass* FightEnemyClass = EnemyClass.LoadSynchronous();
+			TimeAction([CombatClock, Character, Weapon, FightWeaponClass, FightEnemyClass, this]()
+			{
+				CombatClock->CheckDeterminism(Character->GetClass(), FightWeaponClass ? FightWeaponClass : Weapon->GetClass(), FightEnemyClass,
+					Character->GetActorLocation() + FVector(0.f, 0.f, 5000.f), CurrentResult.Failures);
+			});
+			++CurrentResult.Actions;
+			return true;
+		}
+
+	case EPerfScenario::Deaths:
+		{
+			const UShooterDeathManager* DeathManager = GetWorld()->GetSubsystem<UShooterDeathManager>();
+			if (DeathManager == nullptr) return true;
+
+			// The ragdolls are what costs, physics time is sampled every frame until the last body is frozen
+			CurrentResult.PeakRagdolls = DeathManager->GetStressTestPeakRagdolls();
+			CurrentResult.Actions = CVarPerfDeaths.GetValueOnGameThread();
+			return !DeathManager->IsStressTestRunning();
+		}
+
+	case EPerfScenario::Explosion:
+		{
+			// A few frames apart, so every explosion's damage and death checks settle before the next
+			if (ScenarioFrame % 10 != 0) return false;
+			if (CurrentResult.Actions >= CVarPerfExplosions.GetValueOnGameThread()) return true;
+
+			// The crowd drifts towards the player, keep the explosion in the middle of it
+			FVector Center{ FVector::ZeroVector };
+			int32 NumEnemies{ 0 };
+			for (const AActor* Actor : SpawnedActors)
+			{
+				const AEnemy* Enemy = Cast<AEnemy>(Actor);
+				if (Enemy && !Enemy->IsDying())
+				{
+					Center += Enemy->GetActorLocation();
+					++NumEnemies;
+				}
+			}
+			if (NumEnemies == 0)
+			{
+				CurrentResult.Failures.Add(TEXT("no enemies left in the crowd"));
+				return true;
+			}
+			Center /= NumEnemies;
+
+			// Big enough to reach the whole crowd, so every explosion pays for all of it
+			FShooterExplosion Explosion;
+			Explosion.Damage = 1.f;
+			Explosion.MinDamageFraction = 1.f;
+			Explosion.InnerRadius = 0.f;
+			Explosion.Radius = 2500.f;
+
+			ShooterExplosion::FResult Result;
+			TimeAction([this, &Result, &Center, &Explosion]()
+			{
+				Result = ShooterExplosion::Explode(GetWorld(), Center, Explosion, nullptr, nullptr);
+			});
+			if (Result.Enemies < NumEnemies)
+			{
+				CurrentResult.Failures.Add(FString::Printf(TEXT("explosion reached %d of %d enemies"), Result.Enemies, NumEnemies));
+				return true;
+			}
+			++CurrentResult.Actions;
+			return false;
+		}
+
+	case EPerfScenario::FullAuto:
+		{
+			const int32 Ammo{ Weapon->GetAmmo() };
+			if (Ammo < LastWeaponAmmo)
+			{
+				CurrentResult.Actions += LastWeaponAmmo - Ammo;
+			}
+
+			// Top up before the last round, an empty magazine would start a reload and stop the stream of shots
+			if (Ammo <= 1)
+			{
+				Character->ScriptedRefillAmmo();
+			}
+			LastWeaponAmmo = Weapon->GetAmmo();
+			return CurrentResult.Actions >= CVarPerfShots.GetValueOnGameThread();
+		}
+
+	case EPerfScenario::PickupSwap:
+		{
+			if (Character->GetCombatState() != ECombatState::ECS_Unoccupied) return false;
+			if (CurrentResult.Actions >= CVarPerfSwapCycles.GetValueOnGameThread()) return true;
+
+			AWeapon* GroundWeapon{ nullptr };
+			for (AActor* Actor : SpawnedActors)
+			{
+				AWeapon* Candidate = Cast<AWeapon>(Actor);
+				if (Candidate && Candidate->GetItemState() == EItemState::EIS_Pickup)
+				{
+					GroundWeapon = Candidate;
+					break;
+				}
+			}
+
+			// Every third action picks up while there is something to pick up, a full inventory turns that into a swap and a drop
+			const TArray<FInventoryWeaponRecord>& Inventory = Character->GetInventory();
+			if (GroundWeapon && (CurrentResult.Actions % 3 == 0 || Inventory.Num() < 2))
+			{
+				TimeAction([Character, GroundWeapon]() { Character->GetPickupItem(GroundWeapon); });
+			}
+			else if (Inventory.Num() > 1)
+			{
+				const int32 NextSlot{ (Weapon->GetSlotIndex() + 1) % Inventory.Num() };
+				TimeAction([Character, NextSlot]() { Character->ScriptedSelectSlot(NextSlot); });
+			}
+			else
+			{
+				CurrentResult.Failures.Add(TEXT("nothing left to pick up or swap to"));
+				return true;
+			}
+			++CurrentResult.Actions;
+			return false;
+		}
+
+	case EPerfScenario::Reload:
+		{
+			if (Character->GetCombatState() != ECombatState::ECS_Unoccupied) return false;
+
+			// The previous reload only counts once the montage handed control back
+			if (bWaitingForCombatState)
+			{
+				bWaitingForCombatState = false;
+				++CurrentResult.Actions;
+			}
+			if (CurrentResult.Actions >= CVarPerfReloadCycles.GetValueOnGameThread()) return true;
+
+			Character->ScriptedRefillAmmo();
+			Weapon->SetAmmo(0);
+			TimeAction([Character]() { Character->ScriptedReload(); });
+			bWaitingForCombatState = Character->GetCombatState() == ECombatState::ECS_Reloading;
+			if (!bWaitingForCombatState)
+			{
+				CurrentResult.Failures.Add(TEXT("reload did not start"));
+				return true;
+			}
+			return false;
+		}
+
+	default:
+		break;
+	}
+	return true;
+}
+
+void UShooterPerfSubsystem::EndScenario()
+{
+	AShooterCharacter* Character = GetLocalCharacter();
+	if (Character)
+	{
+		Character->ScriptedFire(false);
+	}
+
+	// Weapons that were picked up belong to the character or the weapon pool now
+	for (AActor* Actor : SpawnedActors)
+	{
+		if (Actor == nullptr || Actor->IsPendingKill()) continue;
+
+		AItem* Item = Cast<AItem>(Actor);
+		if (Item && (Item->GetItemState() == EItemState::EIS_PickedUp || (Character && Character->GetEquippedWeapon() == Item))) continue;
+
+		// Extra characters take the weapon in their hands with them
+		AShooterCharacter* SpawnedCharacter = Cast<AShooterCharacter>(Actor);
+		if (SpawnedCharacter && SpawnedCharacter->GetEquippedWeapon())
+		{
+			SpawnedCharacter->GetEquippedWeapon()->Destroy();
+		}
+
+		Actor->Destroy();
+	}
+	SpawnedActors.Reset();
+
+	CurrentResult.MemoryEndMB = FPlatformMemory::GetStats().UsedPhysical / (1024.0 * 1024.0);
+	CurrentResult.ObjectsEnd = GUObjectArray.GetObjectArrayNumMinusAvailable();
+
+	CheckThresholds(CurrentResult);
+
+	UE_LOG(LogShooter, Log, TEXT("Perf scenario %s: %d frames, %d actions, memory %+.1f MB, objects %+d%s"),
+		*CurrentResult.Name, CurrentResult.Frames, CurrentResult.Actions,
+		CurrentResult.MemoryEndMB - CurrentResult.MemoryStartMB, CurrentResult.ObjectsEnd - CurrentResult.ObjectsStart,
+		CurrentResult.Failures.Num() > 0 ? TEXT(", FAILED") : TEXT(""));
+	UE_LOG(LogShooter, Log, TEXT("Game thread ms: %s"), *CurrentResult.GameThreadMs.ToString());
+	UE_LOG(LogShooter, Log, TEXT("Action ms: %s"), *CurrentResult.ActionMs.ToString());
+	UE_LOG(LogShooter, Log, TEXT("Physics ms: %s"), *CurrentResult.PhysicsMs.ToString());
+	for (const FPerfScenarioResult::FChannelTraces& Traces : CurrentResult.ChannelTraces)
+	{
+		UE_LOG(LogShooter, Log, TEXT("%s trace us: %s, %d hits"), *Traces.Channel, *Traces.TraceUs.ToString(), Traces.Hits);
+	}
+	for (const FString& Failure : CurrentResult.Failures)
+	{
+		UE_LOG(LogShooter, Warning, TEXT("Perf scenario %s: %s"), *CurrentResult.Name, *Failure);
+	}
+
+	Results.Add(MoveTemp(CurrentResult));
+	CurrentResult = FPerfScenarioResult();
+}
+
+void UShooterPerfSubsystem::FinishScenarios()
+{
+	Mode = EPerfMode::None;
+	SetPhysicsTimerEnabled(false);
+
+	CheckLLMBudgets();
+
+	bool bPassed{ LLMFailures.Num() == 0 };
+	for (const FPerfScenarioResult& Result : Results)
+	{
+		bPassed &= Result.Failures.Num() == 0;
+	}
+
+	const FString ReportPath{ WriteReport(bPassed) };
+	UE_LOG(LogShooter, Log, TEXT("Perf scenarios %s, report written to %s"), bPassed ? TEXT("passed") : TEXT("FAILED"), *ReportPath);
+
+	if (bExitWhenDone)
+	{
+		FPlatformMisc::RequestExitWithStatus(false, bPassed ? 0 : 1);
+	}
+}
+
+void UShooterPerfSubsystem::SpawnEnemies(int32 Count)
+{
+	UClass* Class = EnemyClass.LoadSynchronous();
+	const AShooterCharacter* Character = GetLocalCharacter();
+	if (Class == nullptr || Character == nullptr)
+	{
+		CurrentResult.Failures.Add(TEXT("EnemyClass is not set"));
+		return;
+	}
+
+	SHOOTER_LLM_SCOPE(Enemies);
+
+	// A ring out of melee range, so the scenario measures chasing and AI rather than the player dying
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+	for (int32 i = 0; i < Count; ++i)
+	{
+		const float Angle{ 2.f * PI * i / FMath::Max(Count, 1) };
+		const float Radius{ 2000.f + 500.f * (i % 4) };
+		const FVector Location{ Character->GetActorLocation() + FVector(FMath::Cos(Angle) * Radius, FMath::Sin(Angle) * Radius, 0.f) };
+		AEnemy* Enemy = GetWorld()->SpawnActor<AEnemy>(Class, Location, FRotator::ZeroRotator, SpawnParams);
+		if (Enemy)
+		{
+			SpawnedActors.Add(Enemy);
+		}
+	}
+}
+
+void UShooterPerfSubsystem::SpawnEnemyCrowd(int32 Count)
+{
+	UClass* Class = EnemyClass.LoadSynchronous();
+	const AShooterCharacter* Character = GetLocalCharacter();
+	if (Class == nullptr || Character == nullptr)
+	{
+		CurrentResult.Failures.Add(TEXT("EnemyClass is not set"));
+		return;
+	}
+
+	SHOOTER_LLM_SCOPE(Enemies);
+
+	// Shoulder to shoulder, far enough ahead that the crowd is still in one piece when the last explosion goes off
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+	const float Spacing{ 100.f };
+	const int32 GridSize{ FMath::CeilToInt(FMath::Sqrt(static_cast<float>(Count))) };
+	const FVector Forward{ Character->GetActorForwardVector().GetSafeNormal2D() };
+	const FVector Center{ Character->GetActorLocation() + Forward * 3000.f };
+	const FVector Origin{ Center - FVector(GridSize * Spacing * 0.5f, GridSize * Spacing * 0.5f, 0.f) };
+	for (int32 i = 0; i < Count; ++i)
+	{
+		const FVector Location{ Origin + FVector((i % GridSize) * Spacing, (i / GridSize) * Spacing, 0.f) };
+		AEnemy* Enemy = GetWorld()->SpawnActor<AEnemy>(Class, Location, FRotator::ZeroRotator, SpawnParams);
+		if (Enemy)
+		{
+			SpawnedActors.Add(Enemy);
+		}
+	}
+}
+
+void UShooterPerfSubsystem::SpawnGroundWeapons(int32 Count, float Spacing)
+{
+	UClass* Class = WeaponClass.LoadSynchronous();
+	const AShooterCharacter* Character = GetLocalCharacter();
+	if (Class == nullptr || Character == nullptr)
+	{
+		CurrentResult.Failures.Add(TEXT("WeaponClass is not set"));
+		return;
+	}
+
+	SHOOTER_LLM_SCOPE(Items);
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	const int32 GridSize{ FMath::CeilToInt(FMath::Sqrt(static_cast<float>(Count))) };
+	const FVector Origin{ Character->GetActorLocation() - FVector(GridSize * Spacing * 0.5f, GridSize * Spacing * 0.5f, 0.f) };
+	for (int32 i = 0; i < Count; ++i)
+	{
+		const FVector Location{ Origin + FVector((i % GridSize) * Spacing, (i / GridSize) * Spacing, 0.f) };
+		AWeapon* Weapon = GetWorld()->SpawnActor<AWeapon>(Class, Location, FRotator::ZeroRotator, SpawnParams);
+		if (Weapon)
+		{
+			SpawnedActors.Add(Weapon);
+		}
+	}
+}
+
+void UShooterPerfSubsystem::SpawnInventoryCharacters(int32 Count)
+{
+	UClass* Class = WeaponClass.LoadSynchronous();
+	const AShooterCharacter* Character = GetLocalCharacter();
+	if (Class == nullptr || Character == nullptr)
+	{
+		CurrentResult.Failures.Add(TEXT("WeaponClass is not set"));
+		return;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+	for (int32 i = 0; i < Count; ++i)
+	{
+		// A ring around the player, unpossessed so they just stand there holding their default weapon
+		const float Angle{ 2.f * PI * i / FMath::Max(Count, 1) };
+		const FVector Location{ Character->GetActorLocation() + FVector(FMath::Cos(Angle) * 1500.f, FMath::Sin(Angle) * 1500.f, 0.f) };
+		AShooterCharacter* InventoryCharacter = GetWorld()->SpawnActor<AShooterCharacter>(Character->GetClass(), Location, FRotator::ZeroRotator, SpawnParams);
+		if (InventoryCharacter == nullptr) continue;
+
+		SpawnedActors.Add(InventoryCharacter);
+		++CurrentResult.InventoryCharacters;
+
+		// Picked up straight away, no pickup curve, until every slot is taken
+		SHOOTER_LLM_SCOPE(Items);
+		while (InventoryCharacter->GetInventory().Num() < InventoryCharacter->GetInventoryCapacity())
+		{
+			AWeapon* Weapon = GetWorld()->SpawnActor<AWeapon>(Class, Location, FRotator::ZeroRotator);
+			if (Weapon == nullptr) break;
+
+			SpawnedActors.Add(Weapon);
+			TimeAction([InventoryCharacter, Weapon]() { InventoryCharacter->GetPickupItem(Weapon); });
+			++CurrentResult.Actions;
+		}
+	}
+}
+
+void UShooterPerfSubsystem::BenchmarkTraces()
+{
+	const AShooterCharacter* Character = GetLocalCharacter();
+	if (Character == nullptr) return;
+
+	constexpr int32 NumChannels{ 3 };
+	static const ECollisionChannel Channels[NumChannels]{ ECC_Visibility, ECC_Weapon, ECC_Interact };
+	check(CurrentResult.ChannelTraces.Num() == NumChannels);
+
+	// Same length as the crosshair traces. The fan turns a little each frame and dips towards the floor,
+	// so it sweeps through the enemy ring and across the weapons on the ground
+	const int32 NumRays{ FMath::Max(CVarPerfTracesPerFrame.GetValueOnGameThread(), 1) };
+	const FVector Start{ Character->GetPawnViewLocation() };
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(PerfTraceBenchmark), false, Character);
+
+	uint32 GameplayCycles{ 0 };
+	for (int32 ChannelIndex = 0; ChannelIndex < NumChannels; ++ChannelIndex)
+	{
+		FPerfScenarioResult::FChannelTraces& Traces = CurrentResult.ChannelTraces[ChannelIndex];
+		for (int32 i = 0; i < NumRays; ++i)
+		{
+			const FRotator Direction{ -2.f - 18.f * (i % 8) / 7.f, 360.f * i / NumRays + ScenarioFrame, 0.f };
+			const FVector End{ Start + Direction.Vector() * 50'000.f };
+
+			FHitResult HitResult;
+			const uint32 StartCycles{ FPlatformTime::Cycles() };
+			GetWorld()->LineTraceSingleByChannel(HitResult, Start, End, Channels[ChannelIndex], QueryParams);
+			const uint32 TraceCycles{ FPlatformTime::Cycles() - StartCycles };
+
+			Traces.TraceUs.AddSample(static_cast<float>(FPlatformTime::ToMilliseconds(TraceCycles) * 1000.0));
+			Traces.Hits += HitResult.bBlockingHit ? 1 : 0;
+			if (Channels[ChannelIndex] != ECC_Visibility)
+			{
+				GameplayCycles += TraceCycles;
+			}
+		}
+	}
+
+	// The action is what the game now casts: one fan on each project channel
+	CurrentResult.ActionMs.AddSample(FPlatformTime::ToMilliseconds(GameplayCycles));
+}
+
+void UShooterPerfSubsystem::TimeAction(TFunctionRef<void()> Action)
+{
+	const uint32 StartCycles{ FPlatformTime::Cycles() };
+	Action();
+	CurrentResult.ActionMs.AddSample(FPlatformTime::ToMilliseconds(FPlatformTime::Cycles() - StartCycles));
+}
+
+void UShooterPerfSubsystem::SetPhysicsTimerEnabled(bool bEnabled)
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr || World->PersistentLevel == nullptr) return;
+
+	if (bEnabled && !PhysicsStartTick.IsTickFunctionRegistered())
+	{
+		PhysicsStartTick.Owner = this;
+		PhysicsStartTick.bStart = true;
+		PhysicsStartTick.bCanEverTick = true;
+		PhysicsStartTick.TickGroup = TG_StartPhysics;
+		PhysicsStartTick.RegisterTickFunction(World->PersistentLevel);
+
+		// The world waits for us before it kicks off the simulation
+		World->StartPhysicsTickFunction.AddPrerequisite(this, PhysicsStartTick);
+
+		PhysicsEndTick.Owner = this;
+		PhysicsEndTick.bStart = false;
+		PhysicsEndTick.bCanEverTick = true;
+		PhysicsEndTick.TickGroup = TG_EndPhysics;
+		PhysicsEndTick.RegisterTickFunction(World->PersistentLevel);
+
+		// And we wait for the simulation's results to be fetched
+		PhysicsEndTick.AddPrerequisite(World, World->EndPhysicsTickFunction);
+	}
+	else if (!bEnabled && PhysicsStartTick.IsTickFunctionRegistered())
+	{
+		World->StartPhysicsTickFunction.RemovePrerequisite(this, PhysicsStartTick);
+		PhysicsStartTick.UnRegisterTickFunction();
+
+		PhysicsEndTick.RemovePrerequisite(World, World->EndPhysicsTickFunction);
+		PhysicsEndTick.UnRegisterTickFunction();
+	}
+}
+
+void UShooterPerfSubsystem::OnPhysicsPhaseTick(bool bStart)
+{
+	const uint32 Cycles{ FPlatformTime::Cycles() };
+	if (bStart)
+	{
+		PhysicsStartCycles = Cycles;
+	}
+	else if (PhysicsStartCycles != 0 && Mode == EPerfMode::Running)
+	{
+		// Includes DuringPhysics ticks run while the simulation is in flight, the same span the physics stats cover
+		CurrentResult.PhysicsMs.AddSample(FPlatformTime::ToMilliseconds(Cycles - PhysicsStartCycles));
+		PhysicsStartCycles = 0;
+	}
+}
+
+void FShooterPhysicsPhaseTick::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Owner)
+	{
+		Owner->OnPhysicsPhaseTick(bStart);
+	}
+}
+
+FString FShooterPhysicsPhaseTick::DiagnosticMessage()
+{
+	return bStart ? TEXT("FShooterPhysicsPhaseTick[Start]") : TEXT("FShooterPhysicsPhaseTick[End]");
+}
+
+void UShooterPerfSubsystem::CheckLLMBudgets()
+{
+	LLMFailures.Reset();
+	LLMAmountsMB.Reset();
+
+#if ENABLE_LOW_LEVEL_MEM_TRACKER
+	if (!FLowLevelMemTracker::IsEnabled())
+	{
+		if (LLMBudgets.Num() > 0)
+		{
+			UE_LOG(LogShooter, Log, TEXT("LLM budgets not checked, run with -llm"));
+		}
+		return;
+	}
+
+	for (uint8 Tag = static_cast<uint8>(EShooterLLMTag::Weapons); Tag < static_cast<uint8>(EShooterLLMTag::End); ++Tag)
+	{
+		const FString TagName{ ShooterLLM::GetTagName(static_cast<EShooterLLMTag>(Tag)) };
+		const double AmountMB{ ShooterLLM::GetTagAmount(static_cast<EShooterLLMTag>(Tag)) / (1024.0 * 1024.0) };
+		LLMAmountsMB.Add(TagName, AmountMB);
+
+		const FShooterLLMBudget* Budget = LLMBudgets.FindByPredicate([&TagName](const FShooterLLMBudget& Entry)
+		{
+			return Entry.Tag == TagName;
+		});
+		if (Budget && Budget->MaxMB > 0.f && AmountMB > Budget->MaxMB)
+		{
+			LLMFailures.Add(FString::Printf(TEXT("%s at %.1f MB, budget %.1f MB"), *TagName, AmountMB, Budget->MaxMB));
+		}
+		UE_LOG(LogShooter, Log, TEXT("LLM %s: %.1f MB"), *TagName, AmountMB);
+	}
+
+	for (const FString& Failure : LLMFailures)
+	{
+		UE_LOG(LogShooter, Warning, TEXT("LLM budget: %s"), *Failure);
+	}
+#endif
+}
+
+void UShooterPerfSubsystem::CheckThresholds(FPerfScenarioResult& Result) const
+{
+	const FShooterPerfThreshold* Threshold = Thresholds.FindByPredicate([&Result](const FShooterPerfThreshold& Entry)
+	{
+		return Entry.Scenario == Result.Name;
+	});
+	if (Threshold == nullptr) return;
+
+	const float GameThreadP95{ Result.GameThreadMs.GetPercentile(95.f) };
+	if (Threshold->MaxGameThreadP95Ms > 0.f && GameThreadP95 > Threshold->MaxGameThreadP95Ms)
+	{
+		Result.Failures.Add(FString::Printf(TEXT("game thread p95 %.2f ms over %.2f ms"), GameThreadP95, Threshold->MaxGameThreadP95Ms));
+	}
+
+	const float ActionP95{ Result.ActionMs.GetPercentile(95.f) };
+	if (Threshold->MaxActionP95Ms > 0.f && ActionP95 > Threshold->MaxActionP95Ms)
+	{
+		Result.Failures.Add(FString::Printf(TEXT("action p95 %.3f ms over %.3f ms"), ActionP95, Threshold->MaxActionP95Ms));
+	}
+
+	const float PhysicsP95{ Result.PhysicsMs.GetPercentile(95.f) };
+	if (Threshold->MaxPhysicsP95Ms > 0.f && PhysicsP95 > Threshold->MaxPhysicsP95Ms)
+	{
+		Result.Failures.Add(FString::Printf(TEXT("physics p95 %.2f ms over %.2f ms"), PhysicsP95, Threshold->MaxPhysicsP95Ms));
+	}
+
+	const double MemoryGrowthMB{ Result.MemoryEndMB - Result.MemoryStartMB };
+	if (Threshold->MaxMemoryGrowthMB > 0.f && MemoryGrowthMB > Threshold->MaxMemoryGrowthMB)
+	{
+		Result.Failures.Add(FString::Printf(TEXT("memory grew %.1f MB, limit %.1f MB"), MemoryGrowthMB, Threshold->MaxMemoryGrowthMB));
+	}
+
+	const int32 ObjectGrowth{ Result.ObjectsEnd - Result.ObjectsStart };
+	if (Threshold->MaxObjectGrowth > 0 && ObjectGrowth > Threshold->MaxObjectGrowth)
+	{
+		Result.Failures.Add(FString::Printf(TEXT("%d objects left behind, limit %d"), ObjectGrowth, Threshold->MaxObjectGrowth));
+	}
+}
+
+TSharedRef<FJsonObject> UShooterPerfSubsystem::ToJson(const FPerfScenarioResult& Result) const
+{
+	auto SamplerToJson = [](const FPercentileSampler& Sampler)
+	{
+		TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+		Json->SetNumberField(TEXT("samples"), static_cast<double>(Sampler.GetTotalSamples()));
+		Json->SetNumberField(TEXT("avg"), Sampler.GetAverage());
+		Json->SetNumberField(TEXT("p50"), Sampler.GetPercentile(50.f));
+		Json->SetNumberField(TEXT("p95"), Sampler.GetPercentile(95.f));
+		Json->SetNumberField(TEXT("p99"), Sampler.GetPercentile(99.f));
+		Json->SetNumberField(TEXT("max"), Sampler.GetMax());
+		return Json;
+	};
+
+	TSharedRef<FJsonObject> Json = MakeShared<FJsonObject>();
+	Json->SetStringField(TEXT("name"), Result.Name);
+	Json->SetBoolField(TEXT("passed"), Result.Failures.Num() == 0);
+	Json->SetNumberField(TEXT("frames"), Result.Frames);
+	Json->SetNumberField(TEXT("actions"), Result.Actions);
+	Json->SetObjectField(TEXT("gameThreadMs"), SamplerToJson(Result.GameThreadMs));
+	Json->SetObjectField(TEXT("frameMs"), SamplerToJson(Result.FrameMs));
+	Json->SetObjectField(TEXT("actionMs"), SamplerToJson(Result.ActionMs));
+	Json->SetObjectField(TEXT("physicsMs"), SamplerToJson(Result.PhysicsMs));
+	Json->SetNumberField(TEXT("memoryStartMB"), Result.MemoryStartMB);
+	Json->SetNumberField(TEXT("memoryEndMB"), Result.MemoryEndMB);
+	Json->SetNumberField(TEXT("memoryGrowthMB"), Result.MemoryEndMB - Result.MemoryStartMB);
+	Json->SetNumberField(TEXT("peakMemoryMB"), Result.PeakMemoryMB);
+	Json->SetNumberField(TEXT("objectGrowth"), Result.ObjectsEnd - Result.ObjectsStart);
+
+	const FShooterPerfThreshold* Threshold = Thresholds.FindByPredicate([&Result](const FShooterPerfThreshold& Entry)
+	{
+		return Entry.Scenario == Result.Name;
+	});
+	if (Threshold)
+	{
+		TSharedRef<FJsonObject> ThresholdJson = MakeShared<FJsonObject>();
+		ThresholdJson->SetNumberField(TEXT("maxGameThreadP95Ms"), Threshold->MaxGameThreadP95Ms);
+		ThresholdJson->SetNumberField(TEXT("maxActionP95Ms"), Threshold->MaxActionP95Ms);
+		ThresholdJson->SetNumberField(TEXT("maxPhysicsP95Ms"), Threshold->MaxPhysicsP95Ms);
+		ThresholdJson->SetNumberField(TEXT("maxMemoryGrowthMB"), Threshold->MaxMemoryGrowthMB);
+		ThresholdJson->SetNumberField(TEXT("maxObjectGrowth"), Threshold->MaxObjectGrowth);
+		Json->SetObjectField(TEXT("thresholds"), ThresholdJson);
+	}
+
+	TArray<TSharedPtr<FJsonValue>> Failures;
+	for (const FString& Failure : Result.Failures)
+	{
+		Failures.Add(MakeShared<FJsonValueString>(Failure));
+	}
+	Json->SetArrayField(TEXT("failures"), Failures);
+
+	if (Result.InventoryCharacters > 0)
+	{
+		Json->SetNumberField(TEXT("inventoryCharacters"), Result.InventoryCharacters);
+		Json->SetNumberField(TEXT("weaponActors"), Result.WeaponActors);
+		Json->SetNumberField(TEXT("tickingWeapons"), Result.TickingWeapons);
+	}
+
+	if (Result.PeakRagdolls > 0)
+	{
+		Json->SetNumberField(TEXT("peakRagdolls"), Result.PeakRagdolls);
+	}
+
+	if (Result.ChannelTraces.Num() > 0)
+	{
+		TArray<TSharedPtr<FJsonValue>> Channels;
+		for (const FPerfScenarioResult::FChannelTraces& Traces : Result.ChannelTraces)
+		{
+			TSharedRef<FJsonObject> ChannelJson = MakeShared<FJsonObject>();
+			ChannelJson->SetStringField(TEXT("channel"), Traces.Channel);
+			ChannelJson->SetObjectField(TEXT("traceUs"), SamplerToJson(Traces.TraceUs));
+			ChannelJson->SetNumberField(TEXT("hits"), Traces.Hits);
+			Channels.Add(MakeShared<FJsonValueObject>(ChannelJson));
+		}
+		Json->SetArrayField(TEXT("traces"), Channels);
+	}
+
+	return Json;
+}
+
+FString UShooterPerfSubsystem::WriteReport(bool bPassed) const
+{
+	TSharedRef<FJsonObject> Report = MakeShared<FJsonObject>();
+	Report->SetStringField(TEXT("map"), GetWorld()->GetMapName());
+	Report->SetStringField(TEXT("time"), FDateTime::UtcNow().ToIso8601());
+	Report->SetBoolField(TEXT("passed"), bPassed);
+
+	TArray<TSharedPtr<FJsonValue>> Scenarios;
+	for (const FPerfScenarioResult& Result : Results)
+	{
+		Scenarios.Add(MakeShared<FJsonValueObject>(ToJson(Result)));
+	}
+	Report->SetArrayField(TEXT("scenarios"), Scenarios);
+
+	// Only filled in -llm runs
+	TArray<TSharedPtr<FJsonValue>> LLMTags;
+	for (const TPair<FString, double>& Amount : LLMAmountsMB)
+	{
+		TSharedRef<FJsonObject> TagJson = MakeShared<FJsonObject>();
+		TagJson->SetStringField(TEXT("tag"), Amount.Key);
+		TagJson->SetNumberField(TEXT("mb"), Amount.Value);
+
+		const FShooterLLMBudget* Budget = LLMBudgets.FindByPredicate([&Amount](const FShooterLLMBudget& Entry)
+		{
+			return Entry.Tag == Amount.Key;
+		});
+		if (Budget)
+		{
+			TagJson->SetNumberField(TEXT("budgetMB"), Budget->MaxMB);
+		}
+		LLMTags.Add(MakeShared<FJsonValueObject>(TagJson));
+	}
+	Report->SetArrayField(TEXT("llm"), LLMTags);
+
+	TArray<TSharedPtr<FJsonValue>> LLMFailureValues;
+	for (const FString& Failure : LLMFailures)
+	{
+		LLMFailureValues.Add(MakeShared<FJsonValueString>(Failure));
+	}
+	Report->SetArrayField(TEXT("llmFailures"), LLMFailureValues);
+
+	// -ShooterPerfReport=Path puts the report where CI expects it
+	FString ReportPath;
+	if (!FParse::Value(FCommandLine::Get(), TEXT("ShooterPerfReport="), ReportPath))
+	{
+		ReportPath = FPaths::ProjectSavedDir() / TEXT("Perf") / FString::Printf(TEXT("ShooterPerf-%s.json"), *FDateTime::Now().ToString());
+	}
+
+	WriteJsonReport(Report, ReportPath);
+	return ReportPath;
+}
@@ -0,0 +1,263 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShooterTickableWorldSubsystem.h"
+#include "Engine/EngineBaseTypes.h"
+#include "PercentileSampler.h"
+#include "ShooterPerfSubsystem.generated.h"
+
+class AActor;
+class AEnemy;
+class AWeapon;
+class AShooterCharacter;
+class FJsonObject;
+class UShooterPerfSubsystem;
+
+/* Limits for one scenario, from DefaultGame.ini. A limit of 0 is not checked */
+USTRUCT()
+struct FShooterPerfThreshold
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FString Scenario;
+
+	UPROPERTY()
+	float MaxGameThreadP95Ms = 0.f;
+
+	/* Cost of the scripted call itself: pickup, slot exchange or reload start */
+	UPROPERTY()
+	float MaxActionP95Ms = 0.f;
+
+	/* Physics phase of the frame, from kicking off the simulation to having its results */
+	UPROPERTY()
+	float MaxPhysicsP95Ms = 0.f;
+
+	UPROPERTY()
+	float MaxMemoryGrowthMB = 0.f;
+
+	UPROPERTY()
+	int32 MaxObjectGrowth = 0;
+};
+
+/* Most memory a Shooter LLM tag may hold at the end of the scenarios, checked in -llm runs */
+USTRUCT()
+struct FShooterLLMBudget
+{
+	GENERATED_BODY()
+
+	/* Tag name as registered, e.g. ShooterWeapons */
+	UPROPERTY()
+	FString Tag;
+
+	UPROPERTY()
+	float MaxMB = 0.f;
+};
+
+/* Measurements of one scenario run */
+struct FPerfScenarioResult
+{
+	FString Name;
+
+	int32 Frames = 0;
+
+	/* Shots fired, items picked up or swapped, reloads finished */
+	int32 Actions = 0;
+
+	FPercentileSampler GameThreadMs{ 16384 };
+	FPercentileSampler FrameMs{ 16384 };
+	FPercentileSampler ActionMs{ 4096 };
+	FPercentileSampler PhysicsMs{ 16384 };
+
+	double MemoryStartMB = 0.0;
+	double MemoryEndMB = 0.0;
+	double PeakMemoryMB = 0.0;
+
+	int32 ObjectsStart = 0;
+	int32 ObjectsEnd = 0;
+
+	/* Cost of a single trace per channel, filled by the Traces scenario */
+	struct FChannelTraces
+	{
+		FString Channel;
+		FPercentileSampler TraceUs{ 16384 };
+		int32 Hits = 0;
+	};
+	TArray<FChannelTraces> ChannelTraces;
+
+	/* Filled by the Inventories scenario: characters with a full inventory, the weapon actors alive
+	 * at its end, theirs and the player's, and how many of those still tick */
+	int32 InventoryCharacters = 0;
+	int32 WeaponActors = 0;
+	int32 TickingWeapons = 0;
+
+	/* Filled by the Deaths scenario */
+	int32 PeakRagdolls = 0;
+
+	TArray<FString> Failures;
+};
+
+/* Runs on either side of the world's physics tick functions so the perf subsystem can time the physics phase */
+struct FShooterPhysicsPhaseTick : public FTickFunction
+{
+	UShooterPerfSubsystem* Owner = nullptr;
+
+	/* True for the tick before the simulation starts, false for the one after its results are fetched */
+	bool bStart = false;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+/**
+ * Scripted performance scenarios for the character, items and enemies, meant to run headless:
+ * -game -nullrhi -unattended -ShooterPerf on a gameplay map. Each scenario records game thread time,
+ * memory and UObject growth, checks them against the thresholds in DefaultGame.ini and writes a JSON
+ * report to Saved/Perf. Started from the command line the process exits with 1 when a threshold is exceeded.
+ */
+UCLASS(Config = Game)
+class SHOOTER_API UShooterPerfSubsystem : public UShooterTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/* FTickableGameObject interface */
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/* Runs every scenario once the local player has a pawn */
+	void StartScenarios();
+
+	FORCEINLINE bool IsRunning() const { return Mode != EPerfMode::None; }
+
+private:
+
+	enum class EPerfMode : uint8
+	{
+		None,
+		Pending,
+		Running
+	};
+
+	enum class EPerfScenario : uint8
+	{
+		Enemies,
+		GroundItems,
+		FullAuto,
+		PickupSwap,
+		Reload,
+		Traces,
+		Explosion,
+		Inventories,
+		CombatDeterminism,
+		Deaths,
+
+		MAX
+	};
+
+	static const TCHAR* GetScenarioName(EPerfScenario Scenario);
+
+	void BeginScenario(EPerfScenario Scenario);
+
+	/* Drives the current scenario for a frame, returns true once it is done */
+	bool StepScenario();
+
+	void EndScenario();
+
+	void FinishScenarios();
+
+	/* Spawns Count enemies on a ring around the character, out of melee range */
+	void SpawnEnemies(int32 Count);
+
+	/* Spawns Count enemies packed on a grid in front of the character */
+	void SpawnEnemyCrowd(int32 Count);
+
+	/* Spawns Count characters of the player's class around the character and fills their inventories */
+	void SpawnInventoryCharacters(int32 Count);
+
+	/* Spawns Count weapons on a grid around the character */
+	void SpawnGroundWeapons(int32 Count, float Spacing);
+
+	/* Casts a fan of rays around the character on each benchmarked channel and records their cost */
+	void BenchmarkTraces();
+
+	/* Runs Action and adds its cost to the current result */
+	void TimeAction(TFunctionRef<void()> Action);
+
+	/* Hooks the physics phase ticks around the world's own physics ticks, or takes them out again */
+	void SetPhysicsTimerEnabled(bool bEnabled);
+
+	/* Called by the physics phase ticks */
+	void OnPhysicsPhaseTick(bool bStart);
+	friend struct FShooterPhysicsPhaseTick;
+
+	void CheckThresholds(FPerfScenarioResult& Result) const;
+
+	/* Compares each Shooter LLM tag against LLMBudgets, fills LLMAmountsMB and LLMFailures */
+	void CheckLLMBudgets();
+
+	TSharedRef<FJsonObject> ToJson(const FPerfScenarioResult& Result) const;
+
+	/* Writes the report, returns the path written to */
+	FString WriteReport(bool bPassed) const;
+
+	/* Enemy spawned by the Enemies, Traces and Explosion scenarios */
+	UPROPERTY(Config)
+	TSoftClassPtr<AEnemy> EnemyClass;
+
+	/* Weapon scattered on the ground by the item and Traces scenarios, and carried by the Inventories characters */
+	UPROPERTY(Config)
+	TSoftClassPtr<AWeapon> WeaponClass;
+
+	UPROPERTY(Config)
+	TArray<FShooterPerfThreshold> Thresholds;
+
+	UPROPERTY(Config)
+	TArray<FShooterLLMBudget> LLMBudgets;
+
+	/* Actors spawned by the current scenario, destroyed when it ends */
+	UPROPERTY()
+	TArray<AActor*> SpawnedActors;
+
+	EPerfMode Mode = EPerfMode::None;
+
+	EPerfScenario CurrentScenario = EPerfScenario::Enemies;
+
+	FPerfScenarioResult CurrentResult;
+
+	TArray<FPerfScenarioResult> Results;
+
+	/* Memory per Shooter LLM tag after the last scenario, empty unless run with -llm */
+	TMap<FString, double> LLMAmountsMB;
+
+	TArray<FString> LLMFailures;
+
+	/* Frames since the current scenario began */
+	int32 ScenarioFrame = 0;
+
+	/* Frames the current scenario may take before it counts as stalled */
+	int32 ScenarioFrameLimit = 0;
+
+	/* Magazine ammo last frame, shots are counted from the difference */
+	int32 LastWeaponAmmo = 0;
+
+	/* Set while a swap or reload montage plays, the next action waits for it */
+	bool bWaitingForCombatState = false;
+
+	FShooterPhysicsPhaseTick PhysicsStartTick;
+	FShooterPhysicsPhaseTick PhysicsEndTick;
+
+	/* Cycles when this frame's physics phase started, 0 outside of it */
+	uint32 PhysicsStartCycles = 0;
+
+	/* Quit with the result as exit code, for runs started from the command line */
+	bool bExitWhenDone = false;
+
+	double LastFrameTime = 0.0;
+};
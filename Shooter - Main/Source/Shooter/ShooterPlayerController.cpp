@@ -3,11 +3,24 @@
 
 #include "ShooterPlayerController.h"
 #include "Blueprint/UserWidget.h"
+#include "ShooterHUDOverlay.h"
+#include "ShooterHUD.h"
+#include "ShooterReplaySubsystem.h"
+#include "ShooterLLM.h"
 
-AShooterPlayerController::AShooterPlayerController()
+AShooterPlayerController::AShooterPlayerController() :
+	bUseNativeCrosshairs(true)
 {
 	
 }
+
+void AShooterPlayerController::ClientSetHUD_Implementation(TSubclassOf<AHUD> NewHUDClass)
+{
+	GameModeHUDClass = NewHUDClass;
+
+	// The game mode's HUD Blueprint draws crosshairs too, only one of the two is spawned
+	Super::ClientSetHUD_Implementation(bUseNativeCrosshairs ? TSubclassOf<AHUD>(AShooterHUD::StaticClass()) : NewHUDClass);
+}
 void AShooterPlayerController::BeginPlay()
 {
 	Super::BeginPlay();
@@ -15,11 +28,63 @@ void AShooterPlayerController::BeginPlay()
 	// Check our HUDOverlayClass TSubclassOf variable
 	if (HUDOverlayClass)
 	{
+		SHOOTER_LLM_SCOPE(HUD);
 		HUDOverlay = CreateWidget<UUserWidget>(this, HUDOverlayClass);
 		if (HUDOverlay)
 		{
 			HUDOverlay->AddToViewport();
 			HUDOverlay->SetVisibility(ESlateVisibility::Visible);
+
+			// Native overlays are event driven and need to know whose events to listen to
+			UShooterHUDOverlay* ShooterHUDOverlay = Cast<UShooterHUDOverlay>(HUDOverlay);
+			if (ShooterHUDOverlay)
+			{
+				ShooterHUDOverlay->SetShooterCharacter(Cast<AShooterCharacter>(GetPawn()));
+			}
 		}
 	}
-}
\ No newline at end of file
+}
+
+void AShooterPlayerController::OnPossess(APawn* InPawn)
+{
+	Super::OnPossess(InPawn);
+
+	UShooterHUDOverlay* ShooterHUDOverlay = Cast<UShooterHUDOverlay>(HUDOverlay);
+	if (ShooterHUDOverlay)
+	{
+		ShooterHUDOverlay->SetShooterCharacter(Cast<AShooterCharacter>(InPawn));
+	}
+}
+
+bool AShooterPlayerController::InputKey(FKey Key, EInputEvent EventType, float AmountDepressed, bool bGamepad)
+{
+	UShooterReplaySubsystem* Replay = GetWorld()->GetSubsystem<UShooterReplaySubsystem>();
+	if (Replay && !Replay->HandleInputKey(this, Key, EventType, AmountDepressed, bGamepad))
+	{
+		return true;
+	}
+	return Super::InputKey(Key, EventType, AmountDepressed, bGamepad);
+}
+
+bool AShooterPlayerController::InputAxis(FKey Key, float Delta, float DeltaTime, int32 NumSamples, bool bGamepad)
+{
+	UShooterReplaySubsystem* Replay = GetWorld()->GetSubsystem<UShooterReplaySubsystem>();
+	if (Replay && !Replay->HandleInputAxis(this, Key, Delta, DeltaTime, NumSamples, bGamepad))
+	{
+		return true;
+	}
+	return Super::InputAxis(Key, Delta, DeltaTime, NumSamples, bGamepad);
+}
+
+void AShooterPlayerController::UseNativeCrosshairs(bool bUseNative)
+{
+	if (bUseNativeCrosshairs == bUseNative) return;
+
+	bUseNativeCrosshairs = bUseNative;
+
+	// Swap the HUD actor locally, the server doesn't care which crosshairs are drawn
+	if (IsLocalController())
+	{
+		ClientSetHUD_Implementation(GameModeHUDClass);
+	}
+}
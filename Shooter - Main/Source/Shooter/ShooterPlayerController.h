@@ -17,10 +17,19 @@ class SHOOTER_API AShooterPlayerController : public APlayerController
 public:
 	AShooterPlayerController();
 
+	/* Spawns AShooterHUD while native crosshairs are on, the game mode's HUD otherwise */
+	virtual void ClientSetHUD_Implementation(TSubclassOf<AHUD> NewHUDClass) override;
+
 protected:
 
 	virtual void BeginPlay() override;
 
+	virtual void OnPossess(APawn* InPawn) override;
+
+	/* Input passes through the replay subsystem so it can be recorded, or dropped while a replay drives the pawn */
+	virtual bool InputKey(FKey Key, EInputEvent EventType, float AmountDepressed, bool bGamepad) override;
+	virtual bool InputAxis(FKey Key, float Delta, float DeltaTime, int32 NumSamples, bool bGamepad) override;
+
 private:
 
 	/* Reference to the HUD OVerlay Blueprint */
@@ -30,4 +39,20 @@ private:
 	/* Variable to hold the HUD Overlay when creating it */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Widgets, meta = (AllowPrivateAccess = "true"))
 	UUserWidget* HUDOverlay;
+
+	/* Draw crosshairs natively in AShooterHUD instead of spawning the game mode's HUD, which draws its own */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Widgets, meta = (AllowPrivateAccess = "true"))
+	bool bUseNativeCrosshairs;
+
+	/* HUD class the game mode asked for, spawned instead of AShooterHUD when native crosshairs are off */
+	UPROPERTY()
+	TSubclassOf<AHUD> GameModeHUDClass;
+
+public:
+
+	/* Switch between the native crosshairs and the game mode's HUD at runtime */
+	UFUNCTION(Exec)
+	void UseNativeCrosshairs(bool bUseNative);
+
+	FORCEINLINE bool GetUseNativeCrosshairs() const { return bUseNativeCrosshairs; }
 };
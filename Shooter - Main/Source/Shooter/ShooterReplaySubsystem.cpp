@@ -0,0 +1,376 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterReplaySubsystem.h"
+#include "Shooter.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerController.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "HAL/PlatformMisc.h"
+#include "RenderCore.h"
+#include "ShooterAIScheduler.h"
+#include "ShooterCharacter.h"
+#include "ShooterSignificanceManager.h"
+
+static TAutoConsoleVariable<float> CVarReplayFixedFPS(
+	TEXT("Shooter.Replay.FixedFPS"),
+	60.f,
+	TEXT("Fixed frame rate used while recording. Replays use the rate they were recorded with."));
+
+static TAutoConsoleVariable<int32> CVarReplayStatsFile(
+	TEXT("Shooter.Replay.StatsFile"),
+	1,
+	TEXT("1 captures a stats file (stat startfile) for the length of a replay."));
+
+static FAutoConsoleCommandWithWorldAndArgs ReplayRecordCommand(
+	TEXT("Shooter.Replay.Record"),
+	TEXT("Shooter.Replay.Record Name. Records the local player's inputs until Shooter.Replay.Stop. Only recordings started on a freshly loaded map (-ShooterRecord=Name) replay faithfully."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UShooterReplaySubsystem* Replay = World ? World->GetSubsystem<UShooterReplaySubsystem>() : nullptr;
+		if (Replay && Args.Num() > 0)
+		{
+			Replay->StartRecording(Args[0]);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld ReplayStopCommand(
+	TEXT("Shooter.Replay.Stop"),
+	TEXT("Stops and saves the current input recording."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UShooterReplaySubsystem* Replay = World ? World->GetSubsystem<UShooterReplaySubsystem>() : nullptr;
+		if (Replay)
+		{
+			Replay->StopRecording();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs ReplayPlayCommand(
+	TEXT("Shooter.Replay.Play"),
+	TEXT("Shooter.Replay.Play Name. Plays a recording back in the current world. Use -ShooterReplay=Name to replay from a fresh map."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UShooterReplaySubsystem* Replay = World ? World->GetSubsystem<UShooterReplaySubsystem>() : nullptr;
+		if (Replay && Args.Num() > 0)
+		{
+			Replay->StartReplay(Args[0]);
+		}
+	}));
+
+void UShooterReplaySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	RandomStream.GenerateNewSeed();
+
+	if (!IsInGameWorld()) return;
+
+	// Seed before any actor begins play, enemies draw from the stream as soon as they spawn
+	FString Name;
+	if (FParse::Value(FCommandLine::Get(), TEXT("ShooterReplay="), Name))
+	{
+		bExitWhenDone = StartReplay(Name);
+	}
+	else if (FParse::Value(FCommandLine::Get(), TEXT("ShooterRecord="), Name))
+	{
+		StartRecording(Name);
+	}
+}
+
+void UShooterReplaySubsystem::Deinitialize()
+{
+	if (Mode == EReplayMode::Recording)
+	{
+		StopRecording();
+	}
+	Mode = EReplayMode::None;
+	RestoreTimeStep();
+
+	Super::Deinitialize();
+}
+
+TStatId UShooterReplaySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterReplaySubsystem, STATGROUP_Tickables);
+}
+
+void UShooterReplaySubsystem::Tick(float DeltaTime)
+{
+	switch (Mode)
+	{
+	case EReplayMode::PendingRecording:
+	case EReplayMode::PendingReplay:
+		BeginPending();
+		break;
+
+	case EReplayMode::Recording:
+		// Inputs that arrive before the next world tick belong to the next frame
+		++CurrentFrame;
+		Recording.NumFrames = CurrentFrame;
+		break;
+
+	case EReplayMode::Replaying:
+		{
+			const double Now{ FPlatformTime::Seconds() };
+			FrameMs.AddSample(static_cast<float>((Now - LastFrameTime) * 1000.0));
+			GameThreadMs.AddSample(static_cast<float>(FPlatformTime::ToMilliseconds(GGameThreadTime)));
+			LastFrameTime = Now;
+
+			++CurrentFrame;
+			if (CurrentFrame >= Recording.NumFrames)
+			{
+				FinishReplay();
+				break;
+			}
+
+			APlayerController* PlayerController = GetLocalPlayerController();
+			if (PlayerController)
+			{
+				InjectInputs(PlayerController);
+			}
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+void UShooterReplaySubsystem::StartRecording(const FString& Name)
+{
+	if (Mode != EReplayMode::None) return;
+
+	RecordingName = Name;
+	Recording = FInputRecording();
+	Recording.Seed = FMath::Rand();
+	Recording.FixedDeltaTime = 1.f / FMath::Max(CVarReplayFixedFPS.GetValueOnGameThread(), 1.f);
+	RandomStream.Initialize(Recording.Seed);
+
+	Mode = EReplayMode::PendingRecording;
+}
+
+void UShooterReplaySubsystem::StopRecording()
+{
+	if (Mode != EReplayMode::Recording && Mode != EReplayMode::PendingRecording) return;
+
+	Mode = EReplayMode::None;
+	RestoreTimeStep();
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	Writer << Recording;
+
+	const FString Path{ GetRecordingPath(RecordingName) };
+	if (FFileHelper::SaveArrayToFile(Bytes, *Path))
+	{
+		UE_LOG(LogShooter, Log, TEXT("Saved input recording %s: %u frames, %d inputs"), *Path, Recording.NumFrames, Recording.Inputs.Num());
+	}
+	else
+	{
+		UE_LOG(LogShooter, Error, TEXT("Could not save input recording %s"), *Path);
+	}
+}
+
+bool UShooterReplaySubsystem::StartReplay(const FString& Name)
+{
+	if (Mode != EReplayMode::None) return false;
+
+	const FString Path{ GetRecordingPath(Name) };
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *Path))
+	{
+		UE_LOG(LogShooter, Error, TEXT("Could not load input recording %s"), *Path);
+		return false;
+	}
+
+	Recording = FInputRecording();
+	FMemoryReader Reader(Bytes);
+	Reader << Recording;
+	if (Reader.IsError())
+	{
+		UE_LOG(LogShooter, Error, TEXT("Input recording %s is corrupt"), *Path);
+		return false;
+	}
+
+	RecordingName = Name;
+	RandomStream.Initialize(Recording.Seed);
+	Mode = EReplayMode::PendingReplay;
+	return true;
+}
+
+void UShooterReplaySubsystem::BeginPending()
+{
+	APlayerController* PlayerController = GetLocalPlayerController();
+	APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+	if (Pawn == nullptr) return;
+
+	CurrentFrame = 0;
+	NextInput = 0;
+	SetFixedTimeStep(Recording.FixedDeltaTime);
+
+	if (Mode == EReplayMode::PendingRecording)
+	{
+		Recording.StartLocation = Pawn->GetActorLocation();
+		Recording.StartRotation = Pawn->GetActorRotation();
+		Recording.StartControlRotation = PlayerController->GetControlRotation();
+		Mode = EReplayMode::Recording;
+		UE_LOG(LogShooter, Log, TEXT("Recording inputs to %s, seed %d"), *RecordingName, Recording.Seed);
+		return;
+	}
+
+	Pawn->TeleportTo(Recording.StartLocation, Recording.StartRotation);
+	PlayerController->SetControlRotation(Recording.StartControlRotation);
+
+	FrameMs.Reset();
+	GameThreadMs.Reset();
+	LastFrameTime = FPlatformTime::Seconds();
+
+	if (CVarReplayStatsFile.GetValueOnGameThread() != 0)
+	{
+		GEngine->Exec(GetWorld(), TEXT("stat startfile"));
+	}
+
+	Mode = EReplayMode::Replaying;
+	UE_LOG(LogShooter, Log, TEXT("Replaying %s: %u frames, %d inputs, seed %d"), *RecordingName, Recording.NumFrames, Recording.Inputs.Num(), Recording.Seed);
+
+	InjectInputs(PlayerController);
+}
+
+void UShooterReplaySubsystem::InjectInputs(APlayerController* PlayerController)
+{
+	TGuardValue<bool> InjectingGuard(bInjecting, true);
+
+	while (Recording.Inputs.IsValidIndex(NextInput) && Recording.Inputs[NextInput].Frame <= CurrentFrame)
+	{
+		const FRecordedInput& Input = Recording.Inputs[NextInput++];
+		const FKey Key{ *Input.KeyName };
+		if (Input.bAxis)
+		{
+			PlayerController->InputAxis(Key, Input.Value, Input.DeltaTime, Input.NumSamples, Input.bGamepad);
+		}
+		else
+		{
+			PlayerController->InputKey(Key, static_cast<EInputEvent>(Input.Event), Input.Value, Input.bGamepad);
+		}
+	}
+}
+
+bool UShooterReplaySubsystem::HandleInputKey(APlayerController* PlayerController, const FKey& Key, EInputEvent EventType, float AmountDepressed, bool bGamepad)
+{
+	if (Mode == EReplayMode::Replaying)
+	{
+		return bInjecting;
+	}
+	if (Mode == EReplayMode::Recording && PlayerController == GetLocalPlayerController())
+	{
+		FRecordedInput& Input = Recording.Inputs.AddDefaulted_GetRef();
+		Input.Frame = CurrentFrame;
+		Input.KeyName = Key.GetFName().ToString();
+		Input.Event = static_cast<uint8>(EventType);
+		Input.Value = AmountDepressed;
+		Input.bGamepad = bGamepad;
+	}
+	return true;
+}
+
+bool UShooterReplaySubsystem::HandleInputAxis(APlayerController* PlayerController, const FKey& Key, float Delta, float DeltaTime, int32 NumSamples, bool bGamepad)
+{
+	if (Mode == EReplayMode::Replaying)
+	{
+		return bInjecting;
+	}
+	if (Mode == EReplayMode::Recording && PlayerController == GetLocalPlayerController())
+	{
+		FRecordedInput& Input = Recording.Inputs.AddDefaulted_GetRef();
+		Input.Frame = CurrentFrame;
+		Input.KeyName = Key.GetFName().ToString();
+		Input.bAxis = true;
+		Input.Value = Delta;
+		Input.DeltaTime = DeltaTime;
+		Input.NumSamples = NumSamples;
+		Input.bGamepad = bGamepad;
+	}
+	return true;
+}
+
+void UShooterReplaySubsystem::FinishReplay()
+{
+	Mode = EReplayMode::None;
+	RestoreTimeStep();
+
+	if (CVarReplayStatsFile.GetValueOnGameThread() != 0)
+	{
+		GEngine->Exec(GetWorld(), TEXT("stat stopfile"));
+	}
+
+	LogReport();
+
+	if (bExitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void UShooterReplaySubsystem::LogReport() const
+{
+	UE_LOG(LogShooter, Log, TEXT("Replay %s finished after %u frames"), *RecordingName, CurrentFrame);
+	UE_LOG(LogShooter, Log, TEXT("Frame ms: %s"), *FrameMs.ToString());
+	UE_LOG(LogShooter, Log, TEXT("Game thread ms: %s"), *GameThreadMs.ToString());
+
+	UWorld* World = GetWorld();
+
+	const UShooterAIScheduler* Scheduler = World->GetSubsystem<UShooterAIScheduler>();
+	if (Scheduler)
+	{
+		Scheduler->LogReport();
+	}
+
+	const UShooterSignificanceManager* SignificanceManager = World->GetSubsystem<UShooterSignificanceManager>();
+	if (SignificanceManager)
+	{
+		UE_LOG(LogShooter, Log, TEXT("Significance tiers at the end: %d high, %d medium, %d low, %d dormant, budget scale %.2f"),
+			SignificanceManager->GetTierPopulation(ESignificanceTier::EST_High),
+			SignificanceManager->GetTierPopulation(ESignificanceTier::EST_Medium),
+			SignificanceManager->GetTierPopulation(ESignificanceTier::EST_Low),
+			SignificanceManager->GetTierPopulation(ESignificanceTier::EST_Dormant),
+			SignificanceManager->GetBudgetScale());
+	}
+
+	const APlayerController* PlayerController = GetLocalPlayerController();
+	AShooterCharacter* ShooterCharacter = PlayerController ? Cast<AShooterCharacter>(PlayerController->GetPawn()) : nullptr;
+	if (ShooterCharacter)
+	{
+		ShooterCharacter->ReportShotLatency();
+	}
+}
+
+void UShooterReplaySubsystem::SetFixedTimeStep(float FixedDeltaTime)
+{
+	bSavedUseFixedTimeStep = FApp::UseFixedTimeStep();
+	SavedFixedDeltaTime = FApp::GetFixedDeltaTime();
+	FApp::SetUseFixedTimeStep(true);
+	FApp::SetFixedDeltaTime(FixedDeltaTime);
+}
+
+void UShooterReplaySubsystem::RestoreTimeStep()
+{
+	if (Mode == EReplayMode::Recording || Mode == EReplayMode::Replaying) return;
+	if (SavedFixedDeltaTime <= 0.0) return;
+
+	FApp::SetUseFixedTimeStep(bSavedUseFixedTimeStep);
+	FApp::SetFixedDeltaTime(SavedFixedDeltaTime);
+	SavedFixedDeltaTime = 0.0;
+}
+
+FString UShooterReplaySubsystem::GetRecordingPath(const FString& Name)
+{
+	return FPaths::ProjectSavedDir() / TEXT("Replays") / Name + TEXT(".shooterinput");
+}
@@ -0,0 +1,150 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShooterTickableWorldSubsystem.h"
+#include "InputCoreTypes.h"
+#include "PercentileSampler.h"
+#include "ShooterReplaySubsystem.generated.h"
+
+class APlayerController;
+
+/* One key or axis event as it reached the player controller */
+struct FRecordedInput
+{
+	/* Frame since the recording started */
+	uint32 Frame = 0;
+
+	FString KeyName;
+
+	/* Axis events carry Delta, DeltaTime and NumSamples, key events Event and AmountDepressed in Value */
+	bool bAxis = false;
+	uint8 Event = 0;
+	float Value = 0.f;
+	float DeltaTime = 0.f;
+	int32 NumSamples = 0;
+	bool bGamepad = false;
+
+	friend FArchive& operator<<(FArchive& Ar, FRecordedInput& Input)
+	{
+		Ar << Input.Frame << Input.KeyName << Input.bAxis << Input.Event << Input.Value << Input.DeltaTime << Input.NumSamples << Input.bGamepad;
+		return Ar;
+	}
+};
+
+/* Everything needed to play a session's inputs back */
+struct FInputRecording
+{
+	int32 Seed = 0;
+	float FixedDeltaTime = 1.f / 60.f;
+	uint32 NumFrames = 0;
+	FVector StartLocation = FVector::ZeroVector;
+	FRotator StartRotation = FRotator::ZeroRotator;
+	FRotator StartControlRotation = FRotator::ZeroRotator;
+	TArray<FRecordedInput> Inputs;
+
+	friend FArchive& operator<<(FArchive& Ar, FInputRecording& Recording)
+	{
+		Ar << Recording.Seed << Recording.FixedDeltaTime << Recording.NumFrames;
+		Ar << Recording.StartLocation << Recording.StartRotation << Recording.StartControlRotation;
+		Ar << Recording.Inputs;
+		return Ar;
+	}
+};
+
+/**
+ * Records the local player's inputs on a fixed timestep together with the seed of the shared gameplay random stream,
+ * and plays them back frame by frame, e.g. headless with -nullrhi, reporting frame time percentiles and subsystem stats.
+ * Start from the command line with -ShooterRecord=Name or -ShooterReplay=Name so the recording begins on a fresh map.
+ */
+UCLASS()
+class SHOOTER_API UShooterReplaySubsystem : public UShooterTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/* FTickableGameObject interface */
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/* Starts recording once the local player has a pawn */
+	void StartRecording(const FString& Name);
+
+	/* Saves the recording to Saved/Replays */
+	void StopRecording();
+
+	/* Loads a recording and plays it back once the local player has a pawn */
+	bool StartReplay(const FString& Name);
+
+	/* Called by the player controller. Returns false when live input must be dropped during a replay */
+	bool HandleInputKey(APlayerController* PlayerController, const FKey& Key, EInputEvent EventType, float AmountDepressed, bool bGamepad);
+	bool HandleInputAxis(APlayerController* PlayerController, const FKey& Key, float Delta, float DeltaTime, int32 NumSamples, bool bGamepad);
+
+	/* Gameplay randomness that has to repeat in a replay draws from here */
+	FORCEINLINE FRandomStream& GetRandomStream() { return RandomStream; }
+
+	FORCEINLINE bool IsRecording() const { return Mode == EReplayMode::Recording; }
+	FORCEINLINE bool IsReplaying() const { return Mode == EReplayMode::Replaying; }
+
+private:
+
+	enum class EReplayMode : uint8
+	{
+		None,
+		PendingRecording,
+		Recording,
+		PendingReplay,
+		Replaying
+	};
+
+	/* Starts a pending recording or replay once the local player is ready */
+	void BeginPending();
+
+	/* Feeds the inputs recorded for CurrentFrame to the player controller */
+	void InjectInputs(APlayerController* PlayerController);
+
+	void FinishReplay();
+
+	void LogReport() const;
+
+	void SetFixedTimeStep(float FixedDeltaTime);
+	void RestoreTimeStep();
+
+	static FString GetRecordingPath(const FString& Name);
+
+	EReplayMode Mode = EReplayMode::None;
+
+	FString RecordingName;
+
+	FInputRecording Recording;
+
+	/* Frames since recording or replay started */
+	uint32 CurrentFrame = 0;
+
+	/* Next entry of Recording.Inputs to play back */
+	int32 NextInput = 0;
+
+	/* Set while recorded inputs are fed to the controller, so they aren't dropped like live input */
+	bool bInjecting = false;
+
+	/* Quit once the replay is done, for replays started from the command line */
+	bool bExitWhenDone = false;
+
+	bool bSavedUseFixedTimeStep = false;
+	double SavedFixedDeltaTime = 0.0;
+
+	FRandomStream RandomStream;
+
+	double LastFrameTime = 0.0;
+
+	/* Wall time between frames during a replay, in ms */
+	FPercentileSampler FrameMs{ 16384 };
+
+	/* Game thread time per frame during a replay, in ms */
+	FPercentileSampler GameThreadMs{ 16384 };
+};
@@ -0,0 +1,322 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterReplicationGraph.h"
+#include "Shooter.h"
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "Engine/ChildConnection.h"
+#include "GameFramework/Info.h"
+#include "GameFramework/PlayerController.h"
+#include "ReplicationGraphTypes.h"
+#include "Enemy.h"
+#include "Item.h"
+#include "ShooterCharacter.h"
+#include "ShooterLLM.h"
+
+DECLARE_STATS_GROUP(TEXT("ShooterNet"), STATGROUP_ShooterNet, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Replicate actors"), STAT_ShooterNetReplicate, STATGROUP_ShooterNet);
+DECLARE_CYCLE_STAT(TEXT("Gather enemies"), STAT_ShooterNetGatherEnemies, STATGROUP_ShooterNet);
+
+static TAutoConsoleVariable<float> CVarNetGridCellSize(
+	TEXT("Shooter.Net.GridCellSize"),
+	10000.f,
+	TEXT("Cell size in cm of the replication grid. Read when the graph is created."));
+
+static TAutoConsoleVariable<float> CVarNetItemCullDistance(
+	TEXT("Shooter.Net.ItemCullDistance"),
+	5000.f,
+	TEXT("Items further than this from every viewer of a connection are not replicated to it. Read when the graph is created."));
+
+static TAutoConsoleVariable<float> CVarNetEnemyCullDistance(
+	TEXT("Shooter.Net.EnemyCullDistance"),
+	15000.f,
+	TEXT("Enemies further than this from every viewer of a connection are not replicated to it. Read when the graph is created."));
+
+static TAutoConsoleVariable<float> CVarNetEnemyNearDistance(
+	TEXT("Shooter.Net.EnemyNearDistance"),
+	2500.f,
+	TEXT("Enemies closer than this replicate every net frame, twice as far every 3rd frame, beyond that every 6th."));
+
+static FAutoConsoleCommandWithWorld NetGraphReportCommand(
+	TEXT("Shooter.Net.GraphReport"),
+	TEXT("Logs replication graph time per net tick and actor counts. Run on the server."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+		UShooterReplicationGraph* Graph = NetDriver ? Cast<UShooterReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr;
+		if (Graph)
+		{
+			Graph->LogReport();
+		}
+		else
+		{
+			UE_LOG(LogShooter, Warning, TEXT("Shooter.Net.GraphReport: no replication graph, run it on a server with ReplicationDriverClassName set"));
+		}
+	}));
+
+static FAutoConsoleCommandWithWorldAndArgs NetSpawnItemsCommand(
+	TEXT("Shooter.Net.SpawnItems"),
+	TEXT("Shooter.Net.SpawnItems [Count=1000] [Spacing=200]. Spawns pickup items on a square around the first player for replication stress tests. Run on the server."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (World == nullptr || World->GetNetMode() == NM_Client) return;
+
+		const int32 Count{ Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000 };
+		const float Spacing{ Args.Num() > 1 ? FCString::Atof(*Args[1]) : 200.f };
+		const int32 Side{ FMath::CeilToInt(FMath::Sqrt(static_cast<float>(FMath::Max(Count, 1)))) };
+
+		FVector Center{ FVector::ZeroVector };
+		APlayerController* PlayerController = World->GetFirstPlayerController();
+		if (PlayerController && PlayerController->GetPawn())
+		{
+			Center = PlayerController->GetPawn()->GetActorLocation();
+		}
+
+		SHOOTER_LLM_SCOPE(Items);
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			const FVector Offset{ (Index % Side - Side / 2) * Spacing, (Index / Side - Side / 2) * Spacing, 0.f };
+			World->SpawnActor<AItem>(AItem::StaticClass(), Center + Offset, FRotator::ZeroRotator, SpawnParams);
+		}
+		UE_LOG(LogShooter, Log, TEXT("Spawned %d items %.0f cm apart"), Count, Spacing);
+	}));
+
+namespace ShooterReplication
+{
+	/* Moves the grid origin so every cell index is positive */
+	const FVector2D SpatialBias{ -150000.f, -150000.f };
+
+	/* Replication periods in net frames for near, mid and far enemies */
+	constexpr uint16 NearPeriod = 1;
+	constexpr uint16 MidPeriod = 3;
+	constexpr uint16 FarPeriod = 6;
+}
+
+void UShooterReplicationGraphNode_Enemies::NotifyAddNetworkActor(const FNewReplicatedActorInfo& ActorInfo)
+{
+	Enemies.Add(ActorInfo.Actor);
+}
+
+bool UShooterReplicationGraphNode_Enemies::NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound)
+{
+	const bool bRemoved{ Enemies.RemoveFast(ActorInfo.Actor) };
+	if (!bRemoved && bWarnIfNotFound)
+	{
+		UE_LOG(LogShooter, Warning, TEXT("Enemy replication node: %s was not in the list"), *GetNameSafe(ActorInfo.Actor));
+	}
+	return bRemoved;
+}
+
+void UShooterReplicationGraphNode_Enemies::NotifyResetAllNetworkActors()
+{
+	Enemies.Reset();
+	EnemyPeriods.Reset();
+}
+
+void UShooterReplicationGraphNode_Enemies::UpdateReplicationPeriods(const TArray<FVector>& ViewLocations)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterNetGatherEnemies);
+
+	EnemyPeriods.Reset(Enemies.Num());
+	for (AActor* Enemy : Enemies)
+	{
+		const FVector EnemyLocation{ Enemy->GetActorLocation() };
+		float ClosestDistanceSquared{ BIG_NUMBER };
+		for (const FVector& ViewLocation : ViewLocations)
+		{
+			ClosestDistanceSquared = FMath::Min(ClosestDistanceSquared, FVector::DistSquared(ViewLocation, EnemyLocation));
+		}
+		EnemyPeriods.Add(GetPeriodForDistanceSquared(ClosestDistanceSquared));
+	}
+}
+
+void UShooterReplicationGraphNode_Enemies::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterNetGatherEnemies);
+
+	if (Enemies.Num() == 0) return;
+
+	// Every enemy is gathered so its channel stays open, the shared period only decides how often it is sent.
+	// An enemy near any player is sent at the near rate to everyone, a little bandwidth for no per-connection distance tests
+	int32 Index{ 0 };
+	for (AActor* Enemy : Enemies)
+	{
+		FConnectionReplicationActorInfo& ConnectionActorInfo = Params.ConnectionManager.ActorInfoMap.FindOrAdd(Enemy);
+		ConnectionActorInfo.ReplicationPeriodFrame = EnemyPeriods.IsValidIndex(Index) ? EnemyPeriods[Index] : ShooterReplication::NearPeriod;
+		++Index;
+	}
+
+	Params.OutGatheredReplicationLists.AddReplicationActorList(Enemies);
+}
+
+uint16 UShooterReplicationGraphNode_Enemies::GetPeriodForDistanceSquared(float DistanceSquared)
+{
+	const float NearDistance{ CVarNetEnemyNearDistance.GetValueOnGameThread() };
+	if (DistanceSquared < FMath::Square(NearDistance))
+	{
+		return ShooterReplication::NearPeriod;
+	}
+	if (DistanceSquared < FMath::Square(NearDistance * 2.f))
+	{
+		return ShooterReplication::MidPeriod;
+	}
+	return ShooterReplication::FarPeriod;
+}
+
+void UShooterReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	// Anything not listed below falls back to the AActor entry
+	InitClassInfo(AActor::StaticClass(), 0.f);
+	InitClassInfo(AShooterCharacter::StaticClass(), 0.f);
+	InitClassInfo(AItem::StaticClass(), CVarNetItemCullDistance.GetValueOnGameThread());
+	InitClassInfo(AEnemy::StaticClass(), CVarNetEnemyCullDistance.GetValueOnGameThread());
+}
+
+void UShooterReplicationGraph::InitClassInfo(UClass* Class, float CullDistance)
+{
+	const AActor* ActorCDO = Class->GetDefaultObject<AActor>();
+
+	FClassReplicationInfo ClassInfo;
+	ClassInfo.ReplicationPeriodFrame = GetReplicationPeriodFrameForFrequency(ActorCDO->NetUpdateFrequency);
+	ClassInfo.SetCullDistanceSquared(CullDistance > 0.f ? FMath::Square(CullDistance) : ActorCDO->NetCullDistanceSquared);
+	GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+}
+
+void UShooterReplicationGraph::InitGlobalGraphNodes()
+{
+	GridNode = CreateNewNode<UReplicationGraphNode_GridSpatialization2D>();
+	GridNode->CellSize = CVarNetGridCellSize.GetValueOnGameThread();
+	GridNode->SpatialBias = ShooterReplication::SpatialBias;
+	AddGlobalGraphNode(GridNode);
+
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+
+	EnemyNode = CreateNewNode<UShooterReplicationGraphNode_Enemies>();
+	AddGlobalGraphNode(EnemyNode);
+}
+
+void UShooterReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	// The connection's own player controller and view target
+	UReplicationGraphNode_AlwaysRelevant_ForConnection* AlwaysRelevantForConnectionNode = CreateNewNode<UReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(AlwaysRelevantForConnectionNode, RepGraphConnection);
+}
+
+UShooterReplicationGraph::EShooterRepRoute UShooterReplicationGraph::GetRoute(const AActor* Actor) const
+{
+	if (Actor->bOnlyRelevantToOwner)
+	{
+		return EShooterRepRoute::NotRouted;
+	}
+	if (Actor->bAlwaysRelevant || Actor->IsA<AInfo>())
+	{
+		return EShooterRepRoute::AlwaysRelevant;
+	}
+	if (Actor->IsA<AEnemy>())
+	{
+		return EShooterRepRoute::Enemies;
+	}
+	if (Actor->IsA<AItem>())
+	{
+		return EShooterRepRoute::Spatialize_Dormancy;
+	}
+	return EShooterRepRoute::Spatialize_Dynamic;
+}
+
+void UShooterReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	switch (GetRoute(ActorInfo.Actor))
+	{
+	case EShooterRepRoute::AlwaysRelevant:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+
+	case EShooterRepRoute::Spatialize_Dynamic:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		++DynamicActorCount;
+		break;
+
+	case EShooterRepRoute::Spatialize_Dormancy:
+		// Static in the grid while dormant, moved to the dynamic list when it wakes
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		++DormancyActorCount;
+		break;
+
+	case EShooterRepRoute::Enemies:
+		EnemyNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void UShooterReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	switch (GetRoute(ActorInfo.Actor))
+	{
+	case EShooterRepRoute::AlwaysRelevant:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+
+	case EShooterRepRoute::Spatialize_Dynamic:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		--DynamicActorCount;
+		break;
+
+	case EShooterRepRoute::Spatialize_Dormancy:
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+		--DormancyActorCount;
+		break;
+
+	case EShooterRepRoute::Enemies:
+		EnemyNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+
+	default:
+		break;
+	}
+}
+
+int32 UShooterReplicationGraph::ServerReplicateActors(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ShooterNetReplicate);
+
+	const double StartTime{ FPlatformTime::Seconds() };
+
+	// Enemy update rates only depend on the closest viewer of any connection, bucket them once for every connection
+	TArray<FVector> ViewLocations;
+	for (UNetReplicationGraphConnection* Connection : Connections)
+	{
+		if (Connection == nullptr || Connection->NetConnection == nullptr) continue;
+
+		ViewLocations.Add(FNetViewer(Connection->NetConnection, DeltaSeconds).ViewLocation);
+		for (UChildConnection* Child : Connection->NetConnection->Children)
+		{
+			ViewLocations.Add(FNetViewer(Child, DeltaSeconds).ViewLocation);
+		}
+	}
+	EnemyNode->UpdateReplicationPeriods(ViewLocations);
+
+	const int32 Result{ Super::ServerReplicateActors(DeltaSeconds) };
+	NetTickMs.AddSample(static_cast<float>((FPlatformTime::Seconds() - StartTime) * 1000.0));
+	return Result;
+}
+
+void UShooterReplicationGraph::LogReport() const
+{
+	const int32 NumConnections{ NetDriver ? NetDriver->ClientConnections.Num() : 0 };
+
+	UE_LOG(LogShooter, Log, TEXT("Replication graph: %d connections, %d spatialized, %d dormancy managed"),
+		NumConnections, DynamicActorCount, DormancyActorCount);
+	UE_LOG(LogShooter, Log, TEXT("Replicate actors ms per net tick: %s"), *NetTickMs.ToString());
+}
@@ -0,0 +1,99 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "PercentileSampler.h"
+#include "ShooterReplicationGraph.generated.h"
+
+class UReplicationGraphNode_GridSpatialization2D;
+class UReplicationGraphNode_ActorList;
+
+/**
+ * Gathers every enemy for a connection and sets how often each one replicates by distance to the closest viewer.
+ * The periods are worked out once per net frame against every connection's viewers and shared by all connections.
+ * Culling beyond the enemy cull distance is left to the graph.
+ */
+UCLASS()
+class SHOOTER_API UShooterReplicationGraphNode_Enemies : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound = true) override;
+	virtual void NotifyResetAllNetworkActors() override;
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+	/* Buckets every enemy by distance to the closest of ViewLocations, called once per net frame before gathering */
+	void UpdateReplicationPeriods(const TArray<FVector>& ViewLocations);
+
+	/* Replication period in frames for an enemy this far from the closest viewer */
+	static uint16 GetPeriodForDistanceSquared(float DistanceSquared);
+
+private:
+
+	FActorRepListRefView Enemies;
+
+	/* This net frame's replication period of each enemy, in the order of Enemies */
+	TArray<uint16> EnemyPeriods;
+};
+
+/**
+ * Replication driver for the shooter. Replaces the per-connection relevancy test against every actor with:
+ * a 2D grid for characters and items, where items lying in EIS_Pickup sit dormant until picked up,
+ * the enemy node above for distance based update rates, and always relevant lists for game state and the viewer.
+ * Enabled through ReplicationDriverClassName in DefaultEngine.ini.
+ */
+UCLASS(Transient, config = Engine)
+class SHOOTER_API UShooterReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
+
+	/* Logs server replication time per net tick and the actors each node holds */
+	void LogReport() const;
+
+private:
+
+	enum class EShooterRepRoute : uint8
+	{
+		/* Not replicated through the graph, e.g. owner only actors handled by the connection node */
+		NotRouted,
+		AlwaysRelevant,
+		Spatialize_Dynamic,
+		Spatialize_Dormancy,
+		Enemies
+	};
+
+	EShooterRepRoute GetRoute(const AActor* Actor) const;
+
+	/* Fills a class info from the class default object's net settings. A CullDistance of 0 keeps the default's */
+	void InitClassInfo(UClass* Class, float CullDistance);
+
+	UPROPERTY()
+	UReplicationGraphNode_GridSpatialization2D* GridNode;
+
+	UPROPERTY()
+	UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+
+	UPROPERTY()
+	UShooterReplicationGraphNode_Enemies* EnemyNode;
+
+	/* Actors routed to each node, for the report */
+	int32 DynamicActorCount = 0;
+	int32 DormancyActorCount = 0;
+
+	/* ServerReplicateActors wall time, in ms */
+	FPercentileSampler NetTickMs{ 1024 };
+};
@@ -0,0 +1,368 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterSignificanceManager.h"
+#include "Shooter.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "DrawDebugHelpers.h"
+
+DECLARE_STATS_GROUP(TEXT("ShooterSignificance"), STATGROUP_ShooterSignificance, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Significance Update"), STAT_SignificanceUpdate, STATGROUP_ShooterSignificance);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tier High"), STAT_SignificanceTierHigh, STATGROUP_ShooterSignificance);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tier Medium"), STAT_SignificanceTierMedium, STATGROUP_ShooterSignificance);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tier Low"), STAT_SignificanceTierLow, STATGROUP_ShooterSignificance);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Tier Dormant"), STAT_SignificanceTierDormant, STATGROUP_ShooterSignificance);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Budget Scale"), STAT_SignificanceBudgetScale, STATGROUP_ShooterSignificance);
+
+static TAutoConsoleVariable<float> CVarSignificanceBudgetMs(
+	TEXT("Shooter.Significance.BudgetMs"),
+	10.f,
+	TEXT("Game thread budget in ms. Significance distances shrink while the game thread is over it."));
+
+static TAutoConsoleVariable<float> CVarSignificanceMaxDistance(
+	TEXT("Shooter.Significance.MaxDistance"),
+	8000.f,
+	TEXT("Distance at which an actor's distance score reaches zero, before budget scaling."));
+
+static TAutoConsoleVariable<float> CVarSignificanceUpdateInterval(
+	TEXT("Shooter.Significance.UpdateInterval"),
+	0.1f,
+	TEXT("Seconds between significance passes."));
+
+static TAutoConsoleVariable<int32> CVarSignificanceDebug(
+	TEXT("Shooter.Significance.Debug"),
+	0,
+	TEXT("1 draws each managed actor's tier and the tier populations on screen."));
+
+namespace ShooterSignificance
+{
+	/* Score multiplier for actors behind every viewer */
+	constexpr float BehindViewScale = 0.4f;
+
+	/* Seconds an actor stays boosted after taking part in combat */
+	constexpr float CombatMemoryTime = 5.f;
+
+	/* Score added while the combat boost is active */
+	constexpr float CombatBonus = 0.5f;
+
+	/* Lower bound on BudgetScale so nearby actors always keep some detail */
+	constexpr float MinBudgetScale = 0.25f;
+
+	/* Score thresholds for the High, Medium and Low tiers */
+	constexpr float HighThreshold = 0.7f;
+	constexpr float MediumThreshold = 0.4f;
+	constexpr float LowThreshold = 0.05f;
+
+	const FSignificanceTierSettings TierSettings[] =
+	{
+		// ActorTick, AnimTick, MovementTick, bTickEnabled, bSpawnDetailFX
+		{ 0.f,   0.f,    0.f,   true,  true },	// High
+		{ 0.05f, 0.033f, 0.033f, true, true },	// Medium
+		{ 0.2f,  0.1f,   0.1f,  true,  false },	// Low
+		{ 1.f,   1.f,    1.f,   false, false }	// Dormant
+	};
+	static_assert(UE_ARRAY_COUNT(TierSettings) == static_cast<uint8>(ESignificanceTier::EST_MAX), "One settings entry per significance tier");
+}
+
+void UShooterSignificanceManager::Deinitialize()
+{
+	ManagedActors.Empty();
+	ManagedIndices.Empty();
+
+	Super::Deinitialize();
+}
+
+void UShooterSignificanceManager::Tick(float DeltaTime)
+{
+	UpdateBudget();
+
+	TimeUntilUpdate -= DeltaTime;
+	if (TimeUntilUpdate <= 0.f)
+	{
+		TimeUntilUpdate = CVarSignificanceUpdateInterval.GetValueOnGameThread();
+		UpdateSignificance();
+	}
+
+	if (CVarSignificanceDebug.GetValueOnGameThread() > 0)
+	{
+		DrawDebug();
+	}
+}
+
+TStatId UShooterSignificanceManager::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterSignificanceManager, STATGROUP_Tickables);
+}
+
+void UShooterSignificanceManager::RegisterActor(AActor* Actor)
+{
+	if (Actor == nullptr || ManagedIndices.Contains(Actor)) return;
+
+	FManagedActor Managed;
+	Managed.Actor = Actor;
+	Managed.Score = 1.f;
+	Managed.LastCombatTime = -ShooterSignificance::CombatMemoryTime;
+	Managed.Tier = ESignificanceTier::EST_High;
+
+	ManagedIndices.Add(Actor, ManagedActors.Add(Managed));
+	++TierPopulation[static_cast<uint8>(ESignificanceTier::EST_High)];
+
+	// A pooled actor may come back with the settings of the tier it left in
+	ApplyTierSettings(Actor, ESignificanceTier::EST_High);
+}
+
+void UShooterSignificanceManager::UnregisterActor(AActor* Actor)
+{
+	int32 Index;
+	if (!ManagedIndices.RemoveAndCopyValue(Actor, Index)) return;
+
+	--TierPopulation[static_cast<uint8>(ManagedActors[Index].Tier)];
+
+	ManagedActors.RemoveAtSwap(Index);
+	if (ManagedActors.IsValidIndex(Index))
+	{
+		// Fix up the index of the actor that was swapped into the hole
+		ManagedIndices.Add(ManagedActors[Index].Actor, Index);
+	}
+}
+
+void UShooterSignificanceManager::RefreshActor(AActor* Actor)
+{
+	const int32* Index = ManagedIndices.Find(Actor);
+	if (Index == nullptr) return;
+
+	TArray<FTransform> Viewpoints;
+	GatherViewpoints(Viewpoints);
+
+	FManagedActor& Managed = ManagedActors[*Index];
+	Managed.Score = CalculateScore(Managed, Viewpoints, GetWorld()->GetTimeSeconds());
+	ApplyTier(Managed, ScoreToTier(Managed.Score));
+}
+
+void UShooterSignificanceManager::ReportCombatEvent(AActor* Actor)
+{
+	const int32* Index = ManagedIndices.Find(Actor);
+	if (Index == nullptr) return;
+
+	FManagedActor& Managed = ManagedActors[*Index];
+	Managed.LastCombatTime = GetWorld()->GetTimeSeconds();
+
+	// Combat is the most visible thing an actor can do, don't wait for the next pass
+	if (Managed.Tier != ESignificanceTier::EST_High)
+	{
+		RefreshActor(Actor);
+	}
+}
+
+ESignificanceTier UShooterSignificanceManager::GetTier(const AActor* Actor) const
+{
+	const int32* Index = ManagedIndices.Find(Actor);
+	return Index ? ManagedActors[*Index].Tier : ESignificanceTier::EST_High;
+}
+
+const FSignificanceTierSettings& UShooterSignificanceManager::GetTierSettings(ESignificanceTier Tier)
+{
+	const uint8 TierIndex{ static_cast<uint8>(FMath::Min(Tier, ESignificanceTier::EST_Dormant)) };
+	return ShooterSignificance::TierSettings[TierIndex];
+}
+
+void UShooterSignificanceManager::UpdateSignificance()
+{
+	SCOPE_CYCLE_COUNTER(STAT_SignificanceUpdate);
+
+	TArray<FTransform> Viewpoints;
+	GatherViewpoints(Viewpoints);
+
+	const float WorldTime{ GetWorld()->GetTimeSeconds() };
+
+	for (int32 Index = ManagedActors.Num() - 1; Index >= 0; --Index)
+	{
+		FManagedActor& Managed = ManagedActors[Index];
+		if (!Managed.Actor.IsValid())
+		{
+			// Actor was destroyed without unregistering
+			--TierPopulation[static_cast<uint8>(Managed.Tier)];
+			ManagedIndices.Remove(Managed.Actor);
+			ManagedActors.RemoveAtSwap(Index);
+			if (ManagedActors.IsValidIndex(Index))
+			{
+				ManagedIndices.Add(ManagedActors[Index].Actor, Index);
+			}
+			continue;
+		}
+
+		Managed.Score = CalculateScore(Managed, Viewpoints, WorldTime);
+		ApplyTier(Managed, ScoreToTier(Managed.Score));
+	}
+
+	SET_DWORD_STAT(STAT_SignificanceTierHigh, GetTierPopulation(ESignificanceTier::EST_High));
+	SET_DWORD_STAT(STAT_SignificanceTierMedium, GetTierPopulation(ESignificanceTier::EST_Medium));
+	SET_DWORD_STAT(STAT_SignificanceTierLow, GetTierPopulation(ESignificanceTier::EST_Low));
+	SET_DWORD_STAT(STAT_SignificanceTierDormant, GetTierPopulation(ESignificanceTier::EST_Dormant));
+}
+
+void UShooterSignificanceManager::UpdateBudget()
+{
+	const float BudgetMs{ CVarSignificanceBudgetMs.GetValueOnGameThread() };
+	if (BudgetMs <= 0.f) return;
+
+	// GGameThreadTime holds the game thread time of the last completed frame
+	const float GameThreadMs{ static_cast<float>(FPlatformTime::ToMilliseconds(GGameThreadTime)) };
+
+	if (GameThreadMs > BudgetMs)
+	{
+		// Over budget, pull the distance thresholds in quickly
+		BudgetScale = FMath::Max(BudgetScale * 0.95f, ShooterSignificance::MinBudgetScale);
+	}
+	else if (GameThreadMs < BudgetMs * 0.8f)
+	{
+		// Comfortably under budget, relax slowly to avoid tiers flickering
+		BudgetScale = FMath::Min(BudgetScale * 1.01f, 1.f);
+	}
+
+	SET_FLOAT_STAT(STAT_SignificanceBudgetScale, BudgetScale);
+}
+
+float UShooterSignificanceManager::CalculateScore(const FManagedActor& Managed, const TArray<FTransform>& Viewpoints, float WorldTime) const
+{
+	const AActor* Actor = Managed.Actor.Get();
+	const FVector ActorLocation{ Actor->GetActorLocation() };
+	const float MaxDistance{ CVarSignificanceMaxDistance.GetValueOnGameThread() * BudgetScale };
+
+	float Score{ 0.f };
+	for (const FTransform& Viewpoint : Viewpoints)
+	{
+		const FVector ToActor{ ActorLocation - Viewpoint.GetLocation() };
+		const float Distance{ ToActor.Size() };
+
+		float ViewScore{ 1.f - FMath::Clamp(Distance / MaxDistance, 0.f, 1.f) };
+
+		// Actors behind the viewer are worth less, but not nothing since the camera can turn
+		const FVector ViewForward{ Viewpoint.GetRotation().GetForwardVector() };
+		if (Distance > KINDA_SMALL_NUMBER && FVector::DotProduct(ToActor / Distance, ViewForward) < 0.f)
+		{
+			ViewScore *= ShooterSignificance::BehindViewScale;
+		}
+
+		Score = FMath::Max(Score, ViewScore);
+	}
+
+	if (WorldTime - Managed.LastCombatTime < ShooterSignificance::CombatMemoryTime)
+	{
+		Score += ShooterSignificance::CombatBonus;
+	}
+
+	return Score;
+}
+
+ESignificanceTier UShooterSignificanceManager::ScoreToTier(float Score) const
+{
+	if (Score >= ShooterSignificance::HighThreshold) return ESignificanceTier::EST_High;
+	if (Score >= ShooterSignificance::MediumThreshold) return ESignificanceTier::EST_Medium;
+	if (Score >= ShooterSignificance::LowThreshold) return ESignificanceTier::EST_Low;
+	return ESignificanceTier::EST_Dormant;
+}
+
+void UShooterSignificanceManager::ApplyTier(FManagedActor& Managed, ESignificanceTier NewTier)
+{
+	AActor* Actor = Managed.Actor.Get();
+
+	// Let the actor pin itself, e.g. an equipped weapon must never be throttled
+	ISignificanceInterface* SignificanceInterface = Cast<ISignificanceInterface>(Actor);
+	if (SignificanceInterface)
+	{
+		SignificanceInterface->GetForcedSignificanceTier(NewTier);
+	}
+
+	if (NewTier == Managed.Tier) return;
+
+	--TierPopulation[static_cast<uint8>(Managed.Tier)];
+	++TierPopulation[static_cast<uint8>(NewTier)];
+	Managed.Tier = NewTier;
+
+	ApplyTierSettings(Actor, NewTier);
+
+	if (SignificanceInterface)
+	{
+		SignificanceInterface->SetSignificanceTier(NewTier);
+	}
+}
+
+void UShooterSignificanceManager::ApplyTierSettings(AActor* Actor, ESignificanceTier Tier)
+{
+	const FSignificanceTierSettings& Settings = GetTierSettings(Tier);
+
+	Actor->SetActorTickEnabled(Settings.bTickEnabled);
+	Actor->SetActorTickInterval(Settings.ActorTickInterval);
+
+	TInlineComponentArray<USkeletalMeshComponent*> SkeletalMeshes(Actor);
+	for (USkeletalMeshComponent* SkeletalMesh : SkeletalMeshes)
+	{
+		SkeletalMesh->SetComponentTickEnabled(Settings.bTickEnabled);
+		SkeletalMesh->SetComponentTickInterval(Settings.AnimTickInterval);
+	}
+
+	UCharacterMovementComponent* Movement = Actor->FindComponentByClass<UCharacterMovementComponent>();
+	if (Movement)
+	{
+		Movement->SetComponentTickEnabled(Settings.bTickEnabled);
+		Movement->SetComponentTickInterval(Settings.MovementTickInterval);
+	}
+}
+
+void UShooterSignificanceManager::DrawDebug() const
+{
+	static const FColor TierColors[] = { FColor::Green, FColor::Yellow, FColor::Orange, FColor::Red };
+
+	for (const FManagedActor& Managed : ManagedActors)
+	{
+		const AActor* Actor = Managed.Actor.Get();
+		if (Actor == nullptr) continue;
+
+		const uint8 TierIndex{ static_cast<uint8>(Managed.Tier) };
+		const FString Label{ FString::Printf(TEXT("%s %.2f"), *UEnum::GetDisplayValueAsText(Managed.Tier).ToString(), Managed.Score) };
+		DrawDebugString(GetWorld(), Actor->GetActorLocation() + FVector(0.f, 0.f, 100.f), Label, nullptr, TierColors[TierIndex], 0.f);
+	}
+
+	if (GEngine)
+	{
+		GEngine->AddOnScreenDebugMessage(
+			reinterpret_cast<uint64>(this),
+			0.f,
+			FColor::White,
+			FString::Printf(TEXT("Significance High: %d Medium: %d Low: %d Dormant: %d Budget scale: %.2f"),
+				GetTierPopulation(ESignificanceTier::EST_High),
+				GetTierPopulation(ESignificanceTier::EST_Medium),
+				GetTierPopulation(ESignificanceTier::EST_Low),
+				GetTierPopulation(ESignificanceTier::EST_Dormant),
+				BudgetScale));
+	}
+}
+
+void UShooterSignificanceManager::GatherViewpoints(TArray<FTransform>& OutViewpoints) const
+{
+	// Every player's view counts, including remote players on a server
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (PlayerController == nullptr) continue;
+
+		// A server only has a rough idea of a remote player's camera, score against their pawn, which it simulates itself
+		const APawn* Pawn = PlayerController->GetPawn();
+		if (Pawn && !PlayerController->IsLocalController())
+		{
+			OutViewpoints.Add(FTransform(PlayerController->GetControlRotation(), Pawn->GetPawnViewLocation()));
+			continue;
+		}
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		OutViewpoints.Add(FTransform(ViewRotation, ViewLocation));
+	}
+}
@@ -0,0 +1,106 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShooterTickableWorldSubsystem.h"
+#include "SignificanceInterface.h"
+#include "ShooterSignificanceManager.generated.h"
+
+/* What an actor is allowed to spend while it sits in a tier */
+struct FSignificanceTierSettings
+{
+	/* Actor tick interval, 0 ticks every frame */
+	float ActorTickInterval;
+
+	/* Tick interval of skeletal meshes, which drives the animation update rate */
+	float AnimTickInterval;
+
+	/* Tick interval of the character movement component */
+	float MovementTickInterval;
+
+	/* False disables actor and component ticking entirely */
+	bool bTickEnabled;
+
+	/* False skips cosmetic FX such as impact particles */
+	bool bSpawnDetailFX;
+};
+
+/**
+ * Scores enemies and items by distance, view direction and recent combat and
+ * throttles their ticking, animation, movement and FX by tier.
+ * Distance thresholds shrink when the game thread goes over Shooter.Significance.BudgetMs.
+ */
+UCLASS()
+class SHOOTER_API UShooterSignificanceManager : public UShooterTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	/* FTickableGameObject interface */
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/* Start scoring an actor. Actors start in the High tier at full update rate */
+	void RegisterActor(AActor* Actor);
+
+	void UnregisterActor(AActor* Actor);
+
+	/* Re-evaluate one actor right away, e.g. after its forced tier changed */
+	void RefreshActor(AActor* Actor);
+
+	/* Boosts the actor's score for a while after it took part in combat */
+	void ReportCombatEvent(AActor* Actor);
+
+	ESignificanceTier GetTier(const AActor* Actor) const;
+
+	static const FSignificanceTierSettings& GetTierSettings(ESignificanceTier Tier);
+
+	FORCEINLINE int32 GetTierPopulation(ESignificanceTier Tier) const { return TierPopulation[static_cast<uint8>(Tier)]; }
+	FORCEINLINE float GetBudgetScale() const { return BudgetScale; }
+
+private:
+
+	struct FManagedActor
+	{
+		TWeakObjectPtr<AActor> Actor;
+		float Score;
+		float LastCombatTime;
+		ESignificanceTier Tier;
+	};
+
+	/* Score all managed actors and apply tier changes */
+	void UpdateSignificance();
+
+	/* Shrinks or relaxes BudgetScale based on last frame's game thread time */
+	void UpdateBudget();
+
+	float CalculateScore(const FManagedActor& Managed, const TArray<FTransform>& Viewpoints, float WorldTime) const;
+
+	ESignificanceTier ScoreToTier(float Score) const;
+
+	void ApplyTier(FManagedActor& Managed, ESignificanceTier NewTier);
+
+	/* Pushes a tier's tick settings onto the actor and its components */
+	static void ApplyTierSettings(AActor* Actor, ESignificanceTier Tier);
+
+	void DrawDebug() const;
+
+	void GatherViewpoints(TArray<FTransform>& OutViewpoints) const;
+
+	TArray<FManagedActor> ManagedActors;
+
+	/* Actor to index into ManagedActors */
+	TMap<TWeakObjectPtr<AActor>, int32> ManagedIndices;
+
+	int32 TierPopulation[static_cast<uint8>(ESignificanceTier::EST_MAX)] = {};
+
+	/* Multiplier on distance thresholds, lowered while over budget */
+	float BudgetScale = 1.f;
+
+	/* Time until the next full significance pass */
+	float TimeUntilUpdate = 0.f;
+};
@@ -0,0 +1,483 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterSoakSubsystem.h"
+#include "Shooter.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Camera/CameraComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "HAL/PlatformMisc.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/CommandLine.h"
+#include "Misc/DateTime.h"
+#include "Misc/Paths.h"
+#include "Dom/JsonObject.h"
+#include "Particles/ParticleSystemComponent.h"
+#include "Components/DecalComponent.h"
+#include "UObject/UObjectArray.h"
+#include "UObject/UObjectIterator.h"
+#include "Enemy.h"
+#include "Weapon.h"
+#include "ShooterCharacter.h"
+#include "ShooterLLM.h"
+
+static TAutoConsoleVariable<float> CVarSoakSampleInterval(
+	TEXT("Shooter.Soak.SampleInterval"),
+	60.f,
+	TEXT("Seconds between soak samples"));
+
+static TAutoConsoleVariable<int32> CVarSoakTrendWindow(
+	TEXT("Shooter.Soak.TrendWindow"),
+	10,
+	TEXT("A series that never goes down over this many samples and ends higher is flagged as growing"));
+
+static TAutoConsoleVariable<float> CVarSoakActionInterval(
+	TEXT("Shooter.Soak.ActionInterval"),
+	0.5f,
+	TEXT("Seconds the soak bot waits between actions"));
+
+static FAutoConsoleCommandWithWorldAndArgs SoakStartCommand(
+	TEXT("Shooter.Soak.Start"),
+	TEXT("Shooter.Soak.Start [Hours=1]. Runs the soak bot on the local character"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UShooterSoakSubsystem* Soak = World ? World->GetSubsystem<UShooterSoakSubsystem>() : nullptr;
+		if (Soak)
+		{
+			Soak->StartSoak(Args.Num() > 0 ? FCString::Atof(*Args[0]) : 1.f);
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld SoakStopCommand(
+	TEXT("Shooter.Soak.Stop"),
+	TEXT("Stops the soak bot and writes the trend report to Saved/Soak"),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		UShooterSoakSubsystem* Soak = World ? World->GetSubsystem<UShooterSoakSubsystem>() : nullptr;
+		if (Soak)
+		{
+			Soak->StopSoak();
+		}
+	}));
+
+namespace ShooterSoak
+{
+	/* A value tracked over the soak */
+	struct FSeries
+	{
+		const TCHAR* Name;
+		double (*Value)(const FSoakSample& Sample);
+	};
+
+	const FSeries Series[] =
+	{
+		{ TEXT("Objects"), [](const FSoakSample& Sample) { return static_cast<double>(Sample.Objects); } },
+		{ TEXT("MemoryMB"), [](const FSoakSample& Sample) { return Sample.MemoryMB; } },
+		{ TEXT("HitNumbers"), [](const FSoakSample& Sample) { return static_cast<double>(Sample.HitNumbers); } },
+		{ TEXT("Emitters"), [](const FSoakSample& Sample) { return static_cast<double>(Sample.Emitters); } },
+		{ TEXT("Decals"), [](const FSoakSample& Sample) { return static_cast<double>(Sample.Decals); } },
+		{ TEXT("DroppedWeapons"), [](const FSoakSample& Sample) { return static_cast<double>(Sample.DroppedWeapons); } },
+		{ TEXT("Actors"), [](const FSoakSample& Sample) { return static_cast<double>(Sample.Actors); } },
+		{ TEXT("FrameMsP95"), [](const FSoakSample& Sample) { return static_cast<double>(Sample.FrameMsP95); } },
+	};
+
+	/* Pickups further away than this are ignored, the bot doesn't walk */
+	constexpr float PickupRange = 2000.f;
+
+	/* Least squares slope of the series over all samples, per hour */
+	double GetSlopePerHour(const TArray<FSoakSample>& Samples, const FSeries& InSeries)
+	{
+		if (Samples.Num() < 2) return 0.0;
+
+		double SumX{ 0.0 }, SumY{ 0.0 }, SumXY{ 0.0 }, SumXX{ 0.0 };
+		for (const FSoakSample& Sample : Samples)
+		{
+			const double X{ Sample.ElapsedSeconds / 3600.0 };
+			const double Y{ InSeries.Value(Sample) };
+			SumX += X;
+			SumY += Y;
+			SumXY += X * Y;
+			SumXX += X * X;
+		}
+		const double Denominator{ Samples.Num() * SumXX - SumX * SumX };
+		return FMath::IsNearlyZero(Denominator) ? 0.0 : (Samples.Num() * SumXY - SumX * SumY) / Denominator;
+	}
+}
+
+void UShooterSoakSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	if (!IsInGameWorld()) return;
+
+	float Hours{ 0.f };
+	if (FParse::Value(FCommandLine::Get(), TEXT("ShooterSoak="), Hours))
+	{
+		bExitWhenDone = true;
+		StartSoak(Hours);
+	}
+}
+
+void UShooterSoakSubsystem::Deinitialize()
+{
+	if (Mode == ESoakMode::Running)
+	{
+		StopSoak();
+	}
+	Mode = ESoakMode::None;
+
+	Super::Deinitialize();
+}
+
+TStatId UShooterSoakSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UShooterSoakSubsystem, STATGROUP_Tickables);
+}
+
+void UShooterSoakSubsystem::StartSoak(float Hours)
+{
+	if (Mode != ESoakMode::None)
+	{
+		UE_LOG(LogShooter, Warning, TEXT("Soak bot is already running"));
+		return;
+	}
+
+	EndTime = FMath::Max(Hours, 0.f) * 3600.0;
+	Mode = ESoakMode::Pending;
+}
+
+void UShooterSoakSubsystem::Tick(float DeltaTime)
+{
+	switch (Mode)
+	{
+	case ESoakMode::Pending:
+		if (GetReadyLocalCharacter())
+		{
+			const double Now{ FPlatformTime::Seconds() };
+			StartTime = Now;
+			EndTime += Now;
+			NextSampleTime = Now;
+			NextActionTime = Now;
+			FireReleaseTime = 0.0;
+			LastFrameTime = Now;
+			FrameMs.Reset();
+			Samples.Reset();
+			RandomStream.Initialize(FCrc::StrCrc32(*FDateTime::Now().ToString()));
+
+			Mode = ESoakMode::Running;
+			UE_LOG(LogShooter, Log, TEXT("Soak bot running for %.1f hours, seed %d"), (EndTime - StartTime) / 3600.0, RandomStream.GetInitialSeed());
+		}
+		break;
+
+	case ESoakMode::Running:
+		{
+			const double Now{ FPlatformTime::Seconds() };
+			FrameMs.AddSample(static_cast<float>((Now - LastFrameTime) * 1000.0));
+			LastFrameTime = Now;
+
+			AShooterCharacter* Character = GetLocalCharacter();
+			if (Character)
+			{
+				RunBot(Character, Now);
+			}
+
+			if (Now >= NextSampleTime)
+			{
+				TakeSample(Now);
+				NextSampleTime = Now + FMath::Max(CVarSoakSampleInterval.GetValueOnGameThread(), 1.f);
+			}
+
+			if (Now >= EndTime)
+			{
+				StopSoak();
+			}
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+void UShooterSoakSubsystem::RunBot(AShooterCharacter* Character, double Now)
+{
+	if (FireReleaseTime > 0.0)
+	{
+		if (Now < FireReleaseTime) return;
+
+		Character->ScriptedFire(false);
+		FireReleaseTime = 0.0;
+	}
+
+	if (Now < NextActionTime || Character->GetCombatState() != ECombatState::ECS_Unoccupied) return;
+	NextActionTime = Now + CVarSoakActionInterval.GetValueOnGameThread();
+
+	AWeapon* Weapon = Character->GetEquippedWeapon();
+	if (Weapon == nullptr) return;
+
+	// Hours of automatic fire would run dry, keep enough for the bot to reload
+	if (Character->GetCarriedAmmo(Weapon->GetAmmoType()) < Weapon->GetMagazineCapacity())
+	{
+		Character->ScriptedRefillAmmo();
+	}
+
+	const ESoakAction Action{ static_cast<ESoakAction>(RandomStream.RandRange(0, static_cast<int32>(ESoakAction::MAX) - 1)) };
+	switch (Action)
+	{
+	case ESoakAction::Fire:
+		StartFiring(Character, Now);
+		break;
+
+	case ESoakAction::Aim:
+		Character->ScriptedAim(!Character->GetAiming());
+		break;
+
+	case ESoakAction::Reload:
+		Character->ScriptedReload();
+		break;
+
+	case ESoakAction::Pickup:
+		PickUpWeapon(Character);
+		break;
+
+	case ESoakAction::Swap:
+		if (Character->GetInventory().Num() > 1)
+		{
+			Character->ScriptedSelectSlot(RandomStream.RandRange(0, Character->GetInventory().Num() - 1));
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+void UShooterSoakSubsystem::StartFiring(AShooterCharacter* Character, double Now)
+{
+	APlayerController* PlayerController = Cast<APlayerController>(Character->GetController());
+	if (PlayerController == nullptr) return;
+
+	// Shoot at the nearest live enemy so hit numbers, hit reacts and deaths get exercised, otherwise somewhere new
+	const AEnemy* Target{ nullptr };
+	float TargetDistSquared{ TNumericLimits<float>::Max() };
+	for (TActorIterator<AEnemy> It(GetWorld()); It; ++It)
+	{
+		if (It->IsDying() || It->IsHidden()) continue;
+
+		const float DistSquared{ FVector::DistSquared(It->GetActorLocation(), Character->GetActorLocation()) };
+		if (DistSquared < TargetDistSquared)
+		{
+			Target = *It;
+			TargetDistSquared = DistSquared;
+		}
+	}
+
+	FRotator Aim{ PlayerController->GetControlRotation() };
+	if (Target)
+	{
+		Aim = (Target->GetActorLocation() - Character->GetFollowCamera()->GetComponentLocation()).Rotation();
+	}
+	else
+	{
+		Aim.Yaw += RandomStream.FRandRange(-90.f, 90.f);
+		Aim.Pitch = RandomStream.FRandRange(-10.f, 10.f);
+	}
+	PlayerController->SetControlRotation(Aim);
+
+	Character->ScriptedFire(true);
+	FireReleaseTime = Now + RandomStream.FRandRange(0.2f, 2.f);
+}
+
+void UShooterSoakSubsystem::PickUpWeapon(AShooterCharacter* Character)
+{
+	int32 NumGroundWeapons{ 0 };
+	AWeapon* GroundWeapon = FindGroundWeapon(Character, NumGroundWeapons);
+
+	if (GroundWeapon == nullptr)
+	{
+		// Only top up, the dropped weapons count is one of the series we watch
+		UClass* Class = WeaponClass.LoadSynchronous();
+		if (Class == nullptr || NumGroundWeapons >= MaxGroundWeapons) return;
+
+		SHOOTER_LLM_SCOPE(Items);
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		const FVector Location{ Character->GetActorLocation() + Character->GetActorForwardVector() * 200.f };
+		GroundWeapon = GetWorld()->SpawnActor<AWeapon>(Class, Location, FRotator::ZeroRotator, SpawnParams);
+		if (GroundWeapon == nullptr) return;
+	}
+
+	// The same curve as a player pickup. With a full inventory it ends in a swap that drops the equipped weapon
+	GroundWeapon->StartItemCurve(Character);
+}
+
+AWeapon* UShooterSoakSubsystem::FindGroundWeapon(const AShooterCharacter* Character, int32& OutNumGroundWeapons) const
+{
+	OutNumGroundWeapons = 0;
+
+	AWeapon* Nearest{ nullptr };
+	float NearestDistSquared{ FMath::Square(ShooterSoak::PickupRange) };
+	for (TActorIterator<AWeapon> It(GetWorld()); It; ++It)
+	{
+		const EItemState State{ It->GetItemState() };
+		if (State != EItemState::EIS_Pickup && State != EItemState::EIS_Falling) continue;
+
+		++OutNumGroundWeapons;
+
+		const float DistSquared{ FVector::DistSquared(It->GetActorLocation(), Character->GetActorLocation()) };
+		if (State == EItemState::EIS_Pickup && DistSquared < NearestDistSquared)
+		{
+			Nearest = *It;
+			NearestDistSquared = DistSquared;
+		}
+	}
+	return Nearest;
+}
+
+void UShooterSoakSubsystem::TakeSample(double Now)
+{
+	UWorld* World = GetWorld();
+
+	FSoakSample& Sample = Samples.AddDefaulted_GetRef();
+	Sample.ElapsedSeconds = Now - StartTime;
+	Sample.Objects = GUObjectArray.GetObjectArrayNumMinusAvailable();
+	Sample.MemoryMB = FPlatformMemory::GetStats().UsedPhysical / (1024.0 * 1024.0);
+	Sample.FrameMsAverage = FrameMs.GetAverage();
+	Sample.FrameMsP95 = FrameMs.GetPercentile(95.f);
+	FrameMs.Reset();
+
+	for (TActorIterator<AEnemy> It(World); It; ++It)
+	{
+		Sample.HitNumbers += It->GetNumHitNumbers();
+	}
+
+	for (TActorIterator<AWeapon> It(World); It; ++It)
+	{
+		const EItemState State{ It->GetItemState() };
+		if (State == EItemState::EIS_Pickup || State == EItemState::EIS_Falling)
+		{
+			++Sample.DroppedWeapons;
+		}
+	}
+
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		++Sample.Actors;
+	}
+
+	// Once a minute, walking every object is cheap enough
+	for (TObjectIterator<UParticleSystemComponent> It; It; ++It)
+	{
+		if (It->GetWorld() == World && !It->IsPendingKill())
+		{
+			++Sample.Emitters;
+		}
+	}
+	for (TObjectIterator<UDecalComponent> It; It; ++It)
+	{
+		if (It->GetWorld() == World && !It->IsPendingKill())
+		{
+			++Sample.Decals;
+		}
+	}
+
+	UE_LOG(LogShooter, Log, TEXT("Soak %.0f min: objects %d, memory %.1f MB, hit numbers %d, emitters %d, decals %d, dropped weapons %d, actors %d, frame ms avg %.2f p95 %.2f"),
+		Sample.ElapsedSeconds / 60.0, Sample.Objects, Sample.MemoryMB, Sample.HitNumbers, Sample.Emitters, Sample.Decals,
+		Sample.DroppedWeapons, Sample.Actors, Sample.FrameMsAverage, Sample.FrameMsP95);
+}
+
+void UShooterSoakSubsystem::StopSoak()
+{
+	if (Mode == ESoakMode::None) return;
+
+	const bool bWasRunning{ Mode == ESoakMode::Running };
+	Mode = ESoakMode::None;
+	if (!bWasRunning) return;
+
+	AShooterCharacter* Character = GetLocalCharacter();
+	if (Character)
+	{
+		Character->ScriptedFire(false);
+	}
+
+	TakeSample(FPlatformTime::Seconds());
+
+	TArray<FString> Growing;
+	FindGrowingSeries(Growing);
+	for (const FString& Name : Growing)
+	{
+		UE_LOG(LogShooter, Warning, TEXT("Soak: %s grew over the last %d samples"), *Name, CVarSoakTrendWindow.GetValueOnGameThread());
+	}
+
+	const FString ReportPath{ WriteReport(Growing) };
+	UE_LOG(LogShooter, Log, TEXT("Soak finished after %.1f hours, %d growing series, report written to %s"),
+		(FPlatformTime::Seconds() - StartTime) / 3600.0, Growing.Num(), *ReportPath);
+
+	if (bExitWhenDone)
+	{
+		FPlatformMisc::RequestExitWithStatus(false, Growing.Num() > 0 ? 1 : 0);
+	}
+}
+
+void UShooterSoakSubsystem::FindGrowingSeries(TArray<FString>& OutGrowing) const
+{
+	const int32 Window{ FMath::Max(CVarSoakTrendWindow.GetValueOnGameThread(), 2) };
+	if (Samples.Num() < Window) return;
+
+	const int32 First{ Samples.Num() - Window };
+	for (const ShooterSoak::FSeries& Series : ShooterSoak::Series)
+	{
+		bool bNeverDecreased{ true };
+		for (int32 Index = First + 1; Index < Samples.Num() && bNeverDecreased; ++Index)
+		{
+			bNeverDecreased = Series.Value(Samples[Index]) >= Series.Value(Samples[Index - 1]);
+		}
+
+		if (bNeverDecreased && Series.Value(Samples.Last()) > Series.Value(Samples[First]))
+		{
+			OutGrowing.Add(Series.Name);
+		}
+	}
+}
+
+FString UShooterSoakSubsystem::WriteReport(const TArray<FString>& Growing) const
+{
+	TSharedRef<FJsonObject> Report = MakeShared<FJsonObject>();
+	Report->SetStringField(TEXT("map"), GetWorld()->GetMapName());
+	Report->SetStringField(TEXT("time"), FDateTime::UtcNow().ToIso8601());
+	Report->SetNumberField(TEXT("seed"), RandomStream.GetInitialSeed());
+	Report->SetNumberField(TEXT("hours"), Samples.Num() > 0 ? Samples.Last().ElapsedSeconds / 3600.0 : 0.0);
+	Report->SetBoolField(TEXT("passed"), Growing.Num() == 0);
+
+	TArray<TSharedPtr<FJsonValue>> Trends;
+	for (const ShooterSoak::FSeries& Series : ShooterSoak::Series)
+	{
+		TSharedRef<FJsonObject> Trend = MakeShared<FJsonObject>();
+		Trend->SetStringField(TEXT("name"), Series.Name);
+		Trend->SetNumberField(TEXT("first"), Samples.Num() > 0 ? Series.Value(Samples[0]) : 0.0);
+		Trend->SetNumberField(TEXT("last"), Samples.Num() > 0 ? Series.Value(Samples.Last()) : 0.0);
+		Trend->SetNumberField(TEXT("slopePerHour"), ShooterSoak::GetSlopePerHour(Samples, Series));
+		Trend->SetBoolField(TEXT("growing"), Growing.Contains(Series.Name));
+		Trends.Add(MakeShared<FJsonValueObject>(Trend));
+	}
+	Report->SetArrayField(TEXT("trends"), Trends);
+
+	// One row per sample in the same order as the trends, keeps multi-hour reports small
+	TArray<TSharedPtr<FJsonValue>> Rows;
+	for (const FSoakSample& Sample : Samples)
+	{
+		TArray<TSharedPtr<FJsonValue>> Row;
+		Row.Add(MakeShared<FJsonValueNumber>(Sample.ElapsedSeconds));
+		for (const ShooterSoak::FSeries& Series : ShooterSoak::Series)
+		{
+			Row.Add(MakeShared<FJsonValueNumber>(Series.Value(Sample)));
+		}
+		Rows.Add(MakeShared<FJsonValueArray>(Row));
+	}
+	Report->SetArrayField(TEXT("samples"), Rows);
+
+	const FString ReportPath{ FPaths::ProjectSavedDir() / TEXT("Soak") / FString::Printf(TEXT("ShooterSoak-%s.json"), *FDateTime::Now().ToString()) };
+	WriteJsonReport(Report, ReportPath);
+	return ReportPath;
+}
@@ -0,0 +1,135 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ShooterTickableWorldSubsystem.h"
+#include "PercentileSampler.h"
+#include "ShooterSoakSubsystem.generated.h"
+
+class AWeapon;
+class AShooterCharacter;
+
+/* Everything the soak bot watches, taken every Shooter.Soak.SampleInterval seconds */
+struct FSoakSample
+{
+	double ElapsedSeconds = 0.0;
+
+	int32 Objects = 0;
+	double MemoryMB = 0.0;
+
+	/* Sum of AEnemy::HitNumbers over all enemies */
+	int32 HitNumbers = 0;
+
+	/* Live particle system components in the world */
+	int32 Emitters = 0;
+
+	/* Live decal components in the world */
+	int32 Decals = 0;
+
+	/* Weapons lying in the world rather than held by the character */
+	int32 DroppedWeapons = 0;
+
+	int32 Actors = 0;
+
+	float FrameMsAverage = 0.f;
+	float FrameMsP95 = 0.f;
+};
+
+/**
+ * Soak bot: drives the local character through fire, aim, reload, pickup, swap and drop cycles for hours,
+ * e.g. -game -nullrhi -unattended -ShooterSoak=8 for eight hours. It samples object counts, memory, gameplay
+ * containers and frame time, flags series that only ever grow and writes a trend report to Saved/Soak.
+ */
+UCLASS(Config = Game)
+class SHOOTER_API UShooterSoakSubsystem : public UShooterTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/* FTickableGameObject interface */
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/* Starts the bot once the local player has a pawn, runs for Hours of wall time */
+	void StartSoak(float Hours);
+
+	/* Stops the bot and writes the trend report */
+	void StopSoak();
+
+	FORCEINLINE bool IsSoaking() const { return Mode != ESoakMode::None; }
+
+private:
+
+	enum class ESoakMode : uint8
+	{
+		None,
+		Pending,
+		Running
+	};
+
+	enum class ESoakAction : uint8
+	{
+		Fire,
+		Aim,
+		Reload,
+		Pickup,
+		Swap,
+
+		MAX
+	};
+
+	/* Picks and starts the bot's next action */
+	void RunBot(AShooterCharacter* Character, double Now);
+
+	void StartFiring(AShooterCharacter* Character, double Now);
+	void PickUpWeapon(AShooterCharacter* Character);
+
+	/* Nearest weapon lying in the world within reach, nullptr if none */
+	AWeapon* FindGroundWeapon(const AShooterCharacter* Character, int32& OutNumGroundWeapons) const;
+
+	void TakeSample(double Now);
+
+	/* Series that never went down over the last TrendWindow samples and ended higher */
+	void FindGrowingSeries(TArray<FString>& OutGrowing) const;
+
+	/* Writes the report, returns the path written to */
+	FString WriteReport(const TArray<FString>& Growing) const;
+
+	/* Spawned next to the character when there is nothing on the ground to pick up */
+	UPROPERTY(Config)
+	TSoftClassPtr<AWeapon> WeaponClass;
+
+	/* The bot stops spawning weapons once this many lie in the world */
+	UPROPERTY(Config)
+	int32 MaxGroundWeapons = 4;
+
+	ESoakMode Mode = ESoakMode::None;
+
+	/* Wall time the soak started and ends, FPlatformTime::Seconds */
+	double StartTime = 0.0;
+	double EndTime = 0.0;
+
+	double NextSampleTime = 0.0;
+	double NextActionTime = 0.0;
+
+	/* When the current burst ends, 0 when not firing */
+	double FireReleaseTime = 0.0;
+
+	double LastFrameTime = 0.0;
+
+	/* Frame time since the last sample, in ms */
+	FPercentileSampler FrameMs{ 16384 };
+
+	TArray<FSoakSample> Samples;
+
+	/* Seeded once per soak so a run can be repeated */
+	FRandomStream RandomStream;
+
+	/* Quit once the soak is done, for soaks started from the command line */
+	bool bExitWhenDone = false;
+};
@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterSpread.h"
+#include "Math/RandomStream.h"
+
+namespace ShooterSpread
+{
+	uint8 QuantizeSpread(float SpreadMultiplier)
+	{
+		return static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(SpreadMultiplier / SpreadStep), 0, 255));
+	}
+
+	void BuildRecoilOffsets(const TArray<FVector2D>& Pattern, TArray<FVector2D>& OutOffsets)
+	{
+		OutOffsets.Reset(Pattern.Num() + 1);
+		if (Pattern.Num() == 0) return;
+
+		FVector2D Offset{ FVector2D::ZeroVector };
+		OutOffsets.Add(Offset);
+		for (const FVector2D& Kick : Pattern)
+		{
+			Offset += Kick;
+			OutOffsets.Add(Offset);
+		}
+	}
+
+	FRotator GetShotOffset(const TArray<FVector2D>& RecoilOffsets, float SpreadDegrees, int32 Seed, uint32 Seq, uint8 BurstIndex, uint8 QuantizedSpread)
+	{
+		FRotator Offset{ FRotator::ZeroRotator };
+		if (RecoilOffsets.Num() > 0)
+		{
+			const FVector2D& Recoil = RecoilOffsets[FMath::Min<int32>(BurstIndex, RecoilOffsets.Num() - 1)];
+			Offset.Pitch = Recoil.X;
+			Offset.Yaw = Recoil.Y;
+		}
+
+		const float ConeDegrees{ SpreadDegrees * DequantizeSpread(QuantizedSpread) };
+		if (ConeDegrees > 0.f)
+		{
+			// A fresh stream per shot, so a lost or rejected shot can't shift the ones after it.
+			// The square root spreads the points evenly over the cone instead of bunching them in the middle
+			FRandomStream Stream(static_cast<int32>(HashCombine(static_cast<uint32>(Seed), Seq)));
+			const float Radius{ ConeDegrees * FMath::Sqrt(Stream.GetFraction()) };
+			const float Angle{ 2.f * PI * Stream.GetFraction() };
+			Offset.Pitch += Radius * FMath::Sin(Angle);
+			Offset.Yaw += Radius * FMath::Cos(Angle);
+		}
+		return Offset;
+	}
+}
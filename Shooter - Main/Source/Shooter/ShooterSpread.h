@@ -0,0 +1,29 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+namespace ShooterSpread
+{
+	/* Spread multipliers travel with a shot in steps of 1/32, up to a multiplier of almost 8 */
+	constexpr float SpreadStep = 1.f / 32.f;
+
+	SHOOTER_API uint8 QuantizeSpread(float SpreadMultiplier);
+
+	FORCEINLINE float DequantizeSpread(uint8 QuantizedSpread) { return QuantizedSpread * SpreadStep; }
+
+	/**
+	 * Turns a per-shot kick pattern into the offset of every shot of a burst: the first shot has none,
+	 * each later one the sum of the kicks before it. Built once per weapon type, a shot then only looks its offset up.
+	 */
+	SHOOTER_API void BuildRecoilOffsets(const TArray<FVector2D>& Pattern, TArray<FVector2D>& OutOffsets);
+
+	/**
+	 * Pitch and yaw in degrees to add to the view rotation of one shot: the recoil offset at BurstIndex, a burst longer
+	 * than the pattern holding its last one, plus a point in the spread cone drawn from a stream seeded by Seed and Seq.
+	 * Seq is the full count of shots fired, not the byte sent, so the pattern doesn't repeat every 256 shots.
+	 * Takes only what both ends of a predicted shot know, so the client and the server get the same offset.
+	 */
+	SHOOTER_API FRotator GetShotOffset(const TArray<FVector2D>& RecoilOffsets, float SpreadDegrees, int32 Seed, uint32 Seq, uint8 BurstIndex, uint8 QuantizedSpread);
+}
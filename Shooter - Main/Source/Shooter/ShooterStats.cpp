@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterStats.h"
+
+DEFINE_STAT(STAT_ShooterSendBullet);
+DEFINE_STAT(STAT_ShooterTraceUnderCrosshairs);
+DEFINE_STAT(STAT_ShooterTraceForItems);
+DEFINE_STAT(STAT_ShooterSetItemProperties);
+DEFINE_STAT(STAT_ShooterItemInterp);
+DEFINE_STAT(STAT_ShooterUpdateAnimationProperties);
+DEFINE_STAT(STAT_ShooterTurnInPlace);
+DEFINE_STAT(STAT_ShooterEnemyTakeDamage);
+DEFINE_STAT(STAT_ShooterExplosion);
+DEFINE_STAT(STAT_ShooterCombatStep);
+
+DEFINE_STAT(STAT_ShooterShots);
+DEFINE_STAT(STAT_ShooterTraces);
+DEFINE_STAT(STAT_ShooterInterpingItems);
+DEFINE_STAT(STAT_ShooterLiveHitNumbers);
+
+CSV_DEFINE_CATEGORY_MODULE(SHOOTER_API, Shooter, true);
+
+namespace ShooterStats
+{
+	static int32 InterpingItems = 0;
+	static int32 LiveHitNumbers = 0;
+	static int32 SnapshotShots = 0;
+	static int32 SnapshotTraces = 0;
+
+	void AddShots(int32 Count)
+	{
+		INC_DWORD_STAT_BY(STAT_ShooterShots, Count);
+		SnapshotShots += Count;
+		CSV_CUSTOM_STAT(Shooter, Shots, Count, ECsvCustomStatOp::Accumulate);
+	}
+
+	void AddTraces(int32 Count)
+	{
+		INC_DWORD_STAT_BY(STAT_ShooterTraces, Count);
+		SnapshotTraces += Count;
+		CSV_CUSTOM_STAT(Shooter, Traces, Count, ECsvCustomStatOp::Accumulate);
+	}
+
+	void AddInterpingItems(int32 Delta)
+	{
+		InterpingItems = FMath::Max(InterpingItems + Delta, 0);
+		SET_DWORD_STAT(STAT_ShooterInterpingItems, InterpingItems);
+	}
+
+	void AddLiveHitNumbers(int32 Delta)
+	{
+		LiveHitNumbers = FMath::Max(LiveHitNumbers + Delta, 0);
+		SET_DWORD_STAT(STAT_ShooterLiveHitNumbers, LiveHitNumbers);
+	}
+
+	void RecordFrame()
+	{
+		CSV_CUSTOM_STAT(Shooter, InterpingItems, InterpingItems, ECsvCustomStatOp::Set);
+		CSV_CUSTOM_STAT(Shooter, LiveHitNumbers, LiveHitNumbers, ECsvCustomStatOp::Set);
+	}
+
+	FCounterSnapshot TakeCounterSnapshot()
+	{
+		FCounterSnapshot Snapshot;
+		Snapshot.Shots = SnapshotShots;
+		Snapshot.Traces = SnapshotTraces;
+		Snapshot.InterpingItems = InterpingItems;
+		Snapshot.LiveHitNumbers = LiveHitNumbers;
+
+		SnapshotShots = 0;
+		SnapshotTraces = 0;
+		return Snapshot;
+	}
+}
@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+/* Gameplay hot paths. "stat Shooter" in game, the Shooter category in CSV captures (csvprofile start / -csvCaptureFrames) */
+DECLARE_STATS_GROUP(TEXT("Shooter"), STATGROUP_Shooter, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("SendBullet"), STAT_ShooterSendBullet, STATGROUP_Shooter, SHOOTER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("TraceUnderCrosshairs"), STAT_ShooterTraceUnderCrosshairs, STATGROUP_Shooter, SHOOTER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("TraceForItems"), STAT_ShooterTraceForItems, STATGROUP_Shooter, SHOOTER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("SetItemProperties"), STAT_ShooterSetItemProperties, STATGROUP_Shooter, SHOOTER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("ItemInterp"), STAT_ShooterItemInterp, STATGROUP_Shooter, SHOOTER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UpdateAnimationProperties"), STAT_ShooterUpdateAnimationProperties, STATGROUP_Shooter, SHOOTER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("TurnInPlace"), STAT_ShooterTurnInPlace, STATGROUP_Shooter, SHOOTER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Enemy TakeDamage"), STAT_ShooterEnemyTakeDamage, STATGROUP_Shooter, SHOOTER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Explosion"), STAT_ShooterExplosion, STATGROUP_Shooter, SHOOTER_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("CombatStep"), STAT_ShooterCombatStep, STATGROUP_Shooter, SHOOTER_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shots"), STAT_ShooterShots, STATGROUP_Shooter, SHOOTER_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Traces"), STAT_ShooterTraces, STATGROUP_Shooter, SHOOTER_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Interping items"), STAT_ShooterInterpingItems, STATGROUP_Shooter, SHOOTER_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Live hit numbers"), STAT_ShooterLiveHitNumbers, STATGROUP_Shooter, SHOOTER_API);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(SHOOTER_API, Shooter);
+
+/* Counters that go to both the stat group and the CSV category */
+namespace ShooterStats
+{
+	/* Per frame counts */
+	SHOOTER_API void AddShots(int32 Count = 1);
+	SHOOTER_API void AddTraces(int32 Count = 1);
+
+	/* Running totals, sampled into the CSV once per frame by RecordFrame */
+	SHOOTER_API void AddInterpingItems(int32 Delta);
+	SHOOTER_API void AddLiveHitNumbers(int32 Delta);
+
+	/* Writes the running totals for this frame. Safe to call more than once a frame */
+	SHOOTER_API void RecordFrame();
+
+	struct FCounterSnapshot
+	{
+		/* Since the previous snapshot */
+		int32 Shots = 0;
+		int32 Traces = 0;
+
+		/* Running totals */
+		int32 InterpingItems = 0;
+		int32 LiveHitNumbers = 0;
+	};
+
+	/* Shots and traces since the previous call, which are then reset. Taken once a frame by the hitch monitor */
+	SHOOTER_API FCounterSnapshot TakeCounterSnapshot();
+}
@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterTickableWorldSubsystem.h"
+#include "Shooter.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Misc/FileHelper.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+#include "ShooterCharacter.h"
+
+bool UShooterTickableWorldSubsystem::IsTickable() const
+{
+	// The CDO is registered as a tickable too, only tick the instance owned by a game world
+	return !IsTemplate() && IsInGameWorld();
+}
+
+bool UShooterTickableWorldSubsystem::IsInGameWorld() const
+{
+	const UWorld* World = GetWorld();
+	return World && World->IsGameWorld();
+}
+
+APlayerController* UShooterTickableWorldSubsystem::GetLocalPlayerController() const
+{
+	UWorld* World = GetWorld();
+	APlayerController* PlayerController = World ? World->GetFirstPlayerController() : nullptr;
+	return PlayerController && PlayerController->IsLocalController() ? PlayerController : nullptr;
+}
+
+AShooterCharacter* UShooterTickableWorldSubsystem::GetLocalCharacter() const
+{
+	const APlayerController* PlayerController = GetLocalPlayerController();
+	return PlayerController ? Cast<AShooterCharacter>(PlayerController->GetPawn()) : nullptr;
+}
+
+AShooterCharacter* UShooterTickableWorldSubsystem::GetReadyLocalCharacter() const
+{
+	AShooterCharacter* Character = GetLocalCharacter();
+	return Character && Character->GetEquippedWeapon() ? Character : nullptr;
+}
+
+bool UShooterTickableWorldSubsystem::WriteJsonReport(const TSharedRef<FJsonObject>& Report, const FString& Path)
+{
+	FString Output;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	FJsonSerializer::Serialize(Report, Writer);
+
+	if (!FFileHelper::SaveStringToFile(Output, *Path))
+	{
+		UE_LOG(LogShooter, Warning, TEXT("Could not write report to %s"), *Path);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,46 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "ShooterTickableWorldSubsystem.generated.h"
+
+class APlayerController;
+class AShooterCharacter;
+class FJsonObject;
+
+/**
+ * World subsystem ticked once a frame, in game worlds only. Derived classes implement Tick and GetStatId.
+ * Also has what the scripted runs (perf scenarios, soak bot, replays) share: finding the local player and writing reports.
+ */
+UCLASS(Abstract)
+class SHOOTER_API UShooterTickableWorldSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+
+	/* FTickableGameObject interface */
+	virtual void Tick(float DeltaTime) override PURE_VIRTUAL(UShooterTickableWorldSubsystem::Tick, );
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override PURE_VIRTUAL(UShooterTickableWorldSubsystem::GetStatId, return TStatId(););
+	virtual UWorld* GetTickableGameObjectWorld() const override { return GetWorld(); }
+
+protected:
+
+	/* False for the editor world and the CDO, which get subsystems too */
+	bool IsInGameWorld() const;
+
+	/* The first player controller if it is local, nullptr on a dedicated server */
+	APlayerController* GetLocalPlayerController() const;
+
+	AShooterCharacter* GetLocalCharacter() const;
+
+	/* The local character once it has its default weapon, which is what scripted runs wait for */
+	AShooterCharacter* GetReadyLocalCharacter() const;
+
+	/* Serializes Report to Path, logs a warning and returns false if it can't be written */
+	static bool WriteJsonReport(const TSharedRef<FJsonObject>& Report, const FString& Path);
+};
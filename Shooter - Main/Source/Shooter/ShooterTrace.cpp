@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterTrace.h"
+
+#if SHOOTER_TRACE_ENABLED
+
+#include "Enemy.h"
+#include "Item.h"
+#include "Weapon.h"
+
+UE_TRACE_CHANNEL(ShooterChannel);
+
+UE_TRACE_EVENT_BEGIN(Shooter, Fire)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ShooterId)
+	UE_TRACE_EVENT_FIELD(uint8, WeaponType)
+	UE_TRACE_EVENT_FIELD(int32, Ammo)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(Shooter, Hit)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ShooterId)
+	UE_TRACE_EVENT_FIELD(uint32, TargetId)
+	UE_TRACE_EVENT_FIELD(float, Damage)
+	UE_TRACE_EVENT_FIELD(uint8, bHeadShot)
+	UE_TRACE_EVENT_FIELD(float, LatencyMs)
+	UE_TRACE_EVENT_FIELD(Trace::WideString, Bone)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(Shooter, ReloadStart)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ShooterId)
+	UE_TRACE_EVENT_FIELD(uint8, WeaponType)
+	UE_TRACE_EVENT_FIELD(int32, Ammo)
+	UE_TRACE_EVENT_FIELD(int32, CarriedAmmo)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(Shooter, ReloadEnd)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ShooterId)
+	UE_TRACE_EVENT_FIELD(uint8, WeaponType)
+	UE_TRACE_EVENT_FIELD(int32, Ammo)
+	UE_TRACE_EVENT_FIELD(int32, CarriedAmmo)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(Shooter, Swap)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ShooterId)
+	UE_TRACE_EVENT_FIELD(int8, FromSlot)
+	UE_TRACE_EVENT_FIELD(int8, ToSlot)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(Shooter, ItemCurve)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, ItemId)
+	UE_TRACE_EVENT_FIELD(uint8, bStart)
+	UE_TRACE_EVENT_FIELD(uint8, ItemState)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(Shooter, EnemyDie)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint32, EnemyId)
+	UE_TRACE_EVENT_FIELD(float, Health)
+UE_TRACE_EVENT_END()
+
+namespace ShooterTrace
+{
+	// Object unique IDs tie events about the same actor together, 0 for none
+	static uint32 GetId(const UObject* Object)
+	{
+		return Object ? Object->GetUniqueID() : 0;
+	}
+
+	void Fire(const AActor* Shooter, const AWeapon* Weapon)
+	{
+		UE_TRACE_LOG(Shooter, Fire, ShooterChannel)
+			<< Fire.Cycle(FPlatformTime::Cycles64())
+			<< Fire.ShooterId(GetId(Shooter))
+			<< Fire.WeaponType(Weapon ? static_cast<uint8>(Weapon->GetWeaponType()) : 0)
+			<< Fire.Ammo(Weapon ? Weapon->GetAmmo() : 0);
+	}
+
+	void Hit(const AActor* Shooter, const AActor* Target, FName Bone, float Damage, bool bHeadShot, double ShotInputTime)
+	{
+		if (!UE_TRACE_CHANNELEXPR_IS_ENABLED(ShooterChannel)) return;
+
+		const FString BoneName{ Bone.ToString() };
+		UE_TRACE_LOG(Shooter, Hit, ShooterChannel, BoneName.Len() * sizeof(TCHAR))
+			<< Hit.Cycle(FPlatformTime::Cycles64())
+			<< Hit.ShooterId(GetId(Shooter))
+			<< Hit.TargetId(GetId(Target))
+			<< Hit.Damage(Damage)
+			<< Hit.bHeadShot(bHeadShot ? 1 : 0)
+			<< Hit.LatencyMs(ShotInputTime > 0.0 ? static_cast<float>((FPlatformTime::Seconds() - ShotInputTime) * 1000.0) : -1.f)
+			<< Hit.Bone(*BoneName, BoneName.Len());
+	}
+
+	void ReloadStart(const AActor* Shooter, const AWeapon* Weapon, int32 CarriedAmmo)
+	{
+		UE_TRACE_LOG(Shooter, ReloadStart, ShooterChannel)
+			<< ReloadStart.Cycle(FPlatformTime::Cycles64())
+			<< ReloadStart.ShooterId(GetId(Shooter))
+			<< ReloadStart.WeaponType(Weapon ? static_cast<uint8>(Weapon->GetWeaponType()) : 0)
+			<< ReloadStart.Ammo(Weapon ? Weapon->GetAmmo() : 0)
+			<< ReloadStart.CarriedAmmo(CarriedAmmo);
+	}
+
+	void ReloadEnd(const AActor* Shooter, const AWeapon* Weapon, int32 CarriedAmmo)
+	{
+		UE_TRACE_LOG(Shooter, ReloadEnd, ShooterChannel)
+			<< ReloadEnd.Cycle(FPlatformTime::Cycles64())
+			<< ReloadEnd.ShooterId(GetId(Shooter))
+			<< ReloadEnd.WeaponType(Weapon ? static_cast<uint8>(Weapon->GetWeaponType()) : 0)
+			<< ReloadEnd.Ammo(Weapon ? Weapon->GetAmmo() : 0)
+			<< ReloadEnd.CarriedAmmo(CarriedAmmo);
+	}
+
+	void Swap(const AActor* Shooter, int32 FromSlot, int32 ToSlot)
+	{
+		UE_TRACE_LOG(Shooter, Swap, ShooterChannel)
+			<< Swap.Cycle(FPlatformTime::Cycles64())
+			<< Swap.ShooterId(GetId(Shooter))
+			<< Swap.FromSlot(static_cast<int8>(FromSlot))
+			<< Swap.ToSlot(static_cast<int8>(ToSlot));
+	}
+
+	void ItemCurve(const AItem* Item, bool bStart)
+	{
+		UE_TRACE_LOG(Shooter, ItemCurve, ShooterChannel)
+			<< ItemCurve.Cycle(FPlatformTime::Cycles64())
+			<< ItemCurve.ItemId(GetId(Item))
+			<< ItemCurve.bStart(bStart ? 1 : 0)
+			<< ItemCurve.ItemState(Item ? static_cast<uint8>(Item->GetItemState()) : 0);
+	}
+
+	void EnemyDie(const AEnemy* Enemy)
+	{
+		UE_TRACE_LOG(Shooter, EnemyDie, ShooterChannel)
+			<< EnemyDie.Cycle(FPlatformTime::Cycles64())
+			<< EnemyDie.EnemyId(GetId(Enemy))
+			<< EnemyDie.Health(Enemy ? Enemy->GetHealth() : 0.f);
+	}
+}
+
+#endif
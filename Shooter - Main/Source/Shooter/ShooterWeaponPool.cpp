@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ShooterWeaponPool.h"
+#include "Engine/World.h"
+#include "Weapon.h"
+#include "ShooterLLM.h"
+#include "ShooterHitchMonitor.h"
+
+static TAutoConsoleVariable<int32> CVarWeaponPoolMaxPooled(
+	TEXT("Shooter.WeaponPool.MaxPooled"),
+	16,
+	TEXT("Put away weapons kept hidden for reuse, past this they are destroyed and the next equip spawns a new one"));
+
+void UShooterWeaponPool::Deinitialize()
+{
+	Pooled.Reset();
+
+	Super::Deinitialize();
+}
+
+AWeapon* UShooterWeaponPool::Acquire(const FInventoryWeaponRecord& Record)
+{
+	if (!Record.IsValid()) return nullptr;
+
+	SHOOTER_LLM_SCOPE(Weapons);
+
+	AWeapon* Weapon{ nullptr };
+	for (int32 Index = Pooled.Num() - 1; Index >= 0; --Index)
+	{
+		AWeapon* Candidate = Pooled[Index];
+
+		// Something else may have destroyed it while it waited
+		if (Candidate == nullptr || Candidate->IsPendingKill())
+		{
+			Pooled.RemoveAtSwap(Index);
+			continue;
+		}
+		if (Candidate->GetClass() == Record.WeaponClass)
+		{
+			Weapon = Candidate;
+			Pooled.RemoveAtSwap(Index);
+			break;
+		}
+	}
+
+	if (Weapon == nullptr)
+	{
+		ShooterHitch::AddEvent(EShooterHitchEvent::Spawn, this, Record.WeaponClass->GetFName());
+		Weapon = GetWorld()->SpawnActor<AWeapon>(Record.WeaponClass);
+		if (Weapon == nullptr) return nullptr;
+	}
+
+	Weapon->ApplyInventoryRecord(Record);
+	return Weapon;
+}
+
+void UShooterWeaponPool::Release(AWeapon* Weapon)
+{
+	if (Weapon == nullptr) return;
+
+	FDetachmentTransformRules DetachmentTransformRules(EDetachmentRule::KeepWorld, true);
+	Weapon->GetItemMesh()->DetachFromComponent(DetachmentTransformRules);
+	Weapon->SetItemState(EItemState::EIS_PickedUp);
+
+	if (!Weapon->HasAuthority()) return;
+
+	if (Pooled.Num() >= CVarWeaponPoolMaxPooled.GetValueOnGameThread())
+	{
+		Weapon->Destroy();
+		return;
+	}
+	Pooled.Add(Weapon);
+}
@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ShooterInventory.h"
+#include "ShooterWeaponPool.generated.h"
+
+class AWeapon;
+
+/**
+ * Weapon actors nobody holds. Inventories keep put away weapons as FInventoryWeaponRecord values, equipping one
+ * takes an actor of its class from here, or spawns one when none is free, and putting one away hands the actor back.
+ * Pooled weapons are hidden in EIS_PickedUp, which makes them net dormant and stops their tick.
+ * At most Shooter.WeaponPool.MaxPooled are kept, the rest are destroyed.
+ */
+UCLASS()
+class SHOOTER_API UShooterWeaponPool : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	virtual void Deinitialize() override;
+
+	/* A weapon with the class, type and ammo of Record, taken from the pool or spawned. Server only */
+	AWeapon* Acquire(const FInventoryWeaponRecord& Record);
+
+	/* Hides Weapon and keeps it for a later Acquire. Clients only hide their copy, the server owns the actor */
+	void Release(AWeapon* Weapon);
+
+	FORCEINLINE int32 GetNumPooled() const { return Pooled.Num(); }
+
+private:
+
+	UPROPERTY()
+	TArray<AWeapon*> Pooled;
+};
@@ -0,0 +1,6 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SignificanceInterface.h"
+
+// Add default functionality here for any ISignificanceInterface functions that are not pure virtual.
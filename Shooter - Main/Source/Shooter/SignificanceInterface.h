@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Interface.h"
+#include "SignificanceInterface.generated.h"
+
+UENUM(BlueprintType)
+enum class ESignificanceTier : uint8
+{
+	EST_High UMETA(DisplayName = "High"),
+	EST_Medium UMETA(DisplayName = "Medium"),
+	EST_Low UMETA(DisplayName = "Low"),
+	EST_Dormant UMETA(DisplayName = "Dormant"),
+
+	EST_MAX UMETA(DisplayName = "DefaultMAX")
+};
+
+// This class does not need to be modified.
+UINTERFACE(MinimalAPI)
+class USignificanceInterface : public UInterface
+{
+	GENERATED_BODY()
+};
+
+/**
+ * Implemented by actors that are scored by the UShooterSignificanceManager
+ */
+class SHOOTER_API ISignificanceInterface
+{
+	GENERATED_BODY()
+
+public:
+
+	/* Called by the significance manager when the actor moves to a new tier */
+	virtual void SetSignificanceTier(ESignificanceTier Tier) {}
+
+	/* Return true to pin the actor to OutTier regardless of its score */
+	virtual bool GetForcedSignificanceTier(ESignificanceTier& OutTier) const { return false; }
+};
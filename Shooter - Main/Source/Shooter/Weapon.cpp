@@ -2,6 +2,11 @@
 
 
 #include "Weapon.h"
+#include "ShooterLLM.h"
+#include "ShooterGrenade.h"
+#include "Net/UnrealNetwork.h"
+#include "ShooterSpread.h"
+#include "ShooterCombatClock.h"
 
 AWeapon::AWeapon() :
 	ThrowWeaponTime(1.f),
@@ -14,10 +19,16 @@ AWeapon::AWeapon() :
 	ClipBoneName(TEXT("smg_clip")),
 	Damage(10.f),
 	HeadShotDamage(15.f),
+	SpreadDegrees(1.5f),
+	RecoilRecoveryTime(0.3f),
 	SlideDisplacement(0.f),
+	SlideElapsed(0.f),
+	SlideStepDisplacement(0.f),
+	PreviousSlideDisplacement(0.f),
 	SlideDisplacementTime(0.1f),
 	bMovingSlide(false),
-	MaxSlideDisplacement(4.f)
+	MaxSlideDisplacement(4.f),
+	GrenadeClass(AShooterGrenade::StaticClass())
 {
 	PrimaryActorTick.bCanEverTick = true;
 }
@@ -32,12 +43,30 @@ void AWeapon::Tick(float DeltaTime)
 		const FRotator MeshRotation{ 0.f, GetItemMesh()->GetComponentRotation().Yaw, 0.f };
 		GetItemMesh()->SetWorldRotation(MeshRotation, false, nullptr, ETeleportType::TeleportPhysics);
 	}
+}
 
-	// Update slide on pistol
-	UpdateSlideDisplacement();
-	
+bool AWeapon::CombatStep(float StepTime, double SimTime)
+{
+	const bool bItemInterping{ Super::CombatStep(StepTime, SimTime) };
+	const bool bSlideMoving{ UpdateSlideDisplacement(StepTime) };
+	return bItemInterping || bSlideMoving;
 }
 
+void AWeapon::CombatPresent(float Alpha)
+{
+	Super::CombatPresent(Alpha);
+
+	SlideDisplacement = FMath::Lerp(PreviousSlideDisplacement, SlideStepDisplacement, Alpha);
+}
+
+uint32 AWeapon::GetCombatStateHash() const
+{
+	uint32 Hash{ Super::GetCombatStateHash() };
+	Hash = HashCombine(Hash, GetTypeHash(static_cast<uint8>(bMovingSlide)));
+	Hash = HashCombine(Hash, GetTypeHash(SlideElapsed));
+	Hash = HashCombine(Hash, GetTypeHash(SlideStepDisplacement));
+	return HashCombine(Hash, GetTypeHash(Ammo));
+}
 
 void AWeapon::ThrowWeapon()
 {
@@ -74,23 +103,33 @@ void AWeapon::DecreaseAmmo()
 	{
 		--Ammo;
 	}
+	AmmoChangedDelegate.Broadcast(this, Ammo);
+}
+
+void AWeapon::SetAmmo(int32 NewAmmo)
+{
+	Ammo = FMath::Clamp(NewAmmo, 0, MagazineCapacity);
+	AmmoChangedDelegate.Broadcast(this, Ammo);
 }
 
 void AWeapon::StartSlideTimer()
 {
-	bMovingClip = true;
-	GetWorldTimerManager().SetTimer(
-		SlideTimer,
-		this,
-		&AWeapon::FinishMovingSlide,
-		SlideDisplacementTime
-	);
+	bMovingSlide = true;
+	SlideElapsed = 0.f;
+
+	// Stepped by the combat clock until SlideDisplacementTime has passed on it
+	UShooterCombatClock* CombatClock = GetWorld()->GetSubsystem<UShooterCombatClock>();
+	if (CombatClock)
+	{
+		CombatClock->Register(this);
+	}
 }
 
 void AWeapon::ReloadAmmo(int32 Ammount)
 {
 	checkf(Ammo + Ammount <= MagazineCapacity, TEXT("Attempted to reload with more than magazine capacity!"))
 	Ammo += Ammount;
+	AmmoChangedDelegate.Broadcast(this, Ammo);
 }
 
 bool AWeapon::ClipIsFull()
@@ -107,54 +146,114 @@ void AWeapon::StopFalling()
 }
 
 void AWeapon::OnConstruction(const FTransform& Transform)
+{
+	SHOOTER_LLM_SCOPE(Weapons);
+
+	const FWeaponDataTable* WeaponDataRow = ApplyWeaponData();
+	if (WeaponDataRow)
+	{
+		Ammo = WeaponDataRow->WeaponAmmo;
+	}
+}
+
+const FWeaponDataTable* AWeapon::FindWeaponData(EWeaponType Type)
 {
 	const FString WeaponTablePath{ TEXT("DataTable'/Game/_game/DataTable/WeaponDataTable.WeaponDataTable'") };
 
 	UDataTable* WeaponTableObject = Cast<UDataTable>(StaticLoadObject(UDataTable::StaticClass(), nullptr, *WeaponTablePath));
+	if (WeaponTableObject == nullptr) return nullptr;
 
-	if (WeaponTableObject)
+	switch (Type)
 	{
-		FWeaponDataTable* WeaponDataRow = nullptr;
-		switch (WeaponType)
-		{
-		case EWeaponType::EWT_SubmachineGun:
-			WeaponDataRow = WeaponTableObject->FindRow<FWeaponDataTable>(FName("SubmachineGun"), TEXT(""));
-			break;
-		case EWeaponType::EWT_AssaultRifle:
-			WeaponDataRow = WeaponTableObject->FindRow<FWeaponDataTable>(FName("AssaultRifle"), TEXT(""));
-			break;
-		case EWeaponType::EWT_Pistol:
-			WeaponDataRow = WeaponTableObject->FindRow<FWeaponDataTable>(FName("Pistol"), TEXT(""));
-			break;
+	case EWeaponType::EWT_SubmachineGun:
+		return WeaponTableObject->FindRow<FWeaponDataTable>(FName("SubmachineGun"), TEXT(""));
+	case EWeaponType::EWT_AssaultRifle:
+		return WeaponTableObject->FindRow<FWeaponDataTable>(FName("AssaultRifle"), TEXT(""));
+	case EWeaponType::EWT_Pistol:
+		return WeaponTableObject->FindRow<FWeaponDataTable>(FName("Pistol"), TEXT(""));
+	case EWeaponType::EWT_Grenade:
+		return WeaponTableObject->FindRow<FWeaponDataTable>(FName("Grenade"), TEXT(""));
+	default:
+		break;
+	}
+	return nullptr;
+}
 
-		}
+const FWeaponDataTable* AWeapon::ApplyWeaponData()
+{
+	const FWeaponDataTable* WeaponDataRow = FindWeaponData(WeaponType);
+	if (WeaponDataRow == nullptr) return nullptr;
 
-		if (WeaponDataRow)
+	// BeginPlay hid the previous type's bone, a re-typed weapon swaps it for the new one
+	if (HasActorBegunPlay() && BoneToHide != WeaponDataRow->BoneToHide)
+	{
+		if (BoneToHide != FName(""))
 		{
-			AmmoType = WeaponDataRow->AmmoType;
-			Ammo = WeaponDataRow->WeaponAmmo;
-			MagazineCapacity = WeaponDataRow->MagazingCapacity;
-			SetPickupSound(WeaponDataRow->PickupSound);
-			SetEquipSound(WeaponDataRow->EquipSound);
-			GetItemMesh()->SetSkeletalMesh(WeaponDataRow->ItemMesh);
-			SetItemName(WeaponDataRow->ItemName);
-			SetIconItem(WeaponDataRow->InventoryIcon);
-			SetAmmoIcon(WeaponDataRow->AmmoIcon);
-			SetClipBoneName(WeaponDataRow->ClipBoneName);
-			SetReloadMontagesection(WeaponDataRow->ReloadMontageSection);
-			GetItemMesh()->SetAnimInstanceClass(WeaponDataRow->AnimBP);
-			CrosshairsMiddle = WeaponDataRow->CrosshairsMiddle;
-			CrosshairsLeft = WeaponDataRow->CrosshairsLeft;
-			CrosshairsRight = WeaponDataRow->CrosshairsRight;
-			CrosshairsTop = WeaponDataRow->CrosshairsTop;
-			CrosshairsBottom = WeaponDataRow->CrosshairsBottom;
-			AutoFireRate = WeaponDataRow->AutoFireRate;
-			MuzzleFlash = WeaponDataRow->MuzzleFlash;
-			FireSound = WeaponDataRow->FireSound;
-			BoneToHide = WeaponDataRow->BoneToHide;
+			GetItemMesh()->UnHideBoneByName(BoneToHide);
 		}
+		if (WeaponDataRow->BoneToHide != FName(""))
+		{
+			GetItemMesh()->HideBoneByName(WeaponDataRow->BoneToHide, EPhysBodyOp::PBO_None);
+		}
+	}
+
+	AmmoType = WeaponDataRow->AmmoType;
+	MagazineCapacity = WeaponDataRow->MagazingCapacity;
+	SetPickupSound(WeaponDataRow->PickupSound);
+	SetEquipSound(WeaponDataRow->EquipSound);
+	GetItemMesh()->SetSkeletalMesh(WeaponDataRow->ItemMesh);
+	SetItemName(WeaponDataRow->ItemName);
+	SetIconItem(WeaponDataRow->InventoryIcon);
+	SetAmmoIcon(WeaponDataRow->AmmoIcon);
+	SetClipBoneName(WeaponDataRow->ClipBoneName);
+	SetReloadMontagesection(WeaponDataRow->ReloadMontageSection);
+	GetItemMesh()->SetAnimInstanceClass(WeaponDataRow->AnimBP);
+	CrosshairsMiddle = WeaponDataRow->CrosshairsMiddle;
+	CrosshairsLeft = WeaponDataRow->CrosshairsLeft;
+	CrosshairsRight = WeaponDataRow->CrosshairsRight;
+	CrosshairsTop = WeaponDataRow->CrosshairsTop;
+	CrosshairsBottom = WeaponDataRow->CrosshairsBottom;
+	AutoFireRate = WeaponDataRow->AutoFireRate;
+	MuzzleFlash = WeaponDataRow->MuzzleFlash;
+	FireSound = WeaponDataRow->FireSound;
+	BoneToHide = WeaponDataRow->BoneToHide;
+	SpreadDegrees = WeaponDataRow->SpreadDegrees;
+	RecoilRecoveryTime = WeaponDataRow->RecoilRecoveryTime;
+	ShooterSpread::BuildRecoilOffsets(WeaponDataRow->RecoilPattern, RecoilOffsets);
+
+	return WeaponDataRow;
+}
+
+void AWeapon::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AWeapon, WeaponType);
+}
 
+void AWeapon::OnRep_WeaponType()
+{
+	SHOOTER_LLM_SCOPE(Weapons);
+	ApplyWeaponData();
+}
+
+FInventoryWeaponRecord AWeapon::MakeInventoryRecord() const
+{
+	FInventoryWeaponRecord Record;
+	Record.WeaponClass = GetClass();
+	Record.WeaponType = WeaponType;
+	Record.Ammo = Ammo;
+	return Record;
+}
+
+void AWeapon::ApplyInventoryRecord(const FInventoryWeaponRecord& Record)
+{
+	if (Record.WeaponType != WeaponType)
+	{
+		WeaponType = Record.WeaponType;
+		OnRep_WeaponType();
 	}
+	SetAmmo(Record.Ammo);
 }
 
 void AWeapon::BeginPlay()
@@ -172,14 +271,27 @@ void AWeapon::FinishMovingSlide()
 	bMovingSlide = false;
 }
 
-void AWeapon::UpdateSlideDisplacement()
+bool AWeapon::UpdateSlideDisplacement(float StepTime)
 {
-	if (SlideDisplacementCurve && bMovingSlide)
+	if (!bMovingSlide) return false;
+
+	PreviousSlideDisplacement = SlideStepDisplacement;
+	SlideElapsed = FMath::Min(SlideElapsed + StepTime, SlideDisplacementTime);
+	if (SlideDisplacementCurve)
+	{
+		const float CurveValue{ SlideDisplacementCurve->GetFloatValue(SlideElapsed) };
+		SlideStepDisplacement = CurveValue * MaxSlideDisplacement;
+	}
+
+	if (SlideElapsed >= SlideDisplacementTime)
 	{
-		const float ElapsedTime{ GetWorldTimerManager().GetTimerElapsed(SlideTimer) };
-		const float CurveValue{ SlideDisplacementCurve->GetFloatValue(ElapsedTime) };
-		SlideDisplacement = CurveValue * MaxSlideDisplacement;
+		FinishMovingSlide();
+
+		// This is the last frame presented, show where the slide rests rather than a blend towards it
+		PreviousSlideDisplacement = SlideStepDisplacement;
+		return false;
 	}
+	return true;
 }
 
 
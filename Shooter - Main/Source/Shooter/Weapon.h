@@ -6,9 +6,14 @@
 #include "Item.h"
 #include "AmmoType.h"
 #include "WeaponType.h"
+#include "ShooterInventory.h"
 #include "Engine/DataTable.h"
 #include "Weapon.generated.h"
 
+class AWeapon;
+class AShooterGrenade;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FWeaponAmmoChangedDelegate, AWeapon*, Weapon, int32, Ammo);
 
 
 USTRUCT(BlueprintType)
@@ -80,7 +85,18 @@ struct FWeaponDataTable : public FTableRowBase
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 		FName BoneToHide;
 
+	/* Half-angle in degrees of the cone shots land in at a crosshair spread multiplier of 1 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float SpreadDegrees = 1.5f;
+
+	/* Kick of each shot of a burst in degrees, X up and Y to the right. The first shot goes where the crosshair is,
+	 * each later one adds the kicks before it */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TArray<FVector2D> RecoilPattern;
 
+	/* Seconds without firing before the recoil pattern starts over */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float RecoilRecoveryTime = 0.3f;
 };
 /**
  * 
@@ -94,6 +110,11 @@ public:
 	AWeapon();
 
 	virtual void Tick(float DeltaTime) override;
+
+	/* ICombatSimInterface: the item curve and the pistol slide */
+	virtual bool CombatStep(float StepTime, double SimTime) override;
+	virtual void CombatPresent(float Alpha) override;
+	virtual uint32 GetCombatStateHash() const override;
 protected:
 	
 	void StopFalling();
@@ -102,9 +123,19 @@ protected:
 
 	virtual void BeginPlay() override;
 
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/* A pooled weapon can come back as another type, its clients reload the data table row */
+	UFUNCTION()
+	void OnRep_WeaponType();
+
+	/* Copies the data table row for WeaponType onto the weapon, all but the starting ammo. Returns null when there is no row */
+	const FWeaponDataTable* ApplyWeaponData();
+
 	void FinishMovingSlide();
 
-	void UpdateSlideDisplacement();
+	/* One combat step of the slide along its curve, returns false once it is back at rest */
+	bool UpdateSlideDisplacement(float StepTime);
 
 
 private:
@@ -121,7 +152,7 @@ private:
 	int32 MagazineCapacity;
 
 	/* The type of Weapon */
-	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Weapon Properies", meta = (AllowPrivateAccess = "true"))
+	UPROPERTY(ReplicatedUsing = OnRep_WeaponType, EditAnywhere, BlueprintReadWrite, Category = "Weapon Properies", meta = (AllowPrivateAccess = "true"))
 	EWeaponType WeaponType;
 
 	/* AmmoType sets the starting ammotype for each weapon */
@@ -181,6 +212,16 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = DataTable, meta = (AllowPrivateAccess = "true"))
 	FName BoneToHide;
 
+	/* Half-angle in degrees of the shot cone at a crosshair spread multiplier of 1 */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = DataTable, meta = (AllowPrivateAccess = "true"))
+	float SpreadDegrees;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = DataTable, meta = (AllowPrivateAccess = "true"))
+	float RecoilRecoveryTime;
+
+	/* Recoil of each shot of a burst, built from the data table pattern by ShooterSpread::BuildRecoilOffsets */
+	TArray<FVector2D> RecoilOffsets;
+
 	/* Amount that the slide is pushed back during pistol fire */
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = Pistol, meta = (AllowPrivateAccess = "true"))
 	float SlideDisplacement;
@@ -189,8 +230,12 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Pistol, meta = (AllowPrivateAccess = "true"))
 	UCurveFloat* SlideDisplacementCurve;
 
-	/*Time handle for updating SlideDisplacement*/
-	FTimerHandle SlideTimer;
+	/* Time since the slide started moving, on the combat clock */
+	float SlideElapsed;
+
+	/* Slide displacement as of the last combat step and the one before, SlideDisplacement is drawn in between */
+	float SlideStepDisplacement;
+	float PreviousSlideDisplacement;
 
 	/* Time for Displacing the slide */
 	float SlideDisplacementTime;
@@ -202,6 +247,10 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Pistol, meta = (AllowPrivateAccess = "true"))
 	float MaxSlideDisplacement;
 
+	/* Spawned by each throw of a grenade weapon */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = Grenade, meta = (AllowPrivateAccess = "true"))
+	TSubclassOf<AShooterGrenade> GrenadeClass;
+
 public:
 	/* Adds an impluse to the weapon */
 	void ThrowWeapon();
@@ -212,7 +261,20 @@ public:
 	/* decreases ammo when firing weapon */
 	void DecreaseAmmo();
 
+	/* Overwrites Ammo, used when the server corrects a prediction */
+	void SetAmmo(int32 NewAmmo);
+
 	FORCEINLINE EWeaponType GetWeaponType() const { return WeaponType; }
+
+	/* Data table row for Type, null when the table or the row is missing */
+	static const FWeaponDataTable* FindWeaponData(EWeaponType Type);
+
+	/* What the inventory keeps of this weapon once it is put away */
+	FInventoryWeaponRecord MakeInventoryRecord() const;
+
+	/* Takes the type and ammo of Record, for a weapon coming out of the pool */
+	void ApplyInventoryRecord(const FInventoryWeaponRecord& Record);
+
 	FORCEINLINE EAmmoType GetAmmoType() const { return AmmoType; }
 	FORCEINLINE FName GetReloadMontagesection() const { return ReloadMontageSection; }
 	FORCEINLINE void SetReloadMontagesection(FName Name)  {  ReloadMontageSection = Name; }
@@ -223,6 +285,15 @@ public:
 	FORCEINLINE float GetAutoFireRate() const { return AutoFireRate; }
 	FORCEINLINE UParticleSystem* GetMuzzleFlash() const { return MuzzleFlash; }
 	FORCEINLINE USoundCue* GetFireSound() const { return FireSound; }
+	FORCEINLINE TSubclassOf<AShooterGrenade> GetGrenadeClass() const { return GrenadeClass; }
+	FORCEINLINE float GetSpreadDegrees() const { return SpreadDegrees; }
+	FORCEINLINE float GetRecoilRecoveryTime() const { return RecoilRecoveryTime; }
+	FORCEINLINE const TArray<FVector2D>& GetRecoilOffsets() const { return RecoilOffsets; }
+	FORCEINLINE UTexture2D* GetCrosshairsMiddle() const { return CrosshairsMiddle; }
+	FORCEINLINE UTexture2D* GetCrosshairsLeft() const { return CrosshairsLeft; }
+	FORCEINLINE UTexture2D* GetCrosshairsRight() const { return CrosshairsRight; }
+	FORCEINLINE UTexture2D* GetCrosshairsTop() const { return CrosshairsTop; }
+	FORCEINLINE UTexture2D* GetCrosshairsBottom() const { return CrosshairsBottom; }
 
 	void StartSlideTimer();
 
@@ -231,4 +302,8 @@ public:
 	FORCEINLINE void SetMovingClip(bool Move) { bMovingClip = Move; }
 
 	bool ClipIsFull();
+
+	/* Broadcast whenever Ammo changes, so the HUD doesn't have to poll it */
+	UPROPERTY(BlueprintAssignable, Category = Delegates)
+	FWeaponAmmoChangedDelegate AmmoChangedDelegate;
 };
@@ -5,6 +5,7 @@ enum class EWeaponType : uint8
 	EWT_SubmachineGun UMETA(DisplayName = "SubmachineGun"),
 	EWT_AssaultRifle UMETA(DisplayName = "AssaultRifle"),
 	EWT_Pistol UMETA(DisplayName = "Pistol"),
+	EWT_Grenade UMETA(DisplayName = "Grenade"),
 	EWT_MAX UMETA(DisplayName = "DefaultMax")
 
 };
\ No newline at end of file